@@ -1,15 +1,47 @@
-QT += core gui widgets concurrent
+QT += core gui widgets network
 
 CONFIG += c++11
 
 SOURCES += \
+    fontindex.cpp \
+    httppdfsource.cpp \
+    imageresampler.cpp \
+    iotrace.cpp \
+    jobscheduler.cpp \
     main.cpp \
     mainwindow.cpp \
-    pdfdocument.cpp
+    pagecache.cpp \
+    pagelinks.cpp \
+    pageoverlay.cpp \
+    pdfdocument.cpp \
+    pdfiumruntime.cpp \
+    pdfsource.cpp \
+    singleinstance.cpp \
+    textexporter.cpp \
+    textindex.cpp \
+    textlayout.cpp \
+    textmatcher.cpp \
+    zippdfsource.cpp
 
 HEADERS += \
+    fontindex.h \
+    httppdfsource.h \
+    imageresampler.h \
+    iotrace.h \
+    jobscheduler.h \
     mainwindow.h \
-    pdfdocument.h
+    pagecache.h \
+    pagelinks.h \
+    pageoverlay.h \
+    pdfdocument.h \
+    pdfiumruntime.h \
+    pdfsource.h \
+    singleinstance.h \
+    textexporter.h \
+    textindex.h \
+    textlayout.h \
+    textmatcher.h \
+    zippdfsource.h
 
 FORMS += \
     mainwindow.ui
@@ -24,3 +56,8 @@ win32 {
 
 
 win32:LIBS += -luser32
+
+# ---- zlib（ZIP 内的 PDF）----
+# Windows 上用 Qt 自带的 zlib（QtCore 已导出），其他平台用系统库
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+else: LIBS += -lz
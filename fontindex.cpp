@@ -0,0 +1,723 @@
+﻿#include "fontindex.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTextCodec>
+
+#include <cstring>
+
+namespace {
+
+const quint32 kCacheMagic = 0x50464958;     // "PFIX"
+const quint32 kCacheVersion = 1;
+
+const quint32 kTagTtcf = 0x74746366;        // 'ttcf'
+const quint32 kTagOtto = 0x4F54544F;        // 'OTTO'
+const quint32 kTagTrue = 0x74727565;        // 'true'
+const quint32 kTagName = 0x6E616D65;        // 'name'
+const quint32 kTagOs2 = 0x4F532F32;         // 'OS/2'
+const quint32 kTagPost = 0x706F7374;        // 'post'
+
+inline quint16 u16(const uchar *p) { return quint16((p[0] << 8) | p[1]); }
+inline quint32 u32(const uchar *p) { return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | p[3]; }
+
+// OS/2 ulCodePageRange1 的位 -> PDFium 字符集
+struct CodePageBit {
+    int bit;
+    int charset;
+};
+
+const CodePageBit kCodePageBits[] = {
+    { 0, FXFONT_ANSI_CHARSET },
+    { 1, FXFONT_EASTERNEUROPEAN_CHARSET },
+    { 2, FXFONT_CYRILLIC_CHARSET },
+    { 3, FXFONT_GREEK_CHARSET },
+    { 5, FXFONT_HEBREW_CHARSET },
+    { 6, FXFONT_ARABIC_CHARSET },
+    { 8, FXFONT_VIETNAMESE_CHARSET },
+    { 16, FXFONT_THAI_CHARSET },
+    { 17, FXFONT_SHIFTJIS_CHARSET },
+    { 18, FXFONT_GB2312_CHARSET },
+    { 19, FXFONT_HANGEUL_CHARSET },
+    { 20, FXFONT_CHINESEBIG5_CHARSET },
+    { 31, FXFONT_SYMBOL_CHARSET },
+};
+
+// 中文 PDF 里常见的字体名（含 Adobe CID 字体、中文名）及其替代字体，按顺序取第一个装了的
+struct AliasGroup {
+    const char *aliases;        // 用 | 分隔
+    const char *candidates;
+};
+
+const AliasGroup kAliasGroups[] = {
+    { "SimSun|宋体|NSimSun|新宋体|STSong|华文宋体|STSong-Light|STSongStd-Light|AdobeSongStd-Light|Song|SongTi",
+      "SimSun|NSimSun|STSong|Songti SC|Noto Serif CJK SC|Source Han Serif SC|AR PL UMing CN" },
+    { "SimHei|黑体|STHeiti|华文黑体|STHeiti-Regular|AdobeHeitiStd-Regular|Hei|HeiTi|Microsoft YaHei|微软雅黑",
+      "SimHei|Microsoft YaHei|STHeiti|Heiti SC|PingFang SC|Noto Sans CJK SC|Source Han Sans SC|WenQuanYi Zen Hei|WenQuanYi Micro Hei" },
+    { "KaiTi|楷体|KaiTi_GB2312|楷体_GB2312|STKaiti|华文楷体|AdobeKaitiStd-Regular|Kai",
+      "KaiTi|KaiTi_GB2312|STKaiti|Kaiti SC|AR PL UKai CN|SimSun|Noto Serif CJK SC" },
+    { "FangSong|仿宋|FangSong_GB2312|仿宋_GB2312|STFangsong|华文仿宋|AdobeFangsongStd-Regular",
+      "FangSong|FangSong_GB2312|STFangsong|SimSun|Noto Serif CJK SC" },
+    { "MingLiU|PMingLiU|细明体|新细明体|MSung-Light|MSungStd-Light",
+      "PMingLiU|MingLiU|Noto Serif CJK TC|Source Han Serif TC|AR PL UMing TW" },
+    { "MHei-Medium|MHeiStd-Medium|Microsoft JhengHei|微軟正黑體",
+      "Microsoft JhengHei|PingFang TC|Noto Sans CJK TC|Source Han Sans TC" },
+};
+
+// 名字找不到时按字符集兜底：先衬线（正文多用宋体/明朝），名字像黑体时先无衬线
+struct CharsetFallback {
+    int charset;
+    const char *serif;
+    const char *sans;
+};
+
+const CharsetFallback kCharsetFallbacks[] = {
+    { FXFONT_GB2312_CHARSET,
+      "SimSun|NSimSun|STSong|Songti SC|Noto Serif CJK SC|Source Han Serif SC|AR PL UMing CN",
+      "Microsoft YaHei|SimHei|DengXian|PingFang SC|Noto Sans CJK SC|Source Han Sans SC|WenQuanYi Micro Hei|WenQuanYi Zen Hei|Droid Sans Fallback" },
+    { FXFONT_CHINESEBIG5_CHARSET,
+      "PMingLiU|MingLiU|Noto Serif CJK TC|Source Han Serif TC|AR PL UMing TW",
+      "Microsoft JhengHei|PingFang TC|Noto Sans CJK TC|Source Han Sans TC" },
+    { FXFONT_SHIFTJIS_CHARSET,
+      "MS Mincho|Yu Mincho|Hiragino Mincho ProN|Noto Serif CJK JP|IPAMincho|TakaoMincho",
+      "MS Gothic|Meiryo|Yu Gothic|Hiragino Sans|Noto Sans CJK JP|IPAGothic|TakaoGothic" },
+    { FXFONT_HANGEUL_CHARSET,
+      "Batang|Noto Serif CJK KR|NanumMyeongjo",
+      "Malgun Gothic|Gulim|Dotum|Apple SD Gothic Neo|Noto Sans CJK KR|NanumGothic" },
+};
+
+QStringList splitNames(const char *list)
+{
+    return QString::fromUtf8(list).split(QLatin1Char('|'));
+}
+
+} // namespace
+
+FontIndex *FontIndex::instance()
+{
+    static FontIndex index;
+    return &index;
+}
+
+FontIndex::FontIndex()
+{
+    std::memset(&m_info, 0, sizeof(m_info));
+    m_info.version = 1;
+    m_info.EnumFonts = &FontIndex::enumFonts;
+    m_info.MapFont = &FontIndex::mapFont;
+    m_info.GetFont = &FontIndex::getFont;
+    m_info.GetFontData = &FontIndex::getFontData;
+    m_info.GetFaceName = &FontIndex::getFaceName;
+    m_info.GetFontCharset = &FontIndex::getFontCharset;
+    m_info.DeleteFont = &FontIndex::deleteFont;
+}
+
+void FontIndex::install()
+{
+    FPDF_SetSystemFontInfo(&m_info);
+}
+
+int FontIndex::faceCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_faces.size();
+}
+
+void FontIndex::refresh()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_ready) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 1. 上次的索引
+    QHash<QString, QSharedPointer<FontFile>> cached = loadCache();
+    const int cachedCount = cached.size();
+
+    // 2. 扫描字体目录：大小和修改时间都没变的直接沿用，否则重新解析
+    int reused = 0;
+    int parsed = 0;
+    QSet<QString> seen;
+    for (const QString &dir : fontDirectories()) {
+        QDirIterator it(dir, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            const QFileInfo info = it.fileInfo();
+            const QString suffix = info.suffix().toLower();
+            if (suffix != QLatin1String("ttf") && suffix != QLatin1String("ttc") &&
+                suffix != QLatin1String("otf") && suffix != QLatin1String("otc")) {
+                continue;
+            }
+
+            const QString path = info.canonicalFilePath();
+            if (path.isEmpty() || seen.contains(path)) continue;
+            seen.insert(path);
+
+            const qint64 size = info.size();
+            const qint64 modifiedMs = info.lastModified().toMSecsSinceEpoch();
+
+            QSharedPointer<FontFile> file = cached.take(path);
+            if (file && file->size == size && file->modifiedMs == modifiedMs) {
+                ++reused;
+                addFileLocked(file);
+                continue;
+            }
+
+            file.reset(new FontFile);
+            file->path = path;
+            file->size = size;
+            file->modifiedMs = modifiedMs;
+
+            QFile font(path);
+            if (font.open(QIODevice::ReadOnly)) {
+                if (const uchar *data = font.map(0, size)) {
+                    file->faces = parseFile(data, size, &file->collection);
+                    font.unmap(const_cast<uchar *>(data));
+                }
+            }
+            ++parsed;
+
+            // 解析不了的也记下来（没有字体），下次不再重复打开
+            addFileLocked(file);
+        }
+    }
+
+    m_ready = true;
+
+    // 3. 有新增、变化或删除的文件才写回
+    if (parsed > 0 || reused != cachedCount) saveCacheLocked();
+
+    qInfo().noquote() << QStringLiteral("字体索引：%1 个文件（沿用 %2，解析 %3），%4 个字体，%5 ms")
+                         .arg(m_files.size()).arg(reused).arg(parsed).arg(m_faces.size()).arg(timer.elapsed());
+}
+
+void FontIndex::addFileLocked(const QSharedPointer<FontFile> &file)
+{
+    m_files.append(file);
+    for (Face &face : file->faces) {
+        face.file = file.data();
+        m_faces.append(&face);
+        for (const QString &name : face.names) {
+            QList<const Face *> &list = m_byName[name];
+            if (!list.contains(&face)) list.append(&face);
+        }
+    }
+}
+
+QStringList FontIndex::fontDirectories()
+{
+    QStringList dirs = QStandardPaths::standardLocations(QStandardPaths::FontsLocation);
+#if defined(Q_OS_WIN)
+    dirs << qEnvironmentVariable("WINDIR", QStringLiteral("C:/Windows")) + QStringLiteral("/Fonts");
+    const QString local = qEnvironmentVariable("LOCALAPPDATA");
+    if (!local.isEmpty()) dirs << local + QStringLiteral("/Microsoft/Windows/Fonts");
+#elif defined(Q_OS_MACOS)
+    dirs << QStringLiteral("/System/Library/Fonts") << QStringLiteral("/Library/Fonts")
+         << QDir::homePath() + QStringLiteral("/Library/Fonts");
+#else
+    dirs << QStringLiteral("/usr/share/fonts") << QStringLiteral("/usr/local/share/fonts")
+         << QDir::homePath() + QStringLiteral("/.fonts")
+         << QDir::homePath() + QStringLiteral("/.local/share/fonts");
+#endif
+
+    // 去重（大小写、分隔符、嵌套目录），只保留存在的
+    QStringList result;
+    for (const QString &dir : dirs) {
+        const QString path = QFileInfo(QDir::fromNativeSeparators(dir)).canonicalFilePath();
+        if (path.isEmpty() || result.contains(path, Qt::CaseInsensitive)) continue;
+
+        bool nested = false;
+        for (const QString &existing : result) {
+            if (path.startsWith(existing + QLatin1Char('/'), Qt::CaseInsensitive)) nested = true;
+        }
+        if (!nested) result << path;
+    }
+    return result;
+}
+
+QString FontIndex::cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/font_index.bin";
+}
+
+QVector<FontIndex::Face> FontIndex::parseFile(const uchar *data, qint64 size, bool *collection)
+{
+    QVector<Face> faces;
+    *collection = false;
+    if (size < 12) return faces;
+
+    const quint32 tag = u32(data);
+    if (tag == kTagTtcf) {
+        *collection = true;
+        const quint32 count = u32(data + 8);
+        if (count > 256 || 12 + 4 * qint64(count) > size) return faces;
+
+        for (quint32 i = 0; i < count; ++i) {
+            Face face;
+            if (parseFace(data, size, u32(data + 12 + 4 * i), &face)) faces << face;
+        }
+    } else if (tag == 0x00010000 || tag == kTagOtto || tag == kTagTrue) {
+        Face face;
+        if (parseFace(data, size, 0, &face)) faces << face;
+    }
+    return faces;
+}
+
+bool FontIndex::parseFace(const uchar *data, qint64 size, quint32 offset, Face *face)
+{
+    if (qint64(offset) + 12 > size) return false;
+
+    const int numTables = u16(data + offset + 4);
+    if (qint64(offset) + 12 + 16 * qint64(numTables) > size) return false;
+
+    // 1. 表目录
+    const uchar *nameTable = nullptr;
+    const uchar *os2 = nullptr;
+    const uchar *post = nullptr;
+    quint32 nameLength = 0;
+    quint32 os2Length = 0;
+    quint32 postLength = 0;
+    for (int i = 0; i < numTables; ++i) {
+        const uchar *record = data + offset + 12 + 16 * i;
+        const quint32 tableOffset = u32(record + 8);
+        const quint32 tableLength = u32(record + 12);
+        if (qint64(tableOffset) + tableLength > size) continue;
+
+        switch (u32(record)) {
+        case kTagName: nameTable = data + tableOffset; nameLength = tableLength; break;
+        case kTagOs2: os2 = data + tableOffset; os2Length = tableLength; break;
+        case kTagPost: post = data + tableOffset; postLength = tableLength; break;
+        default: break;
+        }
+    }
+    if (!nameTable || nameLength < 6) return false;
+
+    // 2. 名字：族名（1、16）、全名（4）、PostScript 名（6），所有语言都收（中文名也能匹配）
+    const int count = u16(nameTable + 2);
+    const int stringOffset = u16(nameTable + 4);
+    int familyRank = -1;
+    for (int i = 0; i < count; ++i) {
+        const uchar *record = nameTable + 6 + 12 * i;
+        if (quint32(6 + 12 * (i + 1)) > nameLength) break;
+
+        const int platform = u16(record);
+        const int encoding = u16(record + 2);
+        const int language = u16(record + 4);
+        const int nameId = u16(record + 6);
+        const int length = u16(record + 8);
+        const quint32 start = quint32(stringOffset) + u16(record + 10);
+        if (nameId != 1 && nameId != 4 && nameId != 6 && nameId != 16) continue;
+        if (start + length > nameLength) continue;
+
+        const uchar *text = nameTable + start;
+        QString name;
+        if (platform == 0 || (platform == 3 && (encoding == 0 || encoding == 1 || encoding == 10))) {
+            name.reserve(length / 2);
+            for (int k = 0; k + 1 < length; k += 2) name.append(QChar(u16(text + k)));
+        } else if (platform == 1 && encoding == 0) {
+            name = QString::fromLatin1(reinterpret_cast<const char *>(text), length);
+        } else {
+            continue;
+        }
+        name = name.trimmed();
+        if (name.isEmpty()) continue;
+
+        const QString normalized = normalizeName(name);
+        if (!face->names.contains(normalized)) face->names << normalized;
+
+        // 首选族名：英文的 16 > 英文的 1 > 其他
+        if (nameId == 1 || nameId == 16) {
+            const bool english = (platform == 3 && language == 0x409) || (platform == 1 && language == 0);
+            const int rank = (english ? 2 : 0) + (nameId == 16 ? 1 : 0);
+            if (rank > familyRank) {
+                familyRank = rank;
+                face->family = name;
+            }
+        }
+    }
+    if (face->family.isEmpty()) return false;
+
+    // 3. 字重、斜体、字符集、衬线
+    if (os2 && os2Length >= 64) {
+        face->weight = u16(os2 + 4);
+        face->italic = (u16(os2 + 62) & 0x01) != 0;
+        const int familyClass = u16(os2 + 30) >> 8;
+        face->serif = (familyClass >= 1 && familyClass <= 5) || familyClass == 7;
+        if (u16(os2) >= 1 && os2Length >= 82) face->codePages = u32(os2 + 78);
+    }
+    if (face->codePages == 0) face->codePages = 1;      // 没有代码页信息：当作西文字体
+    if (!face->serif) face->serif = looksSerif(normalizeName(face->family));
+
+    if (post && postLength >= 16) face->fixedPitch = u32(post + 12) != 0;
+    return true;
+}
+
+QString FontIndex::normalizeName(const QString &name)
+{
+    QString result;
+    result.reserve(name.size());
+    for (const QChar c : name) {
+        if (c.isSpace() || c == QLatin1Char('-') || c == QLatin1Char('_')) continue;
+        result.append(c.toLower());
+    }
+    return result;
+}
+
+QString FontIndex::stripStyle(const QString &name)
+{
+    QString result = name;
+
+    // 子集前缀 ABCDEF+
+    if (result.size() > 7 && result.at(6) == QLatin1Char('+')) {
+        bool prefix = true;
+        for (int i = 0; i < 6; ++i) prefix = prefix && result.at(i).isUpper();
+        if (prefix) result = result.mid(7);
+    }
+
+    // SimSun,Bold
+    const int comma = result.indexOf(QLatin1Char(','));
+    if (comma > 0) result.truncate(comma);
+
+    // Arial-BoldMT：只去掉明确的样式后缀（STSong-Light 是真名字，不能去）
+    static const char *const kStyles[] = { "BoldItalic", "BoldOblique", "Bold", "Italic", "Oblique",
+                                           "Regular", "BoldItalicMT", "BoldMT", "ItalicMT", "MT" };
+    const int dash = result.lastIndexOf(QLatin1Char('-'));
+    if (dash > 0) {
+        const QString style = result.mid(dash + 1);
+        for (const char *known : kStyles) {
+            if (style.compare(QLatin1String(known), Qt::CaseInsensitive) == 0) {
+                result.truncate(dash);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+bool FontIndex::looksSerif(const QString &normalized)
+{
+    static const char *const kHints[] = { "song", "ming", "mincho", "serif", "kai", "fang", "batang",
+                                          "myeongjo", "宋", "明", "楷", "仿" };
+    for (const char *hint : kHints) {
+        if (normalized.contains(QString::fromUtf8(hint))) return true;
+    }
+    return false;
+}
+
+QString FontIndex::decodeFaceName(const char *face)
+{
+    const QByteArray bytes(face);
+
+    bool ascii = true;
+    for (const char c : bytes) ascii = ascii && uchar(c) < 0x80;
+    if (ascii) return QString::fromLatin1(bytes);
+
+    // PDFium 按“系统本地编码”传名字，实际就是 PDF 里的原始字节：中文 PDF 多为 GBK，
+    // 本地编码（例如 Linux 的 UTF-8）解不开时按 GB18030 再试
+    QTextCodec::ConverterState state;
+    const QString local = QTextCodec::codecForLocale()->toUnicode(bytes.constData(), bytes.size(), &state);
+    if (state.invalidChars == 0) return local;
+
+    if (QTextCodec *gb = QTextCodec::codecForName("GB18030")) return gb->toUnicode(bytes);
+    return local;
+}
+
+bool FontIndex::supportsCharset(const Face &face, int charset)
+{
+    if (charset == FXFONT_DEFAULT_CHARSET) return true;
+    for (const CodePageBit &entry : kCodePageBits) {
+        if (entry.charset == charset) return (face.codePages & (1u << entry.bit)) != 0;
+    }
+    return false;
+}
+
+int FontIndex::primaryCharset(const Face &face)
+{
+    // CJK 优先：宋体同时支持西文，但 PDFium 要知道它能用来显示中文
+    static const int kOrder[] = { FXFONT_GB2312_CHARSET, FXFONT_CHINESEBIG5_CHARSET, FXFONT_SHIFTJIS_CHARSET,
+                                  FXFONT_HANGEUL_CHARSET, FXFONT_ANSI_CHARSET, FXFONT_SYMBOL_CHARSET };
+    for (const int charset : kOrder) {
+        if (supportsCharset(face, charset)) return charset;
+    }
+    return FXFONT_DEFAULT_CHARSET;
+}
+
+const FontIndex::Face *FontIndex::findFace(int weight, bool italic, int charset, int pitchFamily,
+                                           const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    const QString key = normalizeName(stripStyle(name));
+
+    // 1. 名字直接命中（中文名、PostScript 名也算）
+    if (!key.isEmpty()) {
+        if (const Face *face = lookupLocked(key, weight, italic, charset)) return face;
+    }
+
+    // 2. 常见中文字体名的替代
+    for (const AliasGroup &group : kAliasGroups) {
+        bool matched = false;
+        for (const QString &alias : splitNames(group.aliases)) {
+            if (normalizeName(alias) == key) {
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) continue;
+
+        for (const QString &candidate : splitNames(group.candidates)) {
+            if (const Face *face = lookupLocked(normalizeName(candidate), weight, italic, charset)) return face;
+        }
+    }
+
+    // 3. 按字符集兜底：只管 CJK，西文交给 PDFium 内置的替代字体
+    for (const CharsetFallback &fallback : kCharsetFallbacks) {
+        if (fallback.charset != charset) continue;
+
+        const bool sans = !(pitchFamily & FXFONT_FF_ROMAN) &&
+                (key.contains(QLatin1String("hei")) || key.contains(QLatin1String("gothic")) ||
+                 key.contains(QLatin1String("sans")) || key.contains(QString::fromUtf8("黑")));
+        const QStringList preferred = sans
+                ? splitNames(fallback.sans) + splitNames(fallback.serif)
+                : splitNames(fallback.serif) + splitNames(fallback.sans);
+        for (const QString &candidate : preferred) {
+            if (const Face *face = lookupLocked(normalizeName(candidate), weight, italic, charset)) return face;
+        }
+
+        // 都没装：任何一个支持该字符集的字体
+        QList<const Face *> any;
+        for (const Face *face : m_faces) {
+            if (supportsCharset(*face, charset) && face->serif == !sans) any << face;
+        }
+        if (any.isEmpty()) {
+            for (const Face *face : m_faces) {
+                if (supportsCharset(*face, charset)) any << face;
+            }
+        }
+        return bestStyle(any, weight, italic);
+    }
+
+    return nullptr;
+}
+
+const FontIndex::Face *FontIndex::lookupLocked(const QString &normalized, int weight, bool italic, int charset) const
+{
+    const QList<const Face *> faces = m_byName.value(normalized);
+    if (faces.isEmpty()) return nullptr;
+
+    // 名字对上但不支持所需字符集（例如要中文却只有西文字形）时不用它
+    QList<const Face *> usable;
+    for (const Face *face : faces) {
+        if (supportsCharset(*face, charset)) usable << face;
+    }
+    if (usable.isEmpty() && (charset == FXFONT_ANSI_CHARSET || charset == FXFONT_SYMBOL_CHARSET)) usable = faces;
+    return bestStyle(usable, weight, italic);
+}
+
+const FontIndex::Face *FontIndex::bestStyle(const QList<const Face *> &candidates, int weight, bool italic)
+{
+    const Face *best = nullptr;
+    int bestScore = 0;
+    for (const Face *face : candidates) {
+        const int score = qAbs(face->weight - (weight > 0 ? weight : 400)) + (face->italic != italic ? 1000 : 0);
+        if (!best || score < bestScore) {
+            best = face;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+bool FontIndex::mapFile(FontFile *file)
+{
+    QMutexLocker locker(&file->mapMutex);
+    if (file->data) return true;
+
+    QSharedPointer<QFile> font(new QFile(file->path));
+    if (!font->open(QIODevice::ReadOnly) || font->size() != file->size) return false;
+
+    const uchar *data = font->map(0, file->size);
+    if (!data) return false;
+
+    file->mapped = font;
+    file->data = data;
+    return true;
+}
+
+QHash<QString, QSharedPointer<FontIndex::FontFile>> FontIndex::loadCache()
+{
+    QHash<QString, QSharedPointer<FontFile>> files;
+
+    QFile cache(cachePath());
+    if (!cache.open(QIODevice::ReadOnly)) return files;
+
+    QDataStream in(&cache);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kCacheMagic || version != kCacheVersion) return files;
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QSharedPointer<FontFile> file(new FontFile);
+        quint32 faceCount = 0;
+        in >> file->path >> file->size >> file->modifiedMs >> file->collection >> faceCount;
+
+        for (quint32 k = 0; k < faceCount && in.status() == QDataStream::Ok; ++k) {
+            Face face;
+            qint32 weight = 0;
+            in >> face.offset >> face.family >> face.names >> weight >> face.italic
+               >> face.fixedPitch >> face.serif >> face.codePages;
+            face.weight = weight;
+            file->faces << face;
+        }
+        files.insert(file->path, file);
+    }
+
+    // 文件损坏：当作没有缓存，全部重新解析
+    if (in.status() != QDataStream::Ok) files.clear();
+    return files;
+}
+
+void FontIndex::saveCacheLocked() const
+{
+    QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+
+    QSaveFile cache(cachePath());
+    if (!cache.open(QIODevice::WriteOnly)) {
+        qWarning() << "Font index save failed:" << cache.errorString();
+        return;
+    }
+
+    QDataStream out(&cache);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << kCacheMagic << kCacheVersion << quint32(m_files.size());
+    for (const QSharedPointer<FontFile> &file : m_files) {
+        out << file->path << file->size << file->modifiedMs << file->collection << quint32(file->faces.size());
+        for (const Face &face : file->faces) {
+            out << face.offset << face.family << face.names << qint32(face.weight) << face.italic
+                << face.fixedPitch << face.serif << face.codePages;
+        }
+    }
+    cache.commit();
+}
+
+void FontIndex::enumFonts(FPDF_SYSFONTINFO *info, void *mapper)
+{
+    Q_UNUSED(info);
+
+    // 只报英文族名：名字里有非 ASCII 字符时 PDFium 会打开字体读 name 表，正是要省掉的开销
+    FontIndex *index = instance();
+    index->refresh();
+
+    QMutexLocker locker(&index->m_mutex);
+    QSet<QString> reported;
+    for (const Face *face : index->m_faces) {
+        const QString key = face->family + QLatin1Char('|') + QString::number(primaryCharset(*face));
+        if (reported.contains(key)) continue;
+        reported.insert(key);
+
+        const QByteArray name = face->family.toLocal8Bit();
+        bool ascii = true;
+        for (const char c : name) ascii = ascii && uchar(c) < 0x80;
+        if (ascii) FPDF_AddInstalledFont(mapper, name.constData(), primaryCharset(*face));
+    }
+}
+
+void *FontIndex::mapFont(FPDF_SYSFONTINFO *info, int weight, FPDF_BOOL italic, int charset,
+                         int pitchFamily, const char *face, FPDF_BOOL *exact)
+{
+    Q_UNUSED(info);
+
+    FontIndex *index = instance();
+    index->refresh();
+
+    const QString name = face ? decodeFaceName(face) : QString();
+    const Face *found = index->findFace(weight, italic != 0, charset, pitchFamily, name);
+    if (exact) *exact = found && found->names.contains(normalizeName(stripStyle(name)));
+    return const_cast<Face *>(found);
+}
+
+void *FontIndex::getFont(FPDF_SYSFONTINFO *info, const char *face)
+{
+    return mapFont(info, FXFONT_FW_NORMAL, false, FXFONT_DEFAULT_CHARSET, 0, face, nullptr);
+}
+
+unsigned long FontIndex::getFontData(FPDF_SYSFONTINFO *info, void *font, unsigned int table,
+                                     unsigned char *buffer, unsigned long size)
+{
+    Q_UNUSED(info);
+
+    const Face *face = static_cast<const Face *>(font);
+    if (!face || !mapFile(face->file)) return 0;
+
+    const FontFile *file = face->file;
+    qint64 offset = 0;
+    qint64 length = 0;
+
+    if (table == 0) {
+        // 整个字体。TTC 里 PDFium 用 “TTC 总长 - 这个长度” 算出字体表目录的位置，
+        // 再在 TTC 头里找到对应的序号，所以这里返回从表目录到文件末尾的长度
+        offset = face->offset;
+        length = file->size - face->offset;
+    } else if (table == kTagTtcf) {
+        if (file->collection) length = file->size;
+    } else {
+        // 单个表
+        const uchar *directory = file->data + face->offset;
+        const int numTables = u16(directory + 4);
+        for (int i = 0; i < numTables; ++i) {
+            const uchar *record = directory + 12 + 16 * i;
+            if (u32(record) != table) continue;
+            offset = u32(record + 8);
+            length = u32(record + 12);
+            if (offset + length > file->size) length = 0;
+            break;
+        }
+    }
+
+    if (length <= 0) return 0;
+    if (buffer && qint64(size) >= length) std::memcpy(buffer, file->data + offset, size_t(length));
+    return static_cast<unsigned long>(length);
+}
+
+unsigned long FontIndex::getFaceName(FPDF_SYSFONTINFO *info, void *font, char *buffer, unsigned long size)
+{
+    Q_UNUSED(info);
+
+    const Face *face = static_cast<const Face *>(font);
+    if (!face) return 0;
+
+    const QByteArray name = face->family.toLocal8Bit();
+    const unsigned long needed = static_cast<unsigned long>(name.size()) + 1;
+    if (buffer && size >= needed) std::memcpy(buffer, name.constData(), needed);
+    return needed;
+}
+
+int FontIndex::getFontCharset(FPDF_SYSFONTINFO *info, void *font)
+{
+    Q_UNUSED(info);
+
+    const Face *face = static_cast<const Face *>(font);
+    return face ? primaryCharset(*face) : FXFONT_DEFAULT_CHARSET;
+}
+
+void FontIndex::deleteFont(FPDF_SYSFONTINFO *info, void *font)
+{
+    // 句柄指向索引里的字体，进程内一直有效，映射也留着给下一个文档用
+    Q_UNUSED(info);
+    Q_UNUSED(font);
+}
@@ -0,0 +1,113 @@
+﻿#ifndef FONTINDEX_H
+#define FONTINDEX_H
+
+#include "fpdf_sysfontinfo.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QFile;
+
+// 系统字体索引，作为 FPDF_SYSFONTINFO 装给 PDFium（替代默认的字体枚举）
+// - PDFium 默认实现第一次需要非嵌入字体时要枚举并逐个打开系统字体，字体多的机器上要几百毫秒以上
+// - 这里把每个字体文件的族名（含中文名）、字符集、字重、TTC 中的位置记进持久化索引，
+//   下次启动只比较文件大小和修改时间，变了的才重新解析
+// - 字体数据按文件内存映射，所有文档共用；句柄在进程内一直有效
+// - 线程：refresh() 可以在任意线程调用（启动时在后台线程，不持 PDFium 锁）；回调都在持锁的 PDFium 调用里
+class FontIndex
+{
+public:
+    static FontIndex *instance();
+
+    // 载入持久化索引，扫描字体目录并增量更新；每个进程只做一次
+    void refresh();
+
+    // 在 FPDF_InitLibrary 之后调用，让 PDFium 通过本索引找系统字体（需持有 PDFium 锁）
+    void install();
+
+    int faceCount() const;
+
+private:
+    struct FontFile;
+
+    struct Face {
+        FontFile *file = nullptr;
+        quint32 offset = 0;         // 表目录在文件中的位置（TTC 中每个字体不同，普通字体为 0）
+        QString family;             // 首选族名（英文）
+        QStringList names;          // 所有族名、全名、PostScript 名（已规范化），用于匹配
+        int weight = 400;
+        bool italic = false;
+        bool fixedPitch = false;
+        bool serif = false;
+        quint32 codePages = 0;      // OS/2 ulCodePageRange1
+    };
+
+    struct FontFile {
+        QString path;
+        qint64 size = 0;
+        qint64 modifiedMs = 0;
+        bool collection = false;    // TTC/OTC
+        QVector<Face> faces;        // 建好后不再改动：句柄是指向元素的指针
+
+        // 第一次取数据时映射，之后一直保留
+        QMutex mapMutex;
+        const uchar *data = nullptr;
+        QSharedPointer<QFile> mapped;
+    };
+
+    FontIndex();
+    Q_DISABLE_COPY(FontIndex)
+
+    static QStringList fontDirectories();
+    static QString cachePath();
+
+    // 解析一个字体文件里的所有字体；不是 TrueType/OpenType 时返回空
+    static QVector<Face> parseFile(const uchar *data, qint64 size, bool *collection);
+    static bool parseFace(const uchar *data, qint64 size, quint32 offset, Face *face);
+
+    static QString normalizeName(const QString &name);
+    static QString decodeFaceName(const char *face);
+    static bool supportsCharset(const Face &face, int charset);
+    static int primaryCharset(const Face &face);
+
+    static QString stripStyle(const QString &name);
+    static bool looksSerif(const QString &normalized);
+
+    // 持久化索引：路径 -> 文件（含字体列表）
+    static QHash<QString, QSharedPointer<FontFile>> loadCache();
+    void saveCacheLocked() const;
+
+    void addFileLocked(const QSharedPointer<FontFile> &file);
+
+    const Face *findFace(int weight, bool italic, int charset, int pitchFamily, const QString &name) const;
+    const Face *lookupLocked(const QString &normalized, int weight, bool italic, int charset) const;
+    static const Face *bestStyle(const QList<const Face *> &candidates, int weight, bool italic);
+    static bool mapFile(FontFile *file);
+
+    // FPDF_SYSFONTINFO 回调
+    static void enumFonts(FPDF_SYSFONTINFO *info, void *mapper);
+    static void *mapFont(FPDF_SYSFONTINFO *info, int weight, FPDF_BOOL italic, int charset,
+                         int pitchFamily, const char *face, FPDF_BOOL *exact);
+    static void *getFont(FPDF_SYSFONTINFO *info, const char *face);
+    static unsigned long getFontData(FPDF_SYSFONTINFO *info, void *font, unsigned int table,
+                                     unsigned char *buffer, unsigned long size);
+    static unsigned long getFaceName(FPDF_SYSFONTINFO *info, void *font, char *buffer, unsigned long size);
+    static int getFontCharset(FPDF_SYSFONTINFO *info, void *font);
+    static void deleteFont(FPDF_SYSFONTINFO *info, void *font);
+
+private:
+    FPDF_SYSFONTINFO m_info;
+
+    mutable QMutex m_mutex;
+    bool m_ready = false;
+    QList<QSharedPointer<FontFile>> m_files;
+    QList<const Face *> m_faces;                  // 句柄就是 Face 指针
+    QHash<QString, QList<const Face *>> m_byName; // 规范化名字 -> 字体
+};
+
+#endif // FONTINDEX_H
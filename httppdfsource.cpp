@@ -0,0 +1,467 @@
+﻿#include "httppdfsource.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QTcpSocket>
+#include <QThread>
+
+#ifndef QT_NO_SSL
+#include <QSslSocket>
+#endif
+
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const qint64 kBlockSize = 64 * 1024;
+const qint64 kCacheBudget = 64 * 1024 * 1024;     // 块缓存上限
+const qint64 kMaxRequest = 4 * 1024 * 1024;       // 单个请求最多取这么多
+const int kTimeoutMs = 30000;
+
+// 读一行（到 CRLF 为止，不含 CRLF）
+bool readLine(QTcpSocket *socket, QByteArray *line)
+{
+    line->clear();
+    forever {
+        if (socket->canReadLine()) {
+            *line = socket->readLine();
+            while (line->endsWith('\n') || line->endsWith('\r')) line->chop(1);
+            return true;
+        }
+        if (!socket->waitForReadyRead(kTimeoutMs)) return false;
+    }
+}
+
+bool readExactly(QTcpSocket *socket, qint64 length, QByteArray *out)
+{
+    // QByteArray 的长度是 int：调用方已把长度限制在所请求的区间内，这里再兜一道
+    const qint64 start = out->size();
+    if (length < 0 || start + length > std::numeric_limits<int>::max()) return false;
+    out->resize(int(start + length));
+    qint64 done = 0;
+    while (done < length) {
+        if (socket->bytesAvailable() == 0 && !socket->waitForReadyRead(kTimeoutMs)) return false;
+        const qint64 n = socket->read(out->data() + start + done, length - done);
+        if (n < 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+// "bytes 0-0/12345"：总长度未知（"*"）时 total 为 -1
+bool parseContentRange(const QByteArray &header, qint64 *first, qint64 *last, qint64 *total)
+{
+    const QByteArray value = header.trimmed().toLower();
+    if (!value.startsWith("bytes ")) return false;
+
+    const int dash = value.indexOf('-', 6);
+    const int slash = value.indexOf('/', dash + 1);
+    if (dash < 0 || slash < 0) return false;
+
+    bool firstOk = false, lastOk = false;
+    *first = value.mid(6, dash - 6).trimmed().toLongLong(&firstOk);
+    *last = value.mid(dash + 1, slash - dash - 1).trimmed().toLongLong(&lastOk);
+    const QByteArray size = value.mid(slash + 1).trimmed();
+    *total = (size == "*") ? -1 : size.toLongLong();
+    return firstOk && lastOk && *first <= *last;
+}
+
+} // namespace
+
+// 交给 I/O 线程的一个请求；结果也写在这里，由 done 通知调用线程
+struct HttpPdfSource::RangeRequest
+{
+    qint64 position = 0;
+    qint64 length = 0;
+    QByteArray body;
+    qint64 total = -1;
+    QString error;
+    bool ok = false;
+    bool done = false;
+};
+
+HttpPdfSource::HttpPdfSource(const QUrl &url)
+    : m_url(url)
+{
+}
+
+HttpPdfSource::~HttpPdfSource()
+{
+    if (!m_ioThread) return;
+
+    // I/O 线程退出前在自己的线程里关掉连接
+    {
+        QMutexLocker io(&m_ioMutex);
+        m_ioStop = true;
+        m_ioWake.wakeAll();
+    }
+    m_ioThread->wait();
+    delete m_ioThread;
+}
+
+bool HttpPdfSource::open(QString *error)
+{
+    if (!m_url.isValid() || m_url.host().isEmpty()) {
+        if (error) *error = QStringLiteral("无效的地址：%1").arg(m_url.toString());
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    // 只要一个字节：总大小从 Content-Range 里取，同时确认服务器支持 Range
+    QByteArray body;
+    qint64 total = -1;
+    if (!requestRangeLocked(0, 1, &body, &total, error)) return false;
+
+    if (total <= 0) {
+        if (error) *error = QStringLiteral("服务器没有返回文件大小");
+        return false;
+    }
+
+    m_size = total;
+    return true;
+}
+
+qint64 HttpPdfSource::size() const
+{
+    return m_size;
+}
+
+QString HttpPdfSource::description() const
+{
+    return m_url.toString(QUrl::RemovePassword);
+}
+
+qint64 HttpPdfSource::bytesTransferred() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_transferred;
+}
+
+bool HttpPdfSource::readData(qint64 position, uchar *buffer, qint64 length)
+{
+    if (position < 0 || length < 0 || position + length > m_size) return false;
+    if (length == 0) return true;
+
+    QMutexLocker locker(&m_mutex);
+
+    const qint64 first = position / kBlockSize;
+    const qint64 last = (position + length - 1) / kBlockSize;
+
+    QString error;
+    if (!fetchBlocksLocked(first, last, &error)) {
+        qWarning() << "HTTP read failed:" << description() << error;
+        return false;
+    }
+
+    // 从缓存块拷贝出来
+    for (qint64 b = first; b <= last; ++b) {
+        const QByteArray block = m_blocks.value(b);
+        const qint64 blockStart = b * kBlockSize;
+        const qint64 from = qMax(position, blockStart);
+        const qint64 to = qMin(position + length, blockStart + qint64(block.size()));
+        if (to <= from) return false;
+
+        std::memcpy(buffer + (from - position), block.constData() + (from - blockStart), size_t(to - from));
+
+        m_lru.removeOne(b);
+        m_lru.append(b);
+    }
+    return true;
+}
+
+bool HttpPdfSource::fetchRange(qint64 position, qint64 length)
+{
+    const qint64 end = qMin(m_size, position + length);
+    if (end <= position) return true;
+
+    QMutexLocker locker(&m_mutex);
+
+    QString error;
+    if (!fetchBlocksLocked(position / kBlockSize, (end - 1) / kBlockSize, &error)) {
+        qWarning() << "HTTP prefetch failed:" << description() << error;
+        return false;
+    }
+    return true;
+}
+
+bool HttpPdfSource::fetchBlocksLocked(qint64 firstBlock, qint64 lastBlock, QString *error)
+{
+    qint64 b = firstBlock;
+    while (b <= lastBlock) {
+        if (m_blocks.contains(b)) {
+            ++b;
+            continue;
+        }
+
+        // 连续的缺块合并成一个请求（有上限，避免一次占用连接太久）
+        qint64 runEnd = b;
+        while (runEnd + 1 <= lastBlock && !m_blocks.contains(runEnd + 1) &&
+               (runEnd + 2 - b) * kBlockSize <= kMaxRequest) {
+            ++runEnd;
+        }
+
+        const qint64 position = b * kBlockSize;
+        const qint64 length = qMin(m_size, (runEnd + 1) * kBlockSize) - position;
+
+        QByteArray body;
+        qint64 total = -1;
+        if (!requestRangeLocked(position, length, &body, &total, error)) return false;
+        if (body.size() != length) {
+            if (error) *error = QStringLiteral("响应长度不符：期望 %1，实际 %2").arg(length).arg(body.size());
+            return false;
+        }
+
+        for (qint64 i = b; i <= runEnd; ++i) {
+            const qint64 offset = (i - b) * kBlockSize;
+            insertBlockLocked(i, body.mid(int(offset), int(qMin(kBlockSize, length - offset))));
+        }
+        b = runEnd + 1;
+    }
+    return true;
+}
+
+bool HttpPdfSource::requestRangeLocked(qint64 position, qint64 length, QByteArray *body,
+                                       qint64 *totalSize, QString *error)
+{
+    // 调用方持有 m_mutex：同一时间最多一个请求在途
+    if (!m_ioThread) {
+        m_ioThread = QThread::create([this]() { ioLoop(); });
+        m_ioThread->setObjectName(QStringLiteral("HttpPdfSource-IO"));
+        m_ioThread->start();
+    }
+
+    RangeRequest request;
+    request.position = position;
+    request.length = length;
+    {
+        QMutexLocker io(&m_ioMutex);
+        m_ioRequest = &request;
+        m_ioWake.wakeAll();
+        while (!request.done) m_ioDone.wait(&m_ioMutex);
+    }
+
+    if (!request.ok) {
+        if (error) *error = request.error;
+        return false;
+    }
+
+    m_transferred += request.body.size();
+    body->swap(request.body);
+    if (totalSize) *totalSize = request.total;
+    return true;
+}
+
+void HttpPdfSource::ioLoop()
+{
+    QMutexLocker io(&m_ioMutex);
+    forever {
+        while (!m_ioStop && !m_ioRequest) m_ioWake.wait(&m_ioMutex);
+        if (m_ioStop) break;
+
+        RangeRequest *request = m_ioRequest;
+        m_ioRequest = nullptr;
+        io.unlock();
+
+        request->ok = performRange(request);
+
+        io.relock();
+        request->done = true;
+        m_ioDone.wakeAll();
+    }
+    io.unlock();
+
+    // 套接字是在本线程创建的，也在本线程销毁
+    disconnectSocket();
+}
+
+bool HttpPdfSource::performRange(RangeRequest *request)
+{
+    const qint64 position = request->position;
+    const qint64 length = request->length;
+    QByteArray *body = &request->body;
+    QString *error = &request->error;
+
+    // 长连接可能已被服务器关掉：失败后重连再试一次
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!ensureConnected(error)) return false;
+
+        QByteArray path = m_url.path(QUrl::FullyEncoded).toLatin1();
+        if (path.isEmpty()) path = "/";
+        if (m_url.hasQuery()) path += '?' + m_url.query(QUrl::FullyEncoded).toLatin1();
+
+        QByteArray req;
+        req += "GET " + path + " HTTP/1.1\r\n";
+        req += "Host: " + m_url.host(QUrl::FullyEncoded).toLatin1();
+        if (m_url.port() > 0) req += ':' + QByteArray::number(m_url.port());
+        req += "\r\n";
+        req += "Range: bytes=" + QByteArray::number(position) + '-' +
+               QByteArray::number(position + length - 1) + "\r\n";
+        if (!m_url.userName().isEmpty()) {
+            const QByteArray credentials = m_url.userName().toUtf8() + ':' + m_url.password().toUtf8();
+            req += "Authorization: Basic " + credentials.toBase64() + "\r\n";
+        }
+        req += "Accept-Encoding: identity\r\n";
+        req += "Connection: keep-alive\r\n\r\n";
+
+        m_socket->write(req);
+        if (!m_socket->waitForBytesWritten(kTimeoutMs)) {
+            disconnectSocket();
+            continue;
+        }
+
+        // 1. 状态行
+        QByteArray line;
+        if (!readLine(m_socket, &line) || line.isEmpty()) {
+            disconnectSocket();
+            continue;
+        }
+
+        const QList<QByteArray> status = line.split(' ');
+        const int code = status.size() >= 2 ? status.at(1).toInt() : 0;
+
+        // 2. 头部
+        qint64 contentLength = -1;
+        bool chunked = false;
+        bool keepAlive = !line.startsWith("HTTP/1.0");
+        bool hasRange = false;
+        qint64 first = -1, last = -1, total = -1;
+        forever {
+            if (!readLine(m_socket, &line)) {
+                *error = QStringLiteral("读取响应头超时");
+                disconnectSocket();
+                return false;
+            }
+            if (line.isEmpty()) break;
+
+            const int colon = line.indexOf(':');
+            if (colon <= 0) continue;
+            const QByteArray name = line.left(colon).trimmed().toLower();
+            const QByteArray value = line.mid(colon + 1).trimmed();
+
+            if (name == "content-length") {
+                contentLength = value.toLongLong();
+            } else if (name == "transfer-encoding") {
+                chunked = value.toLower().contains("chunked");
+            } else if (name == "connection") {
+                keepAlive = !value.toLower().contains("close");
+            } else if (name == "content-range") {
+                hasRange = parseContentRange(value, &first, &last, &total);
+            }
+        }
+
+        // 3. 先判断是不是所要的区间：200 会带上整个文件，错误页也没必要读，直接断开连接
+        if (code != 206) {
+            *error = (code == 200)
+                    ? QStringLiteral("服务器不支持 Range 请求")
+                    : QStringLiteral("HTTP 错误 %1").arg(code);
+            disconnectSocket();
+            return false;
+        }
+        if (!hasRange || first != position || last != position + length - 1 ||
+            (contentLength >= 0 && contentLength != length)) {
+            *error = QStringLiteral("响应区间不符：请求 %1-%2").arg(position).arg(position + length - 1);
+            disconnectSocket();
+            return false;
+        }
+
+        // 4. 响应体：长度已核对过，最多读 length 字节
+        body->clear();
+        bool ok = true;
+        if (chunked) {
+            forever {
+                if (!readLine(m_socket, &line)) { ok = false; break; }
+                const qint64 chunk = line.split(';').first().trimmed().toLongLong(nullptr, 16);
+                if (chunk == 0) {
+                    // 跳过尾部头直到空行
+                    while ((ok = readLine(m_socket, &line)) && !line.isEmpty()) {}
+                    break;
+                }
+                if (chunk < 0 || body->size() + chunk > length ||
+                    !readExactly(m_socket, chunk, body) || !readLine(m_socket, &line)) {
+                    ok = false;
+                    break;
+                }
+            }
+        } else if (contentLength >= 0) {
+            ok = readExactly(m_socket, contentLength, body);
+        } else {
+            // 既没有长度也不分块：读到连接关闭
+            while (body->size() <= length && m_socket->waitForReadyRead(kTimeoutMs)) body->append(m_socket->readAll());
+            body->append(m_socket->readAll());
+            keepAlive = false;
+        }
+
+        if (!ok || body->size() != length) {
+            *error = QStringLiteral("读取响应体失败");
+            disconnectSocket();
+            return false;
+        }
+        if (!keepAlive) disconnectSocket();
+
+        request->total = total;
+        return true;
+    }
+
+    if (error->isEmpty()) *error = QStringLiteral("连接被服务器关闭");
+    return false;
+}
+
+bool HttpPdfSource::ensureConnected(QString *error)
+{
+    if (m_socket && m_socket->state() != QAbstractSocket::ConnectedState) disconnectSocket();
+    if (m_socket) return true;
+
+    const bool https = m_url.scheme().compare(QLatin1String("https"), Qt::CaseInsensitive) == 0;
+    const quint16 port = quint16(m_url.port(https ? 443 : 80));
+
+    if (https) {
+#ifndef QT_NO_SSL
+        QSslSocket *ssl = new QSslSocket;
+        ssl->connectToHostEncrypted(m_url.host(), port);
+        m_socket = ssl;
+        if (!ssl->waitForEncrypted(kTimeoutMs)) {
+            if (error) *error = ssl->errorString();
+            disconnectSocket();
+            return false;
+        }
+        return true;
+#else
+        if (error) *error = QStringLiteral("当前 Qt 不支持 HTTPS");
+        return false;
+#endif
+    }
+
+    m_socket = new QTcpSocket;
+    m_socket->connectToHost(m_url.host(), port);
+    if (!m_socket->waitForConnected(kTimeoutMs)) {
+        if (error) *error = m_socket->errorString();
+        disconnectSocket();
+        return false;
+    }
+    return true;
+}
+
+void HttpPdfSource::disconnectSocket()
+{
+    if (!m_socket) return;
+
+    m_socket->abort();
+    delete m_socket;
+    m_socket = nullptr;
+}
+
+void HttpPdfSource::insertBlockLocked(qint64 index, const QByteArray &data)
+{
+    if (m_blocks.contains(index)) return;
+
+    m_blocks.insert(index, data);
+    m_lru.append(index);
+    m_cachedBytes += data.size();
+
+    while (m_cachedBytes > kCacheBudget && m_lru.size() > 1) {
+        const qint64 victim = m_lru.takeFirst();
+        m_cachedBytes -= m_blocks.take(victim).size();
+    }
+}
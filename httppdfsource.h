@@ -0,0 +1,81 @@
+﻿#ifndef HTTPPDFSOURCE_H
+#define HTTPPDFSOURCE_H
+
+#include "pdfsource.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QUrl>
+#include <QWaitCondition>
+
+class QTcpSocket;
+class QThread;
+
+// 通过 HTTP Range 请求按需读取远程 PDF（不必先整个下载到本地）
+// - 打开时发一个 bytes=0-0 的请求，从 Content-Range 拿到总大小，同时确认服务器支持 Range
+// - 按 64KB 块缓存（LRU），GetBlock 缺哪几块就合并成一个请求去取
+// - fetchRange 供 FPDFAvail 的下载提示使用：线性化文件打开首页只传输首页需要的数据
+// - 网络读写都在自己的 I/O 线程里：长连接（含 TLS 会话）只建一次，不随调用方换线程而重连；
+//   调用方阻塞等待结果，所以只能在工作线程里调用
+// - 先看状态行和 Content-Range，不是所要的 206 区间就直接断开，不读响应体
+class HttpPdfSource : public PdfSource
+{
+public:
+    explicit HttpPdfSource(const QUrl &url);
+    ~HttpPdfSource() override;
+
+    bool open(QString *error);
+
+    qint64 size() const override;
+    QString description() const override;
+
+    // 已经通过网络取回的字节数
+    qint64 bytesTransferred() const;
+
+protected:
+    bool readData(qint64 position, uchar *buffer, qint64 length) override;
+    bool fetchRange(qint64 position, qint64 length) override;
+
+private:
+    // 取回 [firstBlock, lastBlock] 中还没缓存的块（连续的缺块合并成一个请求）
+    bool fetchBlocksLocked(qint64 firstBlock, qint64 lastBlock, QString *error);
+
+    // 发一个 Range 请求；body 为响应体，totalSize 为 Content-Range 里的总长度
+    // 请求交给 I/O 线程执行，调用线程等待结果
+    bool requestRangeLocked(qint64 position, qint64 length, QByteArray *body,
+                            qint64 *totalSize, QString *error);
+
+    // 以下只在 I/O 线程里调用
+    struct RangeRequest;
+    void ioLoop();
+    bool performRange(RangeRequest *request);
+    bool ensureConnected(QString *error);
+    void disconnectSocket();
+
+    void insertBlockLocked(qint64 index, const QByteArray &data);
+
+private:
+    QUrl m_url;
+    qint64 m_size = -1;
+
+    mutable QMutex m_mutex;
+
+    // I/O 线程：m_ioRequest / m_ioStop 由 m_ioMutex 保护，m_socket 只归 I/O 线程使用
+    QThread *m_ioThread = nullptr;
+    QMutex m_ioMutex;
+    QWaitCondition m_ioWake;
+    QWaitCondition m_ioDone;
+    RangeRequest *m_ioRequest = nullptr;
+    bool m_ioStop = false;
+    QTcpSocket *m_socket = nullptr;
+
+    // 块缓存
+    QHash<qint64, QByteArray> m_blocks;
+    QList<qint64> m_lru;
+    qint64 m_cachedBytes = 0;
+    qint64 m_transferred = 0;
+};
+
+#endif // HTTPPDFSOURCE_H
@@ -0,0 +1,310 @@
+﻿#include "imageresampler.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RESAMPLER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// ARGB32 在内存里的 Alpha 通道位置
+const int kAlphaIndex = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? 3 : 0;
+
+// 某个输出像素由哪些源像素贡献
+struct Contributor
+{
+    int first = 0;      // 第一个源像素
+    int count = 0;      // 源像素个数
+    int weights = 0;    // 在权重数组里的起点
+};
+
+struct AxisWeights
+{
+    std::vector<Contributor> contributors;
+    std::vector<float> weights;
+};
+
+AxisWeights computeAxisWeights(int srcLen, int dstLen)
+{
+    AxisWeights axis;
+    axis.contributors.resize(size_t(dstLen));
+
+    // 每个输出像素覆盖多少个源像素
+    const double ratio = double(srcLen) / dstLen;
+
+    for (int i = 0; i < dstLen; ++i) {
+        Contributor &c = axis.contributors[size_t(i)];
+        c.weights = int(axis.weights.size());
+
+        if (ratio > 1.0) {
+            // 缩小：输出像素 i 对应源区间 [a, b)，按覆盖长度计权
+            const double a = i * ratio;
+            const double b = qMin(double(srcLen), (i + 1) * ratio);
+            const int first = int(std::floor(a));
+            const int last = qMin(srcLen - 1, int(std::ceil(b)) - 1);
+
+            c.first = first;
+            c.count = last - first + 1;
+            for (int j = first; j <= last; ++j) {
+                const double cover = qMin(b, j + 1.0) - qMax(a, double(j));
+                axis.weights.push_back(float(cover / (b - a)));
+            }
+        } else {
+            // 放大（或等大）：双线性
+            const double center = (i + 0.5) * ratio - 0.5;
+            int j0 = int(std::floor(center));
+            double t = center - j0;
+            if (j0 < 0) { j0 = 0; t = 0.0; }
+            if (j0 >= srcLen - 1) { j0 = srcLen - 1; t = 0.0; }
+
+            c.first = j0;
+            if (t > 0.0) {
+                c.count = 2;
+                axis.weights.push_back(float(1.0 - t));
+                axis.weights.push_back(float(t));
+            } else {
+                c.count = 1;
+                axis.weights.push_back(1.0f);
+            }
+        }
+    }
+
+    return axis;
+}
+
+// sRGB <-> 线性光查找表（都按 0..255 标度）
+struct GammaTables
+{
+    float toLinear[256];
+    quint8 toSrgb[4096];    // 线性光量化到 12 位
+
+    GammaTables()
+    {
+        for (int i = 0; i < 256; ++i) {
+            const double c = i / 255.0;
+            const double l = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            toLinear[i] = float(l * 255.0);
+        }
+        for (int i = 0; i < 4096; ++i) {
+            const double l = i / 4095.0;
+            const double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+            toSrgb[i] = quint8(qBound(0, int(c * 255.0 + 0.5), 255));
+        }
+    }
+};
+
+const GammaTables &gammaTables()
+{
+    static const GammaTables tables;
+    return tables;
+}
+
+inline quint8 clampByte(float v)
+{
+    return quint8(qBound(0, int(v + 0.5f), 255));
+}
+
+inline quint8 linearToSrgb(float v)
+{
+    return gammaTables().toSrgb[qBound(0, int(v * (4095.0f / 255.0f) + 0.5f), 4095)];
+}
+
+// 一行字节 -> 浮点；4 通道时 Alpha 不做 gamma
+void loadRow(const uchar *src, float *dst, int n, int channels, bool gamma)
+{
+    if (gamma) {
+        const float *lut = gammaTables().toLinear;
+        for (int i = 0; i < n; ++i) {
+            dst[i] = (channels == 4 && (i & 3) == kAlphaIndex) ? float(src[i]) : lut[src[i]];
+        }
+        return;
+    }
+
+    int i = 0;
+#ifdef RESAMPLER_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(dst + i,      _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_ps(dst + i + 4,  _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_ps(dst + i + 8,  _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_ps(dst + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+    }
+#endif
+    for (; i < n; ++i) dst[i] = float(src[i]);
+}
+
+// 非预乘的 ARGB32：颜色先乘上 Alpha 再平均，否则透明像素（颜色多为黑）会把边缘染暗
+// 返回这一行是否有不透明度不足 255 的像素（渲染出的页面通常整行不透明，写回时可走快速路径）
+bool premultiplyRow(float *row, int n)
+{
+    bool translucent = false;
+    for (int i = 0; i < n; i += 4) {
+        const float alpha = row[i + kAlphaIndex];
+        if (alpha >= 255.0f) continue;
+
+        translucent = true;
+        const float a = alpha * (1.0f / 255.0f);
+        for (int ch = 0; ch < 4; ++ch) {
+            if (ch != kAlphaIndex) row[i + ch] *= a;
+        }
+    }
+    return translucent;
+}
+
+// 垂直方向：acc += row * w
+void accumulateRow(float *acc, const float *row, float w, int n)
+{
+    int i = 0;
+#ifdef RESAMPLER_SSE2
+    const __m128 wv = _mm_set1_ps(w);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 sum = _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(row + i), wv));
+        _mm_storeu_ps(acc + i, sum);
+    }
+#endif
+    for (; i < n; ++i) acc[i] += row[i] * w;
+}
+
+// 水平方向：把累加行（源宽度）收缩到目标宽度并写回 BGRA 字节
+// straightAlpha：累加的是预乘后的值，写回前除回 Alpha
+void storeRowBgra(const float *acc, uchar *dst, const AxisWeights &xw, bool gamma, bool straightAlpha)
+{
+    const int dstW = int(xw.contributors.size());
+
+    for (int x = 0; x < dstW; ++x) {
+        const Contributor &c = xw.contributors[size_t(x)];
+        const float *w = xw.weights.data() + c.weights;
+        const float *p = acc + c.first * 4;
+        uchar *out = dst + x * 4;
+
+        float sum[4];
+#ifdef RESAMPLER_SSE2
+        __m128 v = _mm_setzero_ps();
+        for (int k = 0; k < c.count; ++k) {
+            v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(p + k * 4), _mm_set1_ps(w[k])));
+        }
+
+        if (!gamma && !straightAlpha) {
+            // 四舍五入后饱和打包回 4 个字节
+            __m128i iv = _mm_cvtps_epi32(v);
+            iv = _mm_packs_epi32(iv, iv);
+            iv = _mm_packus_epi16(iv, iv);
+            const int packed = _mm_cvtsi128_si32(iv);
+            std::memcpy(out, &packed, 4);
+            continue;
+        }
+        _mm_storeu_ps(sum, v);
+#else
+        sum[0] = sum[1] = sum[2] = sum[3] = 0.0f;
+        for (int k = 0; k < c.count; ++k) {
+            for (int ch = 0; ch < 4; ++ch) sum[ch] += p[k * 4 + ch] * w[k];
+        }
+
+        if (!gamma && !straightAlpha) {
+            for (int ch = 0; ch < 4; ++ch) out[ch] = clampByte(sum[ch]);
+            continue;
+        }
+#endif
+        if (straightAlpha) {
+            const float a = sum[kAlphaIndex];
+            const float k = a > 0.0f ? 255.0f / a : 0.0f;
+            for (int ch = 0; ch < 4; ++ch) {
+                if (ch != kAlphaIndex) sum[ch] *= k;
+            }
+        }
+        if (!gamma) {
+            for (int ch = 0; ch < 4; ++ch) out[ch] = clampByte(sum[ch]);
+            continue;
+        }
+        for (int ch = 0; ch < 4; ++ch) {
+            out[ch] = (ch == kAlphaIndex) ? clampByte(sum[ch]) : linearToSrgb(sum[ch]);
+        }
+    }
+}
+
+void storeRowGray(const float *acc, uchar *dst, const AxisWeights &xw, bool gamma)
+{
+    const int dstW = int(xw.contributors.size());
+
+    for (int x = 0; x < dstW; ++x) {
+        const Contributor &c = xw.contributors[size_t(x)];
+        const float *w = xw.weights.data() + c.weights;
+        const float *p = acc + c.first;
+
+        float sum = 0.0f;
+        for (int k = 0; k < c.count; ++k) sum += p[k] * w[k];
+
+        dst[x] = gamma ? linearToSrgb(sum) : clampByte(sum);
+    }
+}
+
+} // namespace
+
+QImage ImageResampler::resize(const QImage &src, const QSize &size, Options options)
+{
+    if (src.isNull() || size.isEmpty()) return QImage();
+    if (src.size() == size) return src;
+
+    QImage in = src;
+    int channels = 4;
+    switch (in.format()) {
+    case QImage::Format_ARGB32:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        break;
+    case QImage::Format_Grayscale8:
+        channels = 1;
+        break;
+    default:
+        in = in.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        break;
+    }
+
+    QImage out(size, in.format());
+    if (out.isNull()) return QImage();
+
+    const bool gamma = options.testFlag(GammaCorrect);
+    const bool unpremultiplied = (in.format() == QImage::Format_ARGB32);
+    const AxisWeights xw = computeAxisWeights(in.width(), size.width());
+    const AxisWeights yw = computeAxisWeights(in.height(), size.height());
+
+    // 先垂直累加出一行（源宽度），再水平收缩；只需两行浮点缓冲
+    const int rowLen = in.width() * channels;
+    std::vector<float> acc(static_cast<size_t>(rowLen));
+    std::vector<float> row(static_cast<size_t>(rowLen));
+
+    for (int y = 0; y < size.height(); ++y) {
+        const Contributor &c = yw.contributors[size_t(y)];
+
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        bool straightAlpha = false;
+        for (int k = 0; k < c.count; ++k) {
+            loadRow(in.constScanLine(c.first + k), row.data(), rowLen, channels, gamma);
+            if (unpremultiplied && premultiplyRow(row.data(), rowLen)) straightAlpha = true;
+            accumulateRow(acc.data(), row.data(), yw.weights[size_t(c.weights + k)], rowLen);
+        }
+
+        if (channels == 4) storeRowBgra(acc.data(), out.scanLine(y), xw, gamma, straightAlpha);
+        else storeRowGray(acc.data(), out.scanLine(y), xw, gamma);
+    }
+
+    return out;
+}
+
+QImage ImageResampler::fit(const QImage &src, const QSize &bounds, Options options)
+{
+    if (src.isNull() || bounds.isEmpty()) return QImage();
+
+    const QSize target = src.size().scaled(bounds, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    return resize(src, target, options);
+}
@@ -0,0 +1,30 @@
+﻿#ifndef IMAGERESAMPLER_H
+#define IMAGERESAMPLER_H
+
+#include <QImage>
+#include <QSize>
+
+// 高质量缩放（替代 QPixmap::scaled(SmoothTransformation)，可在工作线程调用）
+// - 缩小：面积平均（box filter），每个源像素按覆盖面积计权
+// - 放大：双线性
+// - 直接处理 ARGB32 / RGB32 / ARGB32_Premultiplied（内存序 BGRA）与 Grayscale8，
+//   其余格式先转成 ARGB32_Premultiplied；非预乘的 ARGB32 按预乘后的值平均，透明边缘不发黑
+// - 有 SSE2 时按 4 通道/4 像素并行累加
+class ImageResampler
+{
+public:
+    enum Option {
+        NoOptions    = 0x0,
+        GammaCorrect = 0x1    // 在线性光空间里平均（sRGB 解码后再编码），细线与文字更不容易发灰
+    };
+    Q_DECLARE_FLAGS(Options, Option)
+
+    static QImage resize(const QImage &src, const QSize &size, Options options = NoOptions);
+
+    // 等比缩放到能放进 bounds 的最大尺寸（相当于 Qt::KeepAspectRatio）
+    static QImage fit(const QImage &src, const QSize &bounds, Options options = NoOptions);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(ImageResampler::Options)
+
+#endif // IMAGERESAMPLER_H
@@ -0,0 +1,226 @@
+﻿#include "iotrace.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QtGlobal>
+
+static QString formatBytes(qint64 bytes)
+{
+    if (bytes >= 1024 * 1024) return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+    if (bytes >= 1024) return QString::number(bytes / 1024.0, 'f', 1) + " KB";
+    return QString::number(bytes) + " B";
+}
+
+// JSON 字符串转义（阶段名、文档名里可能有引号、反斜杠和中文）
+static QString jsonString(const QString &s)
+{
+    QString out;
+    out.reserve(s.size() + 2);
+    out += QLatin1Char('"');
+    for (const QChar c : s) {
+        switch (c.unicode()) {
+        case '"':  out += QLatin1String("\\\""); break;
+        case '\\': out += QLatin1String("\\\\"); break;
+        case '\n': out += QLatin1String("\\n"); break;
+        case '\r': out += QLatin1String("\\r"); break;
+        case '\t': out += QLatin1String("\\t"); break;
+        default:
+            if (c.unicode() < 0x20) out += QString("\\u%1").arg(c.unicode(), 4, 16, QLatin1Char('0'));
+            else out += c;
+        }
+    }
+    out += QLatin1Char('"');
+    return out;
+}
+
+IoTrace::IoTrace()
+{
+    reset(QString());
+}
+
+void IoTrace::reset(const QString &document)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_clock.start();
+    m_document = document;
+
+    m_phaseIndex.clear();
+    m_stats.clear();
+    m_events.clear();
+    m_droppedEvents = 0;
+    m_lastEnd = -1;
+
+    // 0 号阶段：不属于任何显式阶段的读取
+    PhaseStats other;
+    other.name = QStringLiteral("other");
+    m_stats.append(other);
+    m_phaseIndex.insert(other.name, 0);
+    m_phase = 0;
+}
+
+int IoTrace::enterPhase(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const int previous = m_phase;
+    auto it = m_phaseIndex.constFind(name);
+    if (it != m_phaseIndex.constEnd()) {
+        m_phase = it.value();
+    } else {
+        PhaseStats stats;
+        stats.name = name;
+        m_phase = m_stats.size();
+        m_stats.append(stats);
+        m_phaseIndex.insert(name, m_phase);
+    }
+    return previous;
+}
+
+void IoTrace::restorePhase(int phase)
+{
+    QMutexLocker locker(&m_mutex);
+    if (phase >= 0 && phase < m_stats.size()) m_phase = phase;
+}
+
+qint64 IoTrace::nowNs() const
+{
+    return m_clock.nsecsElapsed();
+}
+
+void IoTrace::record(qint64 position, qint64 length, qint64 startNs, qint64 durationNs, bool ok)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Event e;
+    e.startNs = startNs;
+    e.durationNs = durationNs;
+    e.position = position;
+    e.length = length;
+    e.seekDistance = (m_lastEnd < 0) ? position : position - m_lastEnd;
+    e.phase = m_phase;
+    e.ok = ok;
+    m_lastEnd = position + length;
+
+    PhaseStats &s = m_stats[m_phase];
+    ++s.calls;
+    s.bytes += length;
+    s.totalNs += durationNs;
+    if (e.seekDistance != 0) {
+        ++s.seeks;
+        s.seekBytes += qAbs(e.seekDistance);
+    }
+    if (!ok) ++s.failures;
+
+    // 明细有上限，汇总始终准确
+    if (m_events.size() < kMaxEvents) m_events.append(e);
+    else ++m_droppedEvents;
+}
+
+QVector<IoTrace::PhaseStats> IoTrace::phaseStats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+QString IoTrace::summary() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QString text;
+    QTextStream ts(&text);
+
+    PhaseStats total;
+    for (const PhaseStats &s : m_stats) {
+        total.calls += s.calls;
+        total.bytes += s.bytes;
+        total.totalNs += s.totalNs;
+        total.seeks += s.seeks;
+        total.seekBytes += s.seekBytes;
+        total.failures += s.failures;
+    }
+
+    ts << QStringLiteral("文档：") << (m_document.isEmpty() ? QStringLiteral("（无）") : m_document) << "\n";
+    ts << QStringLiteral("合计：%1 次读取，%2，耗时 %3 ms，非顺序 %4 次，失败 %5 次\n")
+          .arg(total.calls)
+          .arg(formatBytes(total.bytes))
+          .arg(total.totalNs / 1e6, 0, 'f', 2)
+          .arg(total.seeks)
+          .arg(total.failures);
+    ts << "\n";
+
+    for (const PhaseStats &s : m_stats) {
+        if (s.calls == 0) continue;
+        ts << QStringLiteral("[%1] %2 次，%3，%4 ms，非顺序 %5 次，平均跳距 %6\n")
+              .arg(s.name)
+              .arg(s.calls)
+              .arg(formatBytes(s.bytes))
+              .arg(s.totalNs / 1e6, 0, 'f', 2)
+              .arg(s.seeks)
+              .arg(formatBytes(s.seeks ? s.seekBytes / qint64(s.seeks) : 0));
+    }
+
+    if (m_droppedEvents > 0) {
+        ts << "\n" << QStringLiteral("（明细已达上限，另有 %1 次读取只计入汇总）").arg(m_droppedEvents) << "\n";
+    }
+
+    ts.flush();
+    return text;
+}
+
+bool IoTrace::exportChromeTrace(const QString &path, QString *error) const
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    // 逐条写出，避免先在内存里拼出整个 JSON
+    QTextStream ts(&f);
+    ts.setCodec("UTF-8");
+    ts << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"document\":" << jsonString(m_document) << "},\n";
+    ts << "\"traceEvents\":[\n";
+
+    // 每个阶段一条“线程”，方便在时间线上分开看
+    for (int i = 0; i < m_stats.size(); ++i) {
+        ts << (i > 0 ? ",\n" : "")
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+           << ",\"args\":{\"name\":" << jsonString(m_stats[i].name) << "}}";
+    }
+
+    for (const Event &e : m_events) {
+        ts << ",\n{\"name\":\"GetBlock\",\"cat\":\"io\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.phase
+           << ",\"ts\":" << QString::number(e.startNs / 1000.0, 'f', 3)
+           << ",\"dur\":" << QString::number(e.durationNs / 1000.0, 'f', 3)
+           << ",\"args\":{\"pos\":" << e.position
+           << ",\"len\":" << e.length
+           << ",\"seek\":" << e.seekDistance
+           << ",\"ok\":" << (e.ok ? "true" : "false") << "}}";
+    }
+
+    ts << "\n]}\n";
+    ts.flush();
+
+    if (f.error() != QFile::NoError) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+    return true;
+}
+
+// ---- IoPhaseScope ----
+
+IoPhaseScope::IoPhaseScope(IoTrace *trace, const QString &name)
+    : m_trace(trace)
+    , m_previous(trace ? trace->enterPhase(name) : 0)
+{
+}
+
+IoPhaseScope::~IoPhaseScope()
+{
+    if (m_trace) m_trace->restorePhase(m_previous);
+}
@@ -0,0 +1,80 @@
+﻿#ifndef IOTRACE_H
+#define IOTRACE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 自定义文件读取（FPDF_FILEACCESS::m_GetBlock）的 I/O 统计与访问轨迹
+// - 按阶段汇总：调用次数、字节数、耗时、非顺序读取与跳转距离
+// - 保留逐次读取记录（有上限），可导出为 Chrome Trace（chrome://tracing / Perfetto）
+class IoTrace
+{
+public:
+    struct Event {
+        qint64 startNs = 0;         // 相对 reset() 时刻
+        qint64 durationNs = 0;
+        qint64 position = 0;
+        qint64 length = 0;
+        qint64 seekDistance = 0;    // 相对上一次读取末尾的距离，0 表示顺序读
+        int phase = 0;
+        bool ok = true;
+    };
+
+    struct PhaseStats {
+        QString name;
+        quint64 calls = 0;
+        qint64 bytes = 0;
+        qint64 totalNs = 0;
+        quint64 seeks = 0;          // 非顺序读取次数
+        qint64 seekBytes = 0;       // 跳转距离（绝对值）之和
+        quint64 failures = 0;
+    };
+
+    IoTrace();
+
+    void reset(const QString &document);
+
+    // 切换当前阶段，返回之前的阶段编号，便于嵌套后恢复
+    int enterPhase(const QString &name);
+    void restorePhase(int phase);
+
+    qint64 nowNs() const;
+    void record(qint64 position, qint64 length, qint64 startNs, qint64 durationNs, bool ok);
+
+    QVector<PhaseStats> phaseStats() const;
+    QString summary() const;
+    bool exportChromeTrace(const QString &path, QString *error = nullptr) const;
+
+private:
+    static const int kMaxEvents = 200000;
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    QString m_document;
+
+    QHash<QString, int> m_phaseIndex;
+    QVector<PhaseStats> m_stats;
+    int m_phase = 0;
+
+    QVector<Event> m_events;
+    quint64 m_droppedEvents = 0;
+    qint64 m_lastEnd = -1;
+};
+
+// 作用域内的读取都记到指定阶段
+class IoPhaseScope
+{
+public:
+    IoPhaseScope(IoTrace *trace, const QString &name);
+    ~IoPhaseScope();
+
+private:
+    IoTrace *m_trace;
+    int m_previous;
+};
+
+#endif // IOTRACE_H
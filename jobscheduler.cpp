@@ -0,0 +1,265 @@
+﻿#include "jobscheduler.h"
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QtGlobal>
+
+// 当前线程所属的调度器、线程编号与正在执行的任务优先级
+static thread_local JobScheduler *t_scheduler = nullptr;
+static thread_local int t_workerIndex = -1;
+static thread_local int t_priority = -1;
+
+JobScheduler *JobScheduler::instance()
+{
+    static JobScheduler scheduler;
+    return &scheduler;
+}
+
+JobScheduler::JobScheduler(int workerCount)
+{
+    if (workerCount <= 0) workerCount = QThread::idealThreadCount();
+    workerCount = qMax(2, workerCount);
+
+    m_clock.start();
+    m_workers.resize(size_t(workerCount));
+
+    for (int i = 0; i < workerCount; ++i) {
+        QThread *t = QThread::create([this, i]() { workerLoop(i); });
+        t->setObjectName(QStringLiteral("JobWorker-%1").arg(i));
+        m_threads.push_back(t);
+        t->start();
+    }
+}
+
+JobScheduler::~JobScheduler()
+{
+    shutdown();
+}
+
+QFuture<void> JobScheduler::run(Priority priority, const void *serialKey, std::function<void()> fn)
+{
+    QFutureInterface<void> iface;
+    iface.reportStarted();
+    QFuture<void> future = iface.future();
+
+    submit(priority, serialKey, [iface, fn]() mutable {
+        if (!iface.isCanceled()) fn();
+        iface.reportFinished();
+    }, [iface]() mutable {
+        iface.reportCanceled();
+        iface.reportFinished();
+    });
+
+    return future;
+}
+
+void JobScheduler::submit(Priority priority, const void *serialKey, std::function<void()> fn,
+                          std::function<void()> discard)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_stopping) {
+        // 已停止：不执行，但要让 future 结束，否则等它的人会一直等下去
+        locker.unlock();
+        discard();
+        return;
+    }
+
+    Job job;
+    job.fn = std::move(fn);
+    job.discard = std::move(discard);
+    job.priority = priority;
+    job.serialKey = serialKey;
+    job.enqueuedNs = m_clock.nsecsElapsed();
+
+    // 工作线程里再提交的任务放进自己的队列（局部性好），否则轮流分配
+    int target = (t_scheduler == this) ? t_workerIndex : -1;
+    if (target < 0) {
+        target = m_nextWorker;
+        m_nextWorker = (m_nextWorker + 1) % int(m_workers.size());
+    }
+
+    m_workers[size_t(target)].queues[priority].push_back(std::move(job));
+    m_wake.wakeAll();
+}
+
+bool JobScheduler::shouldYield()
+{
+    JobScheduler *self = t_scheduler;
+    if (!self || t_priority <= Visible) return false;
+
+    QMutexLocker locker(&self->m_mutex);
+    return self->hasQueuedAboveLocked(t_priority);
+}
+
+JobScheduler::Stats JobScheduler::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    Stats s;
+    for (int p = 0; p < PriorityCount; ++p) {
+        s.queued[p] = 0;
+        for (const WorkerQueues &w : m_workers) s.queued[p] += int(w.queues[p].size());
+        s.running[p] = m_running[p];
+        s.completed[p] = m_completed[p];
+        s.averageWaitMs[p] = m_waitCount[p] ? m_waitTotalMs[p] / m_waitCount[p] : 0.0;
+        s.maxWaitMs[p] = m_waitMaxMs[p];
+    }
+
+    for (auto it = m_deferred.constBegin(); it != m_deferred.constEnd(); ++it) {
+        for (const Job &job : it.value()) ++s.queued[job.priority];
+    }
+
+    s.steals = m_steals;
+    return s;
+}
+
+void JobScheduler::shutdown()
+{
+    std::vector<Job> dropped;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+
+        for (WorkerQueues &w : m_workers) {
+            for (auto &q : w.queues) {
+                for (Job &job : q) dropped.push_back(std::move(job));
+                q.clear();
+            }
+        }
+        for (auto it = m_deferred.begin(); it != m_deferred.end(); ++it) {
+            for (Job &job : it.value()) dropped.push_back(std::move(job));
+        }
+        m_deferred.clear();
+        m_wake.wakeAll();
+    }
+
+    // 锁外结束被丢弃任务的 future（等待者被唤醒后可能立刻提交新任务）
+    for (Job &job : dropped) {
+        if (job.discard) job.discard();
+    }
+
+    for (QThread *t : m_threads) {
+        t->wait();
+        delete t;
+    }
+    m_threads.clear();
+}
+
+void JobScheduler::workerLoop(int index)
+{
+    t_scheduler = this;
+    t_workerIndex = index;
+
+    QMutexLocker locker(&m_mutex);
+    forever {
+        Job job;
+        while (!m_stopping && !takeJobLocked(index, &job)) {
+            m_wake.wait(&m_mutex);
+        }
+        if (m_stopping) return;
+
+        ++m_running[job.priority];
+        if (job.serialKey) m_busyKeys.insert(job.serialKey);
+        locker.unlock();
+
+        t_priority = job.priority;
+        job.fn();
+        t_priority = -1;
+
+        locker.relock();
+        --m_running[job.priority];
+        ++m_completed[job.priority];
+        if (job.serialKey) releaseKeyLocked(job.serialKey, index);
+    }
+}
+
+bool JobScheduler::takeJobLocked(int index, Job *job)
+{
+    const int n = int(m_workers.size());
+
+    // 0 号线程为可见页预留，不接缩略图/索引这类长任务
+    const int lowest = (index == 0) ? Prefetch : PriorityCount - 1;
+
+    for (int p = 0; p <= lowest; ++p) {
+        bool found = takeRunnableLocked(m_workers[size_t(index)].queues[p], false, job);
+
+        for (int k = 1; !found && k < n; ++k) {
+            const int victim = (index + k) % n;
+            found = takeRunnableLocked(m_workers[size_t(victim)].queues[p], true, job);
+            if (found) ++m_steals;
+        }
+
+        if (found) {
+            const double waitMs = (m_clock.nsecsElapsed() - job->enqueuedNs) / 1e6;
+            m_waitTotalMs[p] += waitMs;
+            m_waitMaxMs[p] = qMax(m_waitMaxMs[p], waitMs);
+            ++m_waitCount[p];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool JobScheduler::takeRunnableLocked(std::deque<Job> &queue, bool fromBack, Job *job)
+{
+    while (!queue.empty()) {
+        Job candidate;
+        if (fromBack) {
+            candidate = std::move(queue.back());
+            queue.pop_back();
+        } else {
+            candidate = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        // 同一 key 的任务正在执行：先挂起，等它结束再放回队列
+        if (candidate.serialKey && m_busyKeys.contains(candidate.serialKey)) {
+            m_deferred[candidate.serialKey].append(std::move(candidate));
+            continue;
+        }
+
+        *job = std::move(candidate);
+        return true;
+    }
+
+    return false;
+}
+
+void JobScheduler::releaseKeyLocked(const void *serialKey, int index)
+{
+    m_busyKeys.remove(serialKey);
+
+    auto it = m_deferred.find(serialKey);
+    if (it == m_deferred.end()) return;
+
+    // 放回优先级最高、最早提交的那个
+    QList<Job> &pending = it.value();
+    int best = 0;
+    for (int i = 1; i < pending.size(); ++i) {
+        if (pending[i].priority < pending[best].priority) best = i;
+    }
+
+    Job next = pending.takeAt(best);
+    if (pending.isEmpty()) m_deferred.erase(it);
+
+    m_workers[size_t(index)].queues[next.priority].push_front(std::move(next));
+    m_wake.wakeAll();
+}
+
+bool JobScheduler::hasQueuedAboveLocked(int priority) const
+{
+    for (int p = 0; p < priority; ++p) {
+        for (const WorkerQueues &w : m_workers) {
+            if (!w.queues[p].empty()) return true;
+        }
+    }
+
+    // 被同 key 任务挡住的也算：正在执行的长任务让出后它们才能运行
+    for (auto it = m_deferred.constBegin(); it != m_deferred.constEnd(); ++it) {
+        for (const Job &job : it.value()) {
+            if (job.priority < priority) return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,138 @@
+﻿#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QFuture>
+#include <QFutureInterface>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QSet>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+class QThread;
+
+// 后台任务调度器（替代直接 QtConcurrent::run 到全局线程池）
+// - 按优先级分类：可见页 > 预取 > 缩略图 > 索引
+// - 每个工作线程有自己的队列，提交时就近入队，空闲线程从别人队尾“偷”任务
+// - serialKey 相同（例如同一个文档）的任务串行执行，忙时暂存到等待队列
+// - 0 号线程只接可见页/预取任务，保证可见页不会被长任务占满线程
+// - 长任务在循环中调用 shouldYield()，有更高优先级任务排队时主动让出（协作式抢占）
+class JobScheduler
+{
+public:
+    enum Priority {
+        Visible = 0,    // 当前可见页
+        Prefetch,       // 预取（相邻页、链接目标等）
+        Thumbnail,      // 缩略图
+        Indexing,       // 文本索引等长时间任务
+        PriorityCount
+    };
+
+    struct Stats {
+        int queued[PriorityCount];
+        int running[PriorityCount];
+        quint64 completed[PriorityCount];
+        double averageWaitMs[PriorityCount];
+        double maxWaitMs[PriorityCount];
+        quint64 steals;
+    };
+
+    static JobScheduler *instance();
+
+    explicit JobScheduler(int workerCount = 0);
+    ~JobScheduler();
+
+    QFuture<void> run(Priority priority, const void *serialKey, std::function<void()> fn);
+
+    template <typename T>
+    QFuture<T> run(Priority priority, const void *serialKey, std::function<T()> fn);
+
+    // fn 自己 reportResult / 汇报进度，并通过 iface.isCanceled() 响应取消
+    template <typename T>
+    QFuture<T> runControlled(Priority priority, const void *serialKey,
+                             std::function<void(QFutureInterface<T> &)> fn);
+
+    // 在工作线程内调用：是否有更高优先级的任务在排队
+    static bool shouldYield();
+
+    Stats stats() const;
+
+    // 丢弃未开始的任务（它们的 future 标记为取消并结束，等待者不会卡住），等待正在执行的任务结束
+    void shutdown();
+
+private:
+    struct Job {
+        std::function<void()> fn;
+        std::function<void()> discard;  // 没执行就被丢弃时调用：取消并结束 future
+        Priority priority = Indexing;
+        const void *serialKey = nullptr;
+        qint64 enqueuedNs = 0;
+    };
+
+    struct WorkerQueues {
+        std::deque<Job> queues[PriorityCount];
+    };
+
+    void submit(Priority priority, const void *serialKey, std::function<void()> fn,
+                std::function<void()> discard);
+    void workerLoop(int index);
+
+    bool takeJobLocked(int index, Job *job);
+    bool takeRunnableLocked(std::deque<Job> &queue, bool fromBack, Job *job);
+    void releaseKeyLocked(const void *serialKey, int index);
+    bool hasQueuedAboveLocked(int priority) const;
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QElapsedTimer m_clock;
+
+    std::vector<QThread*> m_threads;
+    std::vector<WorkerQueues> m_workers;
+    int m_nextWorker = 0;
+    bool m_stopping = false;
+
+    QSet<const void*> m_busyKeys;
+    QHash<const void*, QList<Job>> m_deferred;
+
+    int m_running[PriorityCount] = {};
+    quint64 m_completed[PriorityCount] = {};
+    quint64 m_waitCount[PriorityCount] = {};
+    double m_waitTotalMs[PriorityCount] = {};
+    double m_waitMaxMs[PriorityCount] = {};
+    quint64 m_steals = 0;
+};
+
+template <typename T>
+QFuture<T> JobScheduler::run(Priority priority, const void *serialKey, std::function<T()> fn)
+{
+    return runControlled<T>(priority, serialKey, [fn](QFutureInterface<T> &iface) {
+        iface.reportResult(fn());
+    });
+}
+
+template <typename T>
+QFuture<T> JobScheduler::runControlled(Priority priority, const void *serialKey,
+                                       std::function<void(QFutureInterface<T> &)> fn)
+{
+    QFutureInterface<T> iface;
+    iface.reportStarted();
+    QFuture<T> future = iface.future();
+
+    submit(priority, serialKey, [iface, fn]() mutable {
+        if (!iface.isCanceled()) fn(iface);
+        iface.reportFinished();
+    }, [iface]() mutable {
+        iface.reportCanceled();
+        iface.reportFinished();
+    });
+
+    return future;
+}
+
+#endif // JOBSCHEDULER_H
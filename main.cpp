@@ -1,10 +1,138 @@
 ﻿#include "mainwindow.h"
+#include "pdfiumruntime.h"
+#include "jobscheduler.h"
+#include "pdfsource.h"
+#include "singleinstance.h"
+#include "textexporter.h"
+
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QThread>
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
-    MainWindow w;
-    w.show();
-    return a.exec();
+    // 首帧耗时从这里算起
+    const qint64 launchEpochMs = QDateTime::currentMSecsSinceEpoch();
+
+    // 启动各阶段的耗时（从进程启动算起）
+    auto logPhase = [launchEpochMs](const char *phase) {
+        qInfo().noquote() << QStringLiteral("启动阶段 %1：%2 ms")
+                             .arg(QLatin1String(phase))
+                             .arg(QDateTime::currentMSecsSinceEpoch() - launchEpochMs);
+    };
+
+    // 无界面导出用不到窗口系统：先看一眼参数，只建 QCoreApplication（没有显示器的机器、SSH 里也能跑）
+    bool headless = false;
+    for (int i = 1; i < argc; ++i) {
+        const QByteArray arg(argv[i]);
+        if (arg == "--") break;
+        if (arg == "--export-text" || arg.startsWith("--export-text=")) headless = true;
+    }
+
+    QScopedPointer<QCoreApplication> app(headless ? new QCoreApplication(argc, argv)
+                                                  : new QApplication(argc, argv));
+    QCoreApplication::setApplicationName(QStringLiteral("PdfReader"));
+    logPhase("QApplication");
+
+    // 1. 命令行：pdfviewer [--new-instance] [文件]，或 pdfviewer --export-text <输出> [-j N] 文件
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("无边框 PDF 阅读器"));
+    parser.addHelpOption();
+    QCommandLineOption newInstance(QStringList() << "n" << "new-instance",
+                                   QStringLiteral("不交给已运行的实例，单独启动一个窗口"));
+    parser.addOption(newInstance);
+    QCommandLineOption exportText(QStringList() << "export-text",
+                                  QStringLiteral("不打开窗口：把文件的全部文字以 UTF-8 写到 <output>（- 为标准输出）后退出"),
+                                  QStringLiteral("output"));
+    parser.addOption(exportText);
+    QCommandLineOption jobs(QStringList() << "j" << "jobs",
+                            QStringLiteral("导出文字的工作线程数（默认 1）"),
+                            QStringLiteral("n"));
+    parser.addOption(jobs);
+    parser.addPositionalArgument(QStringLiteral("file"),
+                                 QStringLiteral("要打开的 PDF（本地路径、http(s) 地址或 archive.zip!/entry.pdf）"),
+                                 QStringLiteral("[file]"));
+    parser.process(*app);
+
+    // 相对路径按本进程的工作目录解析，交给别的实例后才不会找错
+    QStringList files;
+    for (const QString &arg : parser.positionalArguments()) {
+        files << (PdfSource::isRemote(arg) ? arg : QFileInfo(arg).absoluteFilePath());
+    }
+
+    // 无界面导出：不经过单实例，也不建窗口
+    if (parser.isSet(exportText)) {
+        if (files.isEmpty()) {
+            qCritical().noquote() << QStringLiteral("--export-text 需要指定要导出的 PDF");
+            return 2;
+        }
+
+        TextExporter::Options options;
+        options.workers = parser.value(jobs).toInt();
+        TextExporter exporter(files.first(), options);
+
+        QElapsedTimer timer;
+        timer.start();
+        const bool ok = exporter.exportTo(parser.value(exportText));
+        if (ok) {
+            qInfo().noquote() << QStringLiteral("已导出 %1 页文字，耗时 %2 ms").arg(exporter.pageCount()).arg(timer.elapsed());
+        } else {
+            qCritical().noquote() << exporter.errorString();
+        }
+
+        JobScheduler::instance()->shutdown();
+        PdfiumRuntime::instance()->shutdown();
+        return ok ? 0 : 1;
+    }
+
+    // 2. 单实例：已有实例在运行就把文件交给它（它的 PDFium、字体和缓存都是热的）
+    //    两个进程几乎同时启动时，一个 listen 成功，另一个 listen 失败：失败的一方回头再转交一次。
+    //    对方可能还没开始接受连接，间隔几次再试；都不行才独立运行（此时不接收别的进程转来的文件）
+    SingleInstance instance;
+    if (!parser.isSet(newInstance)) {
+        bool primary = false;
+        for (int attempt = 0; attempt < 3 && !primary; ++attempt) {
+            if (instance.forwardToRunning(files, launchEpochMs)) return 0;
+            primary = instance.listen();
+            if (!primary) QThread::msleep(100 * (attempt + 1));
+        }
+        if (!primary) qWarning() << "Single instance: neither forwarding nor listening succeeded, running standalone";
+    }
+    logPhase("single instance");
+
+    // 3. 确定要自己启动了：PDFium 初始化和系统字体枚举马上在后台线程开始，
+    //    与窗口构造、会话恢复并行；首个文档的加载任务会排在它后面
+    PdfiumRuntime::instance()->initializeAsync();
+
+    int ret = 0;
+    {
+        MainWindow w;
+        logPhase("window constructed");
+
+        // 在 show 之前恢复几何与会话：有启动快照时它就是第一帧
+        w.loadSession(files.value(0), launchEpochMs);
+        logPhase("session restored");
+
+        QObject::connect(&instance, &SingleInstance::activateRequested,
+                         &w, &MainWindow::activateFromOtherInstance);
+        QObject::connect(&instance, &SingleInstance::openRequested,
+                         &w, [&w](const QStringList &requested, qint64 requestLaunchMs) {
+            w.openFile(requested.first(), requestLaunchMs);
+        });
+
+        w.show();
+        logPhase("window shown");
+        ret = app->exec();
+    }
+
+    // 窗口（及其文档）销毁、后台渲染结束后再释放 PDFium 全局资源
+    JobScheduler::instance()->shutdown();
+    PdfiumRuntime::instance()->shutdown();
+    return ret;
 }
@@ -2,8 +2,15 @@
 #include "ui_mainwindow.h"
 
 #include "pdfdocument.h"
+#include "imageresampler.h"
+#include "jobscheduler.h"
+#include "pageoverlay.h"
+#include "pdfsource.h"
+#include "textexporter.h"
+#include "zippdfsource.h"
 
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QKeyEvent>
 #include <QWheelEvent>
 #include <QResizeEvent>
@@ -16,20 +23,33 @@
 #include <QLineEdit>
 #include <QHBoxLayout>
 #include <QIntValidator>
+#include <QMessageBox>
+#include <QPushButton>
 
 #include <QApplication>
+#include <QClipboard>
 #include <QEvent>
 #include <QCursor>
+#include <QDesktopServices>
+#include <QMouseEvent>
 
 #include <QSettings>
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+#include <QFile>
 #include <QFileInfo>
 #include <QStandardPaths> // 用于获取默认系统路径
+#include <QUrl>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
 #include <windowsx.h>
 #endif
 
+// 复制全文时每个任务最多抽取的页数（之后重新排队，渲染可以插进来）
+static const int kCopyChunkPages = 32;
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
@@ -60,18 +80,28 @@ MainWindow::MainWindow(QWidget *parent)
         ui->centralwidget->layout()->setSizeConstraint(QLayout::SetNoConstraint);
     }
     ui->lblReader->setFocusPolicy(Qt::NoFocus);
+    ui->lblReader->setMouseTracking(true);      // 悬停在字上时显示文本光标
     ui->lblReader->setText(QStringLiteral(
         "按 Ctrl+O 打开 PDF\n"
         "←/→ 或滚轮翻页，Ctrl+滚轮缩放\n"
-        "Tab 显示/隐藏页码条，Ctrl+G 跳页，Esc 退出\n"
+        "Tab 显示/隐藏页码条，Ctrl+G 跳页，Ctrl+F 搜索，Esc 退出\n"
         "（无边框窗口：顶部可拖动，边缘可缩放）"
     ));
 
+    // 覆盖层：搜索命中画在页面图片上面
+    m_overlay = new PageOverlay(ui->lblReader);
+    m_overlay->setGeometry(ui->lblReader->rect());
+    m_overlay->show();
+
     // 页码条（默认隐藏）
     setupPageBar();
     updatePageBar();
     setPageBarVisible(false);
 
+    // 搜索条（默认隐藏）
+    setupSearchBar();
+    setSearchBarVisible(false);
+
     // ✅ 全局拦截 Ctrl+滚轮：必须装在 qApp 上
     qApp->installEventFilter(this);
 
@@ -79,6 +109,10 @@ MainWindow::MainWindow(QWidget *parent)
     auto *scOpen = new QShortcut(QKeySequence::Open, this);
     connect(scOpen, &QShortcut::activated, this, &MainWindow::openPdf);
 
+    // Ctrl+Shift+O 打开网址（文档服务器上的 PDF，按需 Range 读取）
+    auto *scOpenUrl = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_O), this);
+    connect(scOpenUrl, &QShortcut::activated, this, &MainWindow::openUrl);
+
     // Esc 退出
     auto *scEsc = new QShortcut(QKeySequence(Qt::Key_Escape), this);
     connect(scEsc, &QShortcut::activated, this, [this](){ close(); });
@@ -102,18 +136,76 @@ MainWindow::MainWindow(QWidget *parent)
         }
     });
 
+    // Ctrl+F：显示搜索条并聚焦输入框；F3 / Shift+F3 下一处 / 上一处
+    auto *scFind = new QShortcut(QKeySequence::Find, this);
+    connect(scFind, &QShortcut::activated, this, [this](){
+        setSearchBarVisible(true);
+        m_searchEdit->setFocus();
+        m_searchEdit->selectAll();
+    });
+    auto *scNextHit = new QShortcut(QKeySequence(Qt::Key_F3), this);
+    connect(scNextHit, &QShortcut::activated, this, [this](){ stepHit(1); });
+    auto *scPrevHit = new QShortcut(QKeySequence(Qt::SHIFT + Qt::Key_F3), this);
+    connect(scPrevHit, &QShortcut::activated, this, [this](){ stepHit(-1); });
+
+    // Ctrl+C 复制选中的文字，Ctrl+A 选中本页，Ctrl+Shift+C 复制全文
+    // （搜索框有焦点时，这些按键由输入框自己处理）
+    auto *scCopy = new QShortcut(QKeySequence::Copy, this);
+    connect(scCopy, &QShortcut::activated, this, &MainWindow::copySelection);
+    auto *scSelectAll = new QShortcut(QKeySequence::SelectAll, this);
+    connect(scSelectAll, &QShortcut::activated, this, &MainWindow::selectAllOnPage);
+    auto *scCopyAll = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_C), this);
+    connect(scCopyAll, &QShortcut::activated, this, &MainWindow::copyDocumentText);
+    auto *scExportText = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_E), this);
+    connect(scExportText, &QShortcut::activated, this, &MainWindow::exportDocumentText);
+
+    // Ctrl+Shift+I：查看/导出当前文档的 I/O 统计
+    auto *scIo = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_I), this);
+    connect(scIo, &QShortcut::activated, this, &MainWindow::showIoStats);
+
     // 绑定异步结果回调
     connect(&m_renderWatcher, &QFutureWatcher<QImage>::finished,
                 this, &MainWindow::handleRenderFinished);
+    connect(&m_loadWatcher, &QFutureWatcher<bool>::finished,
+                this, &MainWindow::handleLoadFinished);
+    connect(&m_loadWatcher, &QFutureWatcher<bool>::progressTextChanged, this, [this](const QString &text) {
+        if (m_snapshotShown) return;    // 启动快照在上屏，别用进度文字盖掉它
+        ui->lblReader->setText(QStringLiteral("正在打开 %1 … %2")
+                               .arg(QFileInfo(m_loadingFile).fileName(), text));
+    });
 
+    // 当前文件被改写时自动重新加载
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(500);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &MainWindow::reloadDocument);
+    connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged, this, [this]() { m_reloadTimer.start(); });
+    connect(&m_reloadWatcher, &QFutureWatcher<PdfReloadResult>::finished,
+                this, &MainWindow::handleReloadFinished);
+
+    // 索引进度在工作线程发出，排队到这里：对新建好的页继续查当前查询
+    connect(&m_textIndex, &TextIndex::progress, this, &MainWindow::handleIndexProgress);
+    connect(&m_highlightWatcher, &QFutureWatcher<QVector<QVector<QRectF>>>::finished,
+                this, &MainWindow::handleHighlightsFinished);
+    connect(&m_layoutWatcher, &QFutureWatcher<QSharedPointer<const TextLayout>>::finished,
+                this, &MainWindow::handleLayoutFinished);
+    connect(&m_linksWatcher, &QFutureWatcher<QSharedPointer<const PageLinks>>::finished,
+                this, &MainWindow::handleLinksFinished);
+    connect(&m_exportWatcher, &QFutureWatcher<QString>::finished, this, &MainWindow::handleExportFinished);
+    connect(&m_exportWatcher, &QFutureWatcher<QString>::progressValueChanged, this, [this](int page) {
+        showToast(QStringLiteral("正在导出文字… %1 / %2 页").arg(page).arg(m_exportWatcher.progressMaximum()));
+    });
+
+    m_toastTimer.setSingleShot(true);
 
-    // 延迟一点点调用，确保 UI 布局已完成计算（可选）
-    QTimer::singleShot(100, this, &MainWindow::loadSession);
 
 }
 
 void MainWindow::handleRenderFinished()
 {
+    // 被取消的任务没有结果；期间已从热缓存直接上屏的，这次结果已过时
+    if (m_renderWatcher.isCanceled() || m_renderWatcher.future().resultCount() == 0) return;
+    if (m_renderingPage < 0) return;
+
     // 获取异步计算生成的图片
     QImage img = m_renderWatcher.result();
 
@@ -122,13 +214,31 @@ void MainWindow::handleRenderFinished()
         return;
     }
 
+    m_displayedPage = m_renderingPage;
+    showPageImage(img);
+}
+
+void MainWindow::showPageImage(const QImage &img)
+{
     // 更新 UI（必须在主线程执行，handleRenderFinished 由信号触发，符合要求）
-    QPixmap pm = QPixmap::fromImage(img);
-    ui->lblReader->setPixmap(pm.scaled(
-        ui->lblReader->size(),
-        Qt::KeepAspectRatio,
-        Qt::SmoothTransformation
-    ));
+    // 图片已在工作线程缩放到显示区大小，这里只做上屏
+    ui->lblReader->setPixmap(QPixmap::fromImage(img));
+    m_displayedImage = img;
+    m_snapshotShown = false;
+
+    // 覆盖层跟着图片走；命中框是归一化坐标，换页、缩放后只需重画
+    m_overlay->setGeometry(ui->lblReader->rect());
+    m_overlay->setImageRect(displayedImageRect());
+    updateHighlights();
+    requestTextLayout();
+    requestPageLinks();
+
+    // 启动或从其他实例转来的文件：记录从进程启动到首帧上屏的耗时
+    if (m_firstPixelLaunchMs > 0) {
+        qInfo() << "Time to first pixel:" << (QDateTime::currentMSecsSinceEpoch() - m_firstPixelLaunchMs)
+                << "ms" << m_currentFile;
+        m_firstPixelLaunchMs = 0;
+    }
 
     // 更新状态栏/标题
     int total = m_pdf->pageCount();
@@ -138,6 +248,28 @@ void MainWindow::handleRenderFinished()
 
 MainWindow::~MainWindow()
 {
+    // 后台任务引用了 this，先等它结束
+    m_renderWatcher.cancel();
+    m_renderWatcher.waitForFinished();
+    m_loadWatcher.cancel();
+    m_loadWatcher.waitForFinished();
+    m_reloadWatcher.cancel();
+    m_reloadWatcher.waitForFinished();
+    m_highlightWatcher.cancel();
+    m_highlightWatcher.waitForFinished();
+    cancelHitPrefetch();
+    for (QFuture<void> &job : m_hitPrefetchJobs) job.waitForFinished();
+    m_layoutWatcher.cancel();
+    m_layoutWatcher.waitForFinished();
+    m_linksWatcher.cancel();
+    m_linksWatcher.waitForFinished();
+    m_linkPrefetchJob.cancel();
+    m_linkPrefetchJob.waitForFinished();
+    cancelDocumentCopy();
+    for (QFuture<void> &job : m_copyJobs) job.waitForFinished();
+    m_exportWatcher.cancel();
+    m_exportWatcher.waitForFinished();
+
     // 解除全局过滤器（严谨）
     qApp->removeEventFilter(this);
     delete ui;
@@ -157,29 +289,221 @@ void MainWindow::openPdf()
         this,
         QStringLiteral("选择 PDF 文件"),
         lastDir, // 使用上次的路径
-        QStringLiteral("PDF Files (*.pdf)")
+        QStringLiteral("PDF Files (*.pdf);;ZIP 压缩包 (*.zip);;All Files (*)")
     );
 
     if (file.isEmpty()) return;
 
-    // 4. 加载 PDF 逻辑
-    if (!m_pdf) m_pdf = new PdfDocument(this);
+    // 压缩包：直接读里面的 PDF，有多个时让用户选
+    if (file.endsWith(QLatin1String(".zip"), Qt::CaseInsensitive)) {
+        QString error;
+        const QStringList entries = ZipPdfSource::pdfEntries(file, &error);
+        if (entries.isEmpty()) {
+            QMessageBox::warning(this, QStringLiteral("打开压缩包"),
+                                 error.isEmpty() ? QStringLiteral("压缩包里没有 PDF 文件") : error);
+            return;
+        }
+
+        QString entry = entries.first();
+        if (entries.size() > 1) {
+            bool ok = false;
+            entry = QInputDialog::getItem(this, QStringLiteral("打开压缩包"),
+                                          QStringLiteral("选择要打开的 PDF："), entries, 0, false, &ok);
+            if (!ok) return;
+        }
+        file = ZipPdfSource::makeLocation(file, entry);
+    }
+
+    // 4. 后台加载 PDF，窗口保持响应；成功后在 handleLoadFinished 里更新状态
+    startLoad(file, 0, 1.5);
+}
+
+void MainWindow::openUrl()
+{
+    QSettings settings("MyCompany", "PdfReader");
+
+    bool ok = false;
+    const QString url = QInputDialog::getText(
+        this,
+        QStringLiteral("打开网址"),
+        QStringLiteral("PDF 地址（http:// 或 https://）："),
+        QLineEdit::Normal,
+        settings.value("last_url").toString(),
+        &ok
+    ).trimmed();
+
+    if (!ok || url.isEmpty()) return;
+    if (!PdfSource::isRemote(url)) {
+        QMessageBox::warning(this, QStringLiteral("打开网址"), QStringLiteral("只支持 http:// 或 https:// 地址"));
+        return;
+    }
+
+    settings.setValue("last_url", url);
+    startLoad(url, 0, 1.5);
+}
+
+void MainWindow::startLoad(const QString &file, int page, double scale)
+{
+    if (!m_pdf) {
+        m_pdf = new PdfDocument(this);
+        // 打开的本地文件都会被监视改动：不做内存映射，免得挡住别的程序保存（Windows），
+        // 或文件被截短后访问映射区崩溃（Linux 上的 SIGBUS）
+        m_pdf->setMemoryMappingEnabled(false);
+    }
+
+    // 作废进行中的渲染、上一次尚未完成的加载和自动重新加载
+    m_renderWatcher.cancel();
+    m_loadWatcher.cancel();
+    m_reloadWatcher.cancel();
+    m_reloadTimer.stop();
+    cancelHitPrefetch();
+    cancelDocumentCopy();
+    resetTextLayout();
+    resetPageLinks();
+
+    // 旧文档的索引作废（查询保留，新文档建索引时继续查）
+    m_textIndex.clear();
+    resetSearchResults();
+
+    m_displayedPage = -1;
+    m_snapshotShown = false;
+    m_loadingFile = file;
+    m_loadingPage = page;
+    m_loadingScale = scale;
+
+    ui->lblReader->setText(QStringLiteral("正在打开 %1 …").arg(QFileInfo(file).fileName()));
+
+    // 后台加载，进度按读取的字节数汇报；文档句柄一到手，就在同一个任务里先渲染要显示的页：
+    // 同一文档的任务串行，预取、指纹等后台任务都排在它后面
+    m_loadWatcher.setFuture(JobScheduler::instance()->runControlled<bool>(
+                JobScheduler::Visible, m_pdf, [this, file, page, scale](QFutureInterface<bool> &iface) {
+        const bool ok = m_pdf->load(file, &iface);
+
+        // 缓存里可能还有旧文档的页面
+        if (ok) m_pageCache.clear();
+
+        if (ok && !iface.isCanceled()) {
+            const int first = qBound(0, page, m_pdf->pageCount() - 1);
+            iface.setProgressValueAndText(1000, QStringLiteral("渲染第 %1 页").arg(first + 1));
+
+            const QImage img = m_pdf->renderPage(first, scale, &iface);
+            if (!img.isNull() && !iface.isCanceled()) m_pageCache.insert(PageCache::keyFor(first, scale), img);
+        }
+
+        iface.reportResult(ok);
+    }));
+}
 
-    if (!m_pdf->load(file)) {
-        ui->lblReader->setText(QStringLiteral("PDF 加载失败"));
+void MainWindow::handleLoadFinished()
+{
+    // 被新的加载请求取代
+    if (m_loadWatcher.isCanceled()) return;
+
+    const bool ok = m_loadWatcher.future().resultCount() > 0 && m_loadWatcher.result();
+    if (!ok) {
+        m_firstPixelLaunchMs = 0;
+        m_snapshotShown = false;
+
+        // 打不开时原来的文档还在（PdfDocument 只在新文件打开成功后才替换）：提示一下，接着显示它
+        if (!m_currentFile.isEmpty() && m_pdf->pageCount() > 0) {
+            showToast(QStringLiteral("无法打开 %1").arg(QFileInfo(m_loadingFile).fileName()));
+            renderCurrentPage();
+            m_textIndex.start(m_pdf);
+            handleIndexProgress();
+        } else {
+            ui->lblReader->setText(QStringLiteral("PDF 加载失败"));
+        }
         return;
     }
 
-    // 5. 成功打开后，提取目录并持久化存储 (Persistence)
-    QFileInfo fileInfo(file);
-    settings.setValue("last_dir", fileInfo.absolutePath());
+    // 1. 成功打开后，提取目录并持久化存储 (Persistence)
+    const QString localFile = PdfSource::localFile(m_loadingFile);
+    if (!localFile.isEmpty()) {
+        QSettings settings("MyCompany", "PdfReader");
+        settings.setValue("last_dir", QFileInfo(localFile).absolutePath());
+    }
 
-    // 6. 更新状态
-    m_currentFile = file;
-    m_currentPage = 0;
-    m_scale = 1.5;
+    // 2. 更新状态（首页已在加载任务里渲染进缓存）
+    m_currentFile = m_loadingFile;
+    m_currentPage = m_loadingPage;
+    m_scale = m_loadingScale;
 
+    watchCurrentFile();
     renderCurrentPage();
+
+    // 3. 后台建立全文索引（最低优先级，不影响翻页）；上次留下的索引文件立即可用
+    m_textIndex.start(m_pdf);
+    handleIndexProgress();
+}
+
+void MainWindow::watchCurrentFile()
+{
+    if (!m_fileWatcher.files().isEmpty()) m_fileWatcher.removePaths(m_fileWatcher.files());
+
+    // 远程文件不监视；压缩包里的 PDF 监视压缩包本身
+    const QString localFile = PdfSource::localFile(m_currentFile);
+    if (!localFile.isEmpty() && QFile::exists(localFile)) m_fileWatcher.addPath(localFile);
+}
+
+void MainWindow::reloadDocument()
+{
+    if (!m_pdf || m_currentFile.isEmpty()) return;
+
+    // 正在打开别的文件，或上一次重新加载还没结束：稍后再来
+    if (m_loadWatcher.isRunning() || m_reloadWatcher.isRunning()) {
+        m_reloadTimer.start();
+        return;
+    }
+
+    const QString file = m_currentFile;
+    m_renderWatcher.cancel();
+    cancelHitPrefetch();
+    cancelDocumentCopy();
+    resetTextLayout();
+    resetPageLinks();
+
+    // 文字可能变了：索引和结果都重来
+    m_textIndex.clear();
+    resetSearchResults();
+
+    // 和渲染任务同一个串行 key：重新加载完成前不会有渲染插进来
+    m_reloadWatcher.setFuture(JobScheduler::instance()->runControlled<PdfReloadResult>(
+                JobScheduler::Visible, m_pdf, [this, file](QFutureInterface<PdfReloadResult> &iface) {
+        PdfReloadResult result = m_pdf->reload(file);
+
+        // 在同一个任务里清理缓存，之后排队的渲染不会拿到改写前的页面
+        if (result.ok) m_pageCache.retainPages(result.unchangedPages);
+        else m_pageCache.clear();
+
+        iface.reportResult(result);
+    }));
+}
+
+void MainWindow::handleReloadFinished()
+{
+    if (m_reloadWatcher.isCanceled() || m_reloadWatcher.future().resultCount() == 0) return;
+
+    const PdfReloadResult result = m_reloadWatcher.result();
+    if (!result.ok) {
+        // 文件可能还没写完：隔一会儿再试几次
+        if (++m_reloadRetries <= 5) {
+            m_reloadTimer.start();
+        } else {
+            m_reloadRetries = 0;
+            ui->lblReader->setText(QStringLiteral("文件已改变，重新加载失败"));
+        }
+        return;
+    }
+
+    m_reloadRetries = 0;
+
+    // 原子替换（写临时文件再改名）后监视会失效，重新登记
+    watchCurrentFile();
+
+    // 页码、缩放保持不变；页数变少时 renderCurrentPage 会修正页码
+    renderCurrentPage();
+    m_textIndex.start(m_pdf);
+    handleIndexProgress();
 }
 
 void MainWindow::renderCurrentPage()
@@ -189,27 +513,55 @@ void MainWindow::renderCurrentPage()
     // 1. 边界修正
     m_currentPage = qBound(0, m_currentPage, m_pdf->pageCount() - 1);
 
-    // 2. 如果当前正在渲染同一页，则不再重复发起
-    if (m_renderWatcher.isRunning() && m_renderingPage == m_currentPage) {
+    // 2. 如果当前正在渲染同一页（同倍率、同显示尺寸），则不再重复发起
+    const QSize target = ui->lblReader->size();
+    if (m_renderWatcher.isRunning() && m_renderingPage == m_currentPage &&
+        m_renderingScale == m_scale && m_renderingTarget == target) {
         return;
     }
 
-    // 3. 准备渲染参数
-    // 注意：lambda 捕获变量必须是值捕获，确保线程安全
+    // 3. 热缓存命中：在这里缩放后直接上屏，不经过调度器
+    //    （同一文档的串行队列里可能正排着预取、索引任务，翻到已渲染过的页不必等它们）
     int pageIdx = m_currentPage;
     double scale = m_scale;
+    const PageCacheKey key = PageCache::keyFor(pageIdx, scale);
+    const QImage hot = m_pageCache.findHot(key);
+    if (!hot.isNull()) {
+        m_renderWatcher.cancel();
+        m_renderingPage = -1;
+        m_displayedPage = pageIdx;
+        showPageImage(ImageResampler::fit(hot, target));
+        return;
+    }
+
+    // 4. 准备渲染参数
+    // 注意：lambda 捕获变量必须是值捕获，确保线程安全
     m_renderingPage = pageIdx;
+    m_renderingScale = scale;
+    m_renderingTarget = target;
+
+    // 5. 发起异步任务：可见页优先级最高，同一文档的任务串行执行
+    QFuture<QImage> future = JobScheduler::instance()->runControlled<QImage>(
+                JobScheduler::Visible, m_pdf,
+                [this, pageIdx, scale, key, target](QFutureInterface<QImage> &iface) {
+        // 此处在后台线程执行：缓存命中（冷层在这里解压）则跳过渲染
+        QImage img = m_pageCache.lookup(key);
+        if (img.isNull()) {
+            // 被新的翻页/缩放取代时，渲染会在 PDFium 暂停点中止
+            img = m_pdf->renderPage(pageIdx, scale, &iface);
+            if (iface.isCanceled()) return;
+            m_pageCache.insert(key, img);
+        }
 
-    // 4. 发起异步任务 (QtConcurrent::run)
-    // 使用线程池执行耗时的 PDF 渲染逻辑
-    QFuture<QImage> future = QtConcurrent::run([this, pageIdx, scale]() {
-        // 此处在后台线程执行
-        return m_pdf->renderPage(pageIdx, scale);
+        // 缩放到显示区大小也放在后台，GUI 线程只负责上屏
+        iface.reportResult(ImageResampler::fit(img, target));
     });
 
+    // 旧任务若还在排队就直接作废
+    m_renderWatcher.cancel();
     m_renderWatcher.setFuture(future);
 
-    // 5. UI 反馈：可以显示一个轻量的加载提示
+    // 6. UI 反馈：可以显示一个轻量的加载提示
     // ui->lblReader->setText(QStringLiteral("渲染中..."));
 }
 
@@ -217,6 +569,11 @@ void MainWindow::renderCurrentPage()
 void MainWindow::resizeEvent(QResizeEvent *event)
 {
     QMainWindow::resizeEvent(event);
+    updateSearchBar();
+
+    // 图片在显示区里居中：新图渲染出来之前，覆盖层先跟着旧图的位置
+    m_overlay->setGeometry(ui->lblReader->rect());
+    m_overlay->setImageRect(displayedImageRect());
 
     if (m_pdf && !m_currentFile.isEmpty()) {
         renderCurrentPage();
@@ -291,6 +648,19 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event)
 {
     Q_UNUSED(watched);
 
+    // 搜索框里按 Esc 只收起搜索条，不触发 Esc 退出
+    if (event->type() == QEvent::ShortcutOverride && watched == m_searchEdit &&
+        static_cast<QKeyEvent*>(event)->key() == Qt::Key_Escape) {
+        setSearchBarVisible(false);
+        event->accept();
+        return true;
+    }
+
+    // 显示区上的鼠标：选择文字
+    if (watched == ui->lblReader && handleReaderMouse(event)) {
+        return true;
+    }
+
     if (event->type() != QEvent::Wheel) {
         return QMainWindow::eventFilter(watched, event);
     }
@@ -440,8 +810,850 @@ void MainWindow::togglePageBar()
     setPageBarVisible(!m_pageBarVisible);
 }
 
+// ---------------- 搜索条 ----------------
+
+void MainWindow::setupSearchBar()
+{
+    m_searchBar = new QWidget(this);
+    m_searchBar->setObjectName("searchBar");
+    m_searchBar->setFocusPolicy(Qt::NoFocus);
+
+    m_searchBar->setStyleSheet(
+        "#searchBar { background: rgba(0,0,0,150); border-radius: 10px; }"
+        "QLabel { color: white; }"
+        "QLineEdit { color: white; background: rgba(255,255,255,30); border: 1px solid rgba(255,255,255,60); "
+        "border-radius: 6px; padding: 4px 6px; }"
+    );
+
+    auto *layout = new QHBoxLayout(m_searchBar);
+    layout->setContentsMargins(10, 8, 10, 8);
+    layout->setSpacing(8);
+
+    m_searchEdit = new QLineEdit(m_searchBar);
+    m_searchEdit->setPlaceholderText(QStringLiteral("搜索（~ 开头为模糊搜索，回车下一处）"));
+    m_searchEdit->setFixedWidth(260);
+    m_searchEdit->setClearButtonEnabled(true);
+
+    m_searchLabel = new QLabel(m_searchBar);
+    m_searchLabel->setFocusPolicy(Qt::NoFocus);
+
+    layout->addWidget(m_searchEdit);
+    layout->addWidget(m_searchLabel);
+
+    m_searchBar->adjustSize();
+    m_searchBar->hide();
+    m_searchBarVisible = false;
+
+    // 边打边搜：停顿一下再查，连续输入时不会每个字都跳页
+    m_searchTimer.setSingleShot(true);
+    m_searchTimer.setInterval(120);
+    connect(m_searchEdit, &QLineEdit::textEdited, this, [this](){ m_searchTimer.start(); });
+    connect(&m_searchTimer, &QTimer::timeout, this, [this](){
+        if (m_searchEdit->text() != m_searchQuery) runSearch(m_searchEdit->text());
+    });
+
+    // 查询变了就重新查，没变就跳到下一处（按住 Shift 跳上一处）
+    connect(m_searchEdit, &QLineEdit::returnPressed, this, [this](){
+        if (m_searchEdit->text() != m_searchQuery) {
+            runSearch(m_searchEdit->text());
+        } else {
+            stepHit((QApplication::keyboardModifiers() & Qt::ShiftModifier) ? -1 : 1);
+        }
+    });
+}
+
+void MainWindow::updateSearchBar()
+{
+    if (!m_searchBar) return;
+
+    if (m_searchLabel) {
+        QString text;
+        if (!m_searchQuery.isEmpty()) {
+            text = m_searchHits.isEmpty()
+                    ? QStringLiteral("无结果")
+                    : QStringLiteral("%1 / %2").arg(m_searchCurrent + 1).arg(m_searchHits.size());
+        }
+
+        const int total = m_textIndex.pageCount();
+        const int indexed = m_textIndex.indexedPages();
+        if (total > 0 && indexed < total) {
+            text += QStringLiteral("（已索引 %1 / %2 页）").arg(indexed).arg(total);
+        }
+        m_searchLabel->setText(text);
+    }
+
+    const int margin = 16;
+    const int safe = 10;
+
+    m_searchBar->adjustSize();
+    int x = width() - m_searchBar->width() - margin - safe;
+    m_searchBar->move(qMax(0, x), margin + safe);
+
+    if (m_searchBarVisible) m_searchBar->raise();
+}
+
+void MainWindow::setSearchBarVisible(bool visible)
+{
+    m_searchBarVisible = visible;
+    if (!m_searchBar) return;
+
+    if (visible) {
+        updateSearchBar();
+        m_searchBar->show();
+        m_searchBar->raise();
+    } else {
+        m_searchBar->hide();
+        setFocus();
+    }
+
+    // 搜索条收起时不显示高亮
+    applyHighlights();
+}
+
+void MainWindow::runSearch(const QString &query)
+{
+    m_searchTimer.stop();
+
+    const QString needle = TextIndex::normalize(query);
+    const QString previous = TextIndex::normalize(m_searchQuery);
+    const bool fuzzy = TextIndex::isFuzzy(query) || TextIndex::isFuzzy(m_searchQuery);
+    m_searchQuery = needle.isEmpty() ? QString() : query;
+
+    if (!fuzzy && !previous.isEmpty() && !needle.isEmpty() && needle.contains(previous)) {
+        // 1. 在旧查询上加字：新结果只可能出现在旧结果所在的页，只复查这些页（模糊查询不适用）；
+        //    已查过的页数不变，之后建好的页照常由 handleIndexProgress 补查
+        QVector<int> pages;
+        for (const TextHit &hit : m_searchHits) {
+            if (pages.isEmpty() || pages.last() != hit.page) pages.append(hit.page);
+        }
+        m_searchHits = m_textIndex.searchPages(m_searchQuery, pages);
+    } else {
+        // 2. 新查询（或删了字）：走倒排表。先取已建好的页数再按它查，
+        //    期间后台建好的页留给 handleIndexProgress 补查，不会漏掉也不会重复
+        const int indexed = m_textIndex.indexedPages();
+        m_searchHits = m_textIndex.search(m_searchQuery, 0, indexed);
+        m_searchedPages = indexed;
+    }
+    m_searchCurrent = -1;
+
+    // 从当前页开始的第一处；当前页之后还没有结果时，索引建完之前先不跳
+    const int first = firstHitFrom(m_currentPage);
+    if (first >= 0) {
+        goToHit(first);
+    } else if (!m_searchHits.isEmpty() && m_textIndex.isComplete()) {
+        goToHit(0);
+    } else {
+        cancelHitPrefetch();
+        updateSearchBar();
+        updateHighlights();
+    }
+}
+
+void MainWindow::stepHit(int delta)
+{
+    if (m_searchEdit && m_searchEdit->text() != m_searchQuery) {
+        runSearch(m_searchEdit->text());
+        return;
+    }
+    if (m_searchHits.isEmpty()) return;
+
+    const int n = m_searchHits.size();
+    const int next = (m_searchCurrent < 0) ? (delta > 0 ? 0 : n - 1)
+                                           : ((m_searchCurrent + delta) % n + n) % n;
+    goToHit(next);
+}
+
+void MainWindow::goToHit(int index)
+{
+    if (index < 0 || index >= m_searchHits.size()) return;
+
+    m_searchCurrent = index;
+    const int page = m_searchHits.at(index).page;
+    if (page != m_currentPage) {
+        m_currentPage = page;
+        renderCurrentPage();
+    }
+    updateSearchBar();
+    updateHighlights();
+    prefetchHitPages();
+}
+
+int MainWindow::firstHitFrom(int page) const
+{
+    for (int i = 0; i < m_searchHits.size(); ++i) {
+        if (m_searchHits.at(i).page >= page) return i;
+    }
+    return -1;
+}
+
+void MainWindow::handleIndexProgress()
+{
+    // 信号可能来自已作废的索引任务：以索引当前的状态为准
+    const int indexed = m_textIndex.indexedPages();
+    if (!m_searchQuery.isEmpty() && indexed > m_searchedPages) {
+        m_searchHits += m_textIndex.search(m_searchQuery, m_searchedPages, indexed);
+        m_searchedPages = indexed;
+
+        // 还没定位到任何一处：当前页之后出现结果就跳过去，索引建完仍没有就回到第一处
+        if (m_searchCurrent < 0) {
+            const int first = firstHitFrom(m_currentPage);
+            if (first >= 0) {
+                goToHit(first);
+            } else if (!m_searchHits.isEmpty() && m_textIndex.isComplete()) {
+                goToHit(0);
+            }
+        }
+    }
+    updateSearchBar();
+    updateHighlights();
+}
+
+void MainWindow::resetSearchResults()
+{
+    m_searchHits.clear();
+    m_searchCurrent = -1;
+    m_searchedPages = 0;
+
+    // 文档换了或改写了：取过的字符框作废
+    m_highlightWatcher.cancel();
+    m_highlightPage = -1;
+    m_highlightHits.clear();
+    m_highlightRects.clear();
+
+    updateSearchBar();
+    updateHighlights();
+}
+
+void MainWindow::updateHighlights()
+{
+    // 1. 当前页上的命中
+    QVector<TextHit> pageHits;
+    if (!m_searchQuery.isEmpty()) {
+        for (const TextHit &hit : m_searchHits) {
+            if (hit.page == m_currentPage) pageHits.append(hit);
+        }
+    }
+
+    // 2. 字符框已经取过或正在取：只需重画（当前那一处可能变了）
+    if (m_highlightPage == m_currentPage && m_highlightHits == pageHits) {
+        applyHighlights();
+        return;
+    }
+    if (m_highlightWatcher.isRunning() && m_pendingHighlightPage == m_currentPage &&
+        m_pendingHighlightHits == pageHits) {
+        return;
+    }
+
+    m_highlightWatcher.cancel();
+    if (pageHits.isEmpty() || !m_pdf) {
+        m_highlightPage = m_currentPage;
+        m_highlightHits.clear();
+        m_highlightRects.clear();
+        applyHighlights();
+        return;
+    }
+
+    // 3. 后台取字符框：和渲染同一个串行 key，排在当前页的渲染之后
+    QVector<QPair<int, int>> ranges;
+    ranges.reserve(pageHits.size());
+    for (const TextHit &hit : pageHits) ranges.append(qMakePair(hit.start, hit.length));
+
+    const int page = m_currentPage;
+    m_pendingHighlightPage = page;
+    m_pendingHighlightHits = pageHits;
+    m_highlightWatcher.setFuture(JobScheduler::instance()->run<QVector<QVector<QRectF>>>(
+                JobScheduler::Visible, m_pdf, [this, page, ranges]() {
+        return m_pdf->textRects(page, ranges);
+    }));
+}
+
+void MainWindow::handleHighlightsFinished()
+{
+    if (m_highlightWatcher.isCanceled() || m_highlightWatcher.future().resultCount() == 0) return;
+
+    m_highlightPage = m_pendingHighlightPage;
+    m_highlightHits = m_pendingHighlightHits;
+    m_highlightRects = m_highlightWatcher.result();
+    applyHighlights();
+}
+
+void MainWindow::applyHighlights()
+{
+    if (!m_overlay) return;
+
+    // 上屏的还是别的页（新页还在渲染）时先不画，免得框落在旧页面上
+    if (!m_searchBarVisible || m_highlightHits.isEmpty() || m_highlightPage != m_displayedPage) {
+        m_overlay->clearHighlights();
+        return;
+    }
+
+    const TextHit current = (m_searchCurrent >= 0 && m_searchCurrent < m_searchHits.size())
+            ? m_searchHits.at(m_searchCurrent) : TextHit();
+
+    QVector<QRectF> rects;
+    QVector<QRectF> currentRects;
+    for (int i = 0; i < m_highlightHits.size() && i < m_highlightRects.size(); ++i) {
+        if (m_highlightHits.at(i) == current) currentRects += m_highlightRects.at(i);
+        else rects += m_highlightRects.at(i);
+    }
+    m_overlay->setHighlights(rects, currentRects);
+}
+
+QRect MainWindow::displayedImageRect() const
+{
+    // 显示区按 AlignCenter 放置图片
+    const QSize area = ui->lblReader->size();
+    const QSize size = m_displayedImage.size();
+    return QRect(QPoint((area.width() - size.width()) / 2, (area.height() - size.height()) / 2), size);
+}
+
+void MainWindow::prefetchHitPages()
+{
+    cancelHitPrefetch();
+    if (!m_pdf || m_searchCurrent < 0 || m_searchHits.isEmpty()) return;
+
+    // F3 / Shift+F3 要去的页
+    const int n = m_searchHits.size();
+    QList<int> pages;
+    for (const int delta : { 1, -1 }) {
+        const int page = m_searchHits.at(((m_searchCurrent + delta) % n + n) % n).page;
+        if (page != m_currentPage && !pages.contains(page)) pages.append(page);
+    }
+
+    for (const int page : pages) {
+        const QFuture<void> job = prefetchPage(page);
+        if (!job.isFinished()) m_hitPrefetchJobs.append(job);
+    }
+}
+
+QFuture<void> MainWindow::prefetchPage(int page)
+{
+    // 以预取优先级渲染进缓存（倍率与当前一致），跳过去时渲染任务直接命中缓存；已在热层时不发任务
+    const double scale = m_scale;
+    const PageCacheKey key = PageCache::keyFor(page, scale);
+    if (!m_pdf || !m_pageCache.findHot(key).isNull()) return QFuture<void>();
+
+    return JobScheduler::instance()->runControlled<void>(
+                JobScheduler::Prefetch, m_pdf, [this, page, scale, key](QFutureInterface<void> &iface) {
+        if (!m_pageCache.lookup(key).isNull()) return;
+
+        const QImage img = m_pdf->renderPage(page, scale, &iface);
+        if (!img.isNull() && !iface.isCanceled()) m_pageCache.insert(key, img);
+    });
+}
+
+void MainWindow::cancelHitPrefetch()
+{
+    // 作废还没做完的预取；已结束的顺便清掉（析构时要等还在运行的）
+    for (int i = m_hitPrefetchJobs.size() - 1; i >= 0; --i) {
+        m_hitPrefetchJobs[i].cancel();
+        if (m_hitPrefetchJobs[i].isFinished()) m_hitPrefetchJobs.removeAt(i);
+    }
+}
+
+// ---------------- 文字选择 ----------------
+
+void MainWindow::requestTextLayout()
+{
+    // 缩放后还是同一页：版面和选择都保留（都是归一化坐标）
+    const int page = m_displayedPage;
+    if (page == m_layoutPage) return;
+
+    clearSelection();
+    m_layout.reset();
+    m_layoutPage = -1;
+    if (!m_pdf || page < 0) return;
+    if (m_layoutWatcher.isRunning() && m_pendingLayoutPage == page) return;
+
+    // 页面已经上屏，取字符框排在预取优先级；用户伸手拿鼠标之前通常已经建好
+    m_layoutWatcher.cancel();
+    m_pendingLayoutPage = page;
+    m_layoutWatcher.setFuture(JobScheduler::instance()->run<QSharedPointer<const TextLayout>>(
+                JobScheduler::Prefetch, m_pdf, [this, page]() {
+        return m_pdf->textLayout(page);
+    }));
+}
+
+void MainWindow::handleLayoutFinished()
+{
+    if (m_layoutWatcher.isCanceled() || m_layoutWatcher.future().resultCount() == 0) return;
+    if (m_pendingLayoutPage != m_displayedPage) return;
+
+    m_layout = m_layoutWatcher.result();
+    m_layoutPage = m_layout ? m_pendingLayoutPage : -1;
+}
+
+void MainWindow::resetTextLayout()
+{
+    m_layoutWatcher.cancel();
+    m_layout.reset();
+    m_layoutPage = -1;
+    m_pendingLayoutPage = -1;
+    m_dragMode = NoDrag;
+    clearSelection();
+    m_overlay->setRubberBand(QRectF());
+    ui->lblReader->unsetCursor();
+}
+
+QPointF MainWindow::toPagePoint(const QPoint &pos) const
+{
+    const QRect image = displayedImageRect();
+    if (image.isEmpty()) return QPointF(-1, -1);
+    return QPointF(double(pos.x() - image.x()) / image.width(), double(pos.y() - image.y()) / image.height());
+}
+
+bool MainWindow::handleReaderMouse(QEvent *event)
+{
+    const QEvent::Type type = event->type();
+    if (type != QEvent::MouseButtonPress && type != QEvent::MouseButtonDblClick &&
+        type != QEvent::MouseMove && type != QEvent::MouseButtonRelease) {
+        return false;
+    }
+
+    auto *me = static_cast<QMouseEvent*>(event);
+    const QPointF point = toPagePoint(me->pos());
+
+    // 链接优先于选字
+    if (handleLinkMouse(me, point)) return true;
+    if (!m_layout || m_layoutPage != m_displayedPage) return false;
+
+    // 1. 悬停：字上显示文本光标
+    if (type == QEvent::MouseMove && !(me->buttons() & Qt::LeftButton)) {
+        if (m_layout->charAt(point) >= 0) ui->lblReader->setCursor(Qt::IBeamCursor);
+        else ui->lblReader->unsetCursor();
+        return false;
+    }
+    if (type != QEvent::MouseMove && me->button() != Qt::LeftButton) return false;
+
+    switch (type) {
+    case QEvent::MouseButtonDblClick: {
+        // 2. 双击选词
+        const int index = m_layout->charAt(point);
+        if (index < 0) return false;
+        setSelection({ m_layout->wordAt(index) });
+        m_sinceDoubleClick.start();
+        m_dragMode = NoDrag;
+        return true;
+    }
+    case QEvent::MouseButtonPress: {
+        const int index = m_layout->charAt(point);
+
+        // 3. 双击后紧接着再按一次：选整行
+        if (index >= 0 && m_sinceDoubleClick.isValid() &&
+            m_sinceDoubleClick.elapsed() < QApplication::doubleClickInterval()) {
+            m_sinceDoubleClick.invalidate();
+            setSelection({ m_layout->lineAt(index) });
+            m_dragMode = NoDrag;
+            return true;
+        }
+        m_sinceDoubleClick.invalidate();
+
+        // 4. 开始拖选或框选
+        beginSelectionDrag(point);
+        return true;
+    }
+    case QEvent::MouseMove:
+        if (m_dragMode == TextDrag) {
+            const int index = m_layout->nearestChar(point);
+            if (index >= 0) {
+                setSelection({ qMakePair(qMin(m_selectionAnchor, index), qMax(m_selectionAnchor, index) + 1) });
+            }
+        } else if (m_dragMode == RubberBandDrag) {
+            const QRectF band = QRectF(m_rubberOrigin, point).normalized();
+            m_overlay->setRubberBand(band);
+            setSelection(m_layout->rangesIn(band));
+        }
+        return m_dragMode != NoDrag;
+    case QEvent::MouseButtonRelease: {
+        const bool dragging = (m_dragMode != NoDrag);
+        m_dragMode = NoDrag;
+        m_overlay->setRubberBand(QRectF());
+        return dragging;
+    }
+    default:
+        return false;
+    }
+}
+
+void MainWindow::beginSelectionDrag(const QPointF &point)
+{
+    // 从字上按下是拖选，从空白处按下是框选
+    clearSelection();
+    const int index = m_layout ? m_layout->charAt(point) : -1;
+    if (index >= 0) {
+        m_dragMode = TextDrag;
+        m_selectionAnchor = index;
+    } else {
+        m_dragMode = RubberBandDrag;
+        m_rubberOrigin = point;
+    }
+}
+
+void MainWindow::setSelection(const QVector<QPair<int, int>> &ranges)
+{
+    m_selection = ranges;
+
+    QVector<QRectF> rects;
+    if (m_layout) {
+        for (const QPair<int, int> &range : ranges) rects += m_layout->selectionRects(range.first, range.second);
+    }
+    m_overlay->setSelection(rects);
+}
+
+void MainWindow::clearSelection()
+{
+    m_selection.clear();
+    m_overlay->setSelection(QVector<QRectF>());
+}
+
+void MainWindow::selectAllOnPage()
+{
+    if (!m_layout || m_layoutPage != m_displayedPage) return;
+    setSelection({ qMakePair(0, m_layout->size()) });
+}
+
+void MainWindow::copySelection()
+{
+    if (!m_layout || m_selection.isEmpty()) return;
+
+    // 框选出的几段之间换行
+    QStringList parts;
+    for (const QPair<int, int> &range : m_selection) parts << m_layout->textOf(range.first, range.second);
+    const QString text = parts.join(QLatin1Char('\n'));
+    if (text.isEmpty()) return;
+
+    QApplication::clipboard()->setText(text);
+    showToast(QStringLiteral("已复制 %1 个字").arg(text.size()));
+}
+
+// ---------------- 链接 ----------------
+
+void MainWindow::requestPageLinks()
+{
+    // 缩放后还是同一页：链接不变（归一化坐标）
+    const int page = m_displayedPage;
+    if (page == m_linksPage) return;
+
+    hoverLink(-1);
+    m_pressedLink = -1;
+    m_links.reset();
+    m_linksPage = -1;
+    if (!m_pdf || page < 0) return;
+    if (m_linksWatcher.isRunning() && m_pendingLinksPage == page) return;
+
+    // 与文字版面一样排在预取优先级，每页只向 PDFium 取一次（PdfDocument 里有缓存）
+    m_linksWatcher.cancel();
+    m_pendingLinksPage = page;
+    m_linksWatcher.setFuture(JobScheduler::instance()->run<QSharedPointer<const PageLinks>>(
+                JobScheduler::Prefetch, m_pdf, [this, page]() {
+        return m_pdf->pageLinks(page);
+    }));
+}
+
+void MainWindow::handleLinksFinished()
+{
+    if (m_linksWatcher.isCanceled() || m_linksWatcher.future().resultCount() == 0) return;
+    if (m_pendingLinksPage != m_displayedPage) return;
+
+    m_links = m_linksWatcher.result();
+    m_linksPage = m_links ? m_pendingLinksPage : -1;
+}
+
+void MainWindow::resetPageLinks()
+{
+    m_linksWatcher.cancel();
+    m_linkPrefetchJob.cancel();
+    m_links.reset();
+    m_linksPage = -1;
+    m_pendingLinksPage = -1;
+    m_hoveredLink = -1;
+    m_pressedLink = -1;
+    ui->lblReader->setToolTip(QString());
+}
+
+bool MainWindow::handleLinkMouse(QMouseEvent *event, const QPointF &point)
+{
+    const int link = (m_links && m_linksPage == m_displayedPage) ? m_links->linkAt(point) : -1;
+
+    switch (event->type()) {
+    case QEvent::MouseMove:
+        if (m_pressedLink >= 0) {
+            // 在链接上按下后拖开：不算点击，改为从按下处选字
+            if ((event->pos() - m_linkPressPos).manhattanLength() < QApplication::startDragDistance()) return true;
+            m_pressedLink = -1;
+            if (m_layout && m_layoutPage == m_displayedPage) beginSelectionDrag(toPagePoint(m_linkPressPos));
+            return false;
+        }
+        if (event->buttons() & Qt::LeftButton) return false;
+        hoverLink(link);
+        return link >= 0;
+    case QEvent::MouseButtonPress:
+        // 双击后紧接着的那一下留给选整行
+        if (event->button() != Qt::LeftButton || link < 0) return false;
+        if (m_sinceDoubleClick.isValid() && m_sinceDoubleClick.elapsed() < QApplication::doubleClickInterval()) {
+            return false;
+        }
+        clearSelection();
+        m_pressedLink = link;
+        m_linkPressPos = event->pos();
+        return true;
+    case QEvent::MouseButtonDblClick:
+        // 单击已经跳转或打开过了，链接上的双击不再选词
+        return link >= 0;
+    case QEvent::MouseButtonRelease: {
+        if (event->button() != Qt::LeftButton || m_pressedLink < 0) return false;
+        const int pressed = m_pressedLink;
+        m_pressedLink = -1;
+        if (link == pressed) activateLink(link);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void MainWindow::hoverLink(int link)
+{
+    if (link == m_hoveredLink) return;
+    m_hoveredLink = link;
+    m_linkPrefetchJob.cancel();
+
+    if (link < 0) {
+        ui->lblReader->unsetCursor();
+        ui->lblReader->setToolTip(QString());
+        return;
+    }
+
+    ui->lblReader->setCursor(Qt::PointingHandCursor);
+    const PdfLink &target = m_links->at(link);
+    if (target.targetPage < 0) {
+        ui->lblReader->setToolTip(target.uri);
+        return;
+    }
+
+    // 悬停到按下通常有几百毫秒：先把目标页渲染进缓存，点下去直接上屏
+    ui->lblReader->setToolTip(QStringLiteral("第 %1 页").arg(target.targetPage + 1));
+    if (target.targetPage != m_displayedPage) m_linkPrefetchJob = prefetchPage(target.targetPage);
+}
+
+void MainWindow::activateLink(int link)
+{
+    if (!m_links || link < 0 || link >= m_links->size()) return;
+
+    const PdfLink target = m_links->at(link);
+    if (target.targetPage >= 0) {
+        jumpToPage(target.targetPage + 1);
+        return;
+    }
+
+    // 正文里识别出的网址可能没有协议头（www.example.com）
+    const QUrl url = QUrl::fromUserInput(target.uri);
+    if (!url.isValid()) {
+        showToast(QStringLiteral("无法打开链接：%1").arg(target.uri));
+        return;
+    }
+
+    // 网页和邮件地址直接打开；其他协议要用户确认：file:// 可能指向可执行文件，
+    // \\server\share 这样的 UNC 路径会让系统带着 NTLM 凭据去连接对方
+    const QString scheme = url.scheme().toLower();
+    const bool safe = scheme == QLatin1String("http") || scheme == QLatin1String("https") ||
+                      scheme == QLatin1String("mailto");
+    if (!safe) {
+        const QMessageBox::StandardButton answer = QMessageBox::question(
+                    this, QStringLiteral("打开链接"),
+                    QStringLiteral("这个链接不是网页或邮件地址，打开它可能会运行程序或访问网络共享：\n\n%1\n\n仍要打开吗？")
+                    .arg(url.toString()),
+                    QMessageBox::Open | QMessageBox::Cancel, QMessageBox::Cancel);
+        if (answer != QMessageBox::Open) return;
+    }
+
+    if (!QDesktopServices::openUrl(url)) {
+        showToast(QStringLiteral("无法打开链接：%1").arg(target.uri));
+    }
+}
+
+// ---------------- 复制全文 ----------------
+
+void MainWindow::copyDocumentText()
+{
+    if (!m_pdf || m_pdf->pageCount() <= 0) return;
+
+    cancelDocumentCopy();
+    const int generation = m_copyGeneration.loadAcquire();
+    showToast(QStringLiteral("正在复制全文…"));
+    scheduleCopyChunk(generation, 0, QSharedPointer<QString>::create());
+}
+
+void MainWindow::scheduleCopyChunk(int generation, int fromPage, const QSharedPointer<QString> &text)
+{
+    for (int i = m_copyJobs.size() - 1; i >= 0; --i) {
+        if (m_copyJobs[i].isFinished()) m_copyJobs.removeAt(i);
+    }
+
+    m_copyJobs.append(JobScheduler::instance()->run(
+                JobScheduler::Prefetch, m_pdf, [this, generation, fromPage, text]() {
+        // 一次只抽一批；有可见页任务在排队就提前结束这一批，让渲染先做
+        const int count = m_pdf->pageCount();
+        int page = fromPage;
+        while (page < count && page - fromPage < kCopyChunkPages) {
+            if (m_copyGeneration.loadAcquire() != generation) return;
+            if (page > fromPage && JobScheduler::shouldYield()) break;
+
+            text->append(m_pdf->pageText(page));
+            text->append(QLatin1Char('\n'));
+            ++page;
+        }
+
+        // 回到界面线程：汇报进度并排下一批
+        QMetaObject::invokeMethod(this, [this, generation, page, text]() {
+            handleCopyProgress(generation, page, text);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void MainWindow::handleCopyProgress(int generation, int nextPage, const QSharedPointer<QString> &text)
+{
+    if (generation != m_copyGeneration.loadAcquire() || !m_pdf) return;
+
+    const int count = m_pdf->pageCount();
+    if (nextPage < count) {
+        showToast(QStringLiteral("正在复制全文… %1 / %2 页").arg(nextPage).arg(count));
+        scheduleCopyChunk(generation, nextPage, text);
+        return;
+    }
+
+    text->replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    QApplication::clipboard()->setText(*text);
+    showToast(QStringLiteral("已复制全文：%1 页，%2 个字").arg(count).arg(text->size()));
+}
+
+void MainWindow::cancelDocumentCopy()
+{
+    m_copyGeneration.fetchAndAddOrdered(1);
+    for (int i = m_copyJobs.size() - 1; i >= 0; --i) {
+        m_copyJobs[i].cancel();
+        if (m_copyJobs[i].isFinished()) m_copyJobs.removeAt(i);
+    }
+}
+
+// ---------------- 导出全文 ----------------
+
+void MainWindow::exportDocumentText()
+{
+    if (!m_pdf || m_pdf->pageCount() <= 0 || m_currentFile.isEmpty()) return;
+    if (m_exportWatcher.isRunning()) {
+        showToast(QStringLiteral("上一次导出还没有完成"));
+        return;
+    }
+
+    // 默认与 PDF 同名（压缩包里的取条目名，网址取路径的文件名）
+    const QString source = m_currentFile;
+    const QString name = QFileInfo(PdfSource::isRemote(source) ? QUrl(source).path() : source).completeBaseName();
+    const QString suggested = PdfSource::isRemote(source)
+            ? QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/" + name + ".txt"
+            : QFileInfo(source.section(QStringLiteral("!/"), 0, 0)).absolutePath() + "/" + name + ".txt";
+
+    const QString path = QFileDialog::getSaveFileName(
+        this,
+        QStringLiteral("导出文字"),
+        suggested,
+        QStringLiteral("文本文件 (*.txt);;All Files (*)")
+    );
+    if (path.isEmpty()) return;
+
+    // 导出用自己打开的文档，不占当前文档的串行队列，翻页、渲染照常；换文档也不影响它
+    m_exportPath = path;
+    showToast(QStringLiteral("正在导出文字…"));
+    m_exportWatcher.setFuture(JobScheduler::instance()->runControlled<QString>(
+                JobScheduler::Indexing, &m_exportWatcher, [source, path](QFutureInterface<QString> &iface) {
+        TextExporter exporter(source);
+        iface.reportResult(exporter.exportTo(path, &iface) ? QString() : exporter.errorString());
+    }));
+}
+
+void MainWindow::handleExportFinished()
+{
+    if (m_exportWatcher.isCanceled() || m_exportWatcher.future().resultCount() == 0) return;
+
+    const QString error = m_exportWatcher.result();
+    if (error.isEmpty()) {
+        showToast(QStringLiteral("已导出文字：%1").arg(QDir::toNativeSeparators(m_exportPath)));
+    } else {
+        QMessageBox::warning(this, QStringLiteral("导出失败"), error);
+    }
+}
+
+void MainWindow::showToast(const QString &text)
+{
+    if (!m_toast) {
+        m_toast = new QLabel(this);
+        m_toast->setObjectName("toast");
+        m_toast->setFocusPolicy(Qt::NoFocus);
+        m_toast->setStyleSheet(
+            "#toast { color: white; background: rgba(0,0,0,150); border-radius: 10px; padding: 8px 12px; }"
+        );
+        connect(&m_toastTimer, &QTimer::timeout, m_toast, &QWidget::hide);
+    }
+
+    m_toast->setText(text);
+    m_toast->adjustSize();
+
+    const int margin = 16;
+    const int safe = 10;
+    m_toast->move(margin + safe, qMax(0, height() - m_toast->height() - margin - safe));
+    m_toast->show();
+    m_toast->raise();
+    m_toastTimer.start(2500);
+}
+
+// ---------------- I/O 统计 ----------------
+
+void MainWindow::showIoStats()
+{
+    if (!m_pdf) return;
+
+    QMessageBox box(this);
+    box.setWindowTitle(QStringLiteral("I/O 统计"));
+    box.setText(m_pdf->ioTrace()->summary());
+    QPushButton *exportButton = box.addButton(QStringLiteral("导出轨迹…"), QMessageBox::ActionRole);
+    box.addButton(QMessageBox::Close);
+    box.exec();
+
+    if (box.clickedButton() != exportButton) return;
+
+    // Chrome Trace 格式，可在 chrome://tracing 或 Perfetto 里按阶段查看时间线
+    QString path = QFileDialog::getSaveFileName(
+        this,
+        QStringLiteral("导出 I/O 轨迹"),
+        QStringLiteral("io-trace.json"),
+        QStringLiteral("Chrome Trace (*.json)")
+    );
+    if (path.isEmpty()) return;
+
+    QString error;
+    if (!m_pdf->ioTrace()->exportChromeTrace(path, &error)) {
+        QMessageBox::warning(this, QStringLiteral("导出失败"), error);
+    }
+}
+
 // 加载会话信息
-void MainWindow::loadSession()
+void MainWindow::openFile(const QString &file, qint64 launchEpochMs)
+{
+    activateFromOtherInstance();
+
+    m_firstPixelLaunchMs = launchEpochMs;
+    startLoad(file, 0, 1.5);
+}
+
+void MainWindow::activateFromOtherInstance()
+{
+    if (isMinimized()) showNormal();
+    show();
+    raise();
+    activateWindow();
+}
+
+void MainWindow::loadSession(const QString &startupFile, qint64 launchEpochMs)
 {
     QSettings settings("MyCompany", "PdfReader");
 
@@ -455,19 +1667,95 @@ void MainWindow::loadSession()
         resize(1200, 800);
     }
 
-    // 2. 恢复上次打开的文件（之前的逻辑）
+    // 2. 命令行指定了文件：直接打开它
+    if (!startupFile.isEmpty()) {
+        m_firstPixelLaunchMs = launchEpochMs;
+        startLoad(startupFile, 0, 1.5);
+        return;
+    }
+
+    // 3. 恢复上次打开的文件（之前的逻辑）
+    // 后台加载，完成后恢复页码与缩放
     QString lastFile = settings.value("session/last_file").toString();
-    if (!lastFile.isEmpty() && QFile::exists(lastFile)) {
-        if (!m_pdf) m_pdf = new PdfDocument(this);
-        if (m_pdf->load(lastFile)) {
-            m_currentFile = lastFile;
-            m_currentPage = settings.value("session/last_page", 0).toInt();
-            m_scale = settings.value("session/last_scale", 1.5).toDouble();
-            renderCurrentPage();
+    if (!lastFile.isEmpty() && (PdfSource::isRemote(lastFile) || QFile::exists(PdfSource::localFile(lastFile)))) {
+        const int page = settings.value("session/last_page", 0).toInt();
+        const double scale = settings.value("session/last_scale", 1.5).toDouble();
+
+        m_firstPixelLaunchMs = launchEpochMs;
+        startLoad(lastFile, page, scale);
+
+        // ✅ 文件没变：先把上次退出时的画面作为第一帧（startLoad 设置的提示文字会被替换掉）
+        if (restoreSnapshot(lastFile, page, scale) && launchEpochMs > 0) {
+            qInfo() << "Startup snapshot shown:" << (QDateTime::currentMSecsSinceEpoch() - launchEpochMs) << "ms";
         }
     }
 }
 
+QString MainWindow::snapshotPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/last_frame.png";
+}
+
+QString MainWindow::snapshotKey(const QString &file, int page, double scale) const
+{
+    // 远程文件没法在不联网的情况下确认没变，不做快照
+    const QString localFile = PdfSource::localFile(file);
+    if (localFile.isEmpty()) return QString();
+
+    QFileInfo info(localFile);
+    if (!info.exists()) return QString();
+
+    QSettings settings("MyCompany", "PdfReader");
+    const QByteArray geometry = settings.value("window/geometry").toByteArray();
+
+    return QStringLiteral("%1|%2|%3|%4|%5|%6")
+            .arg(file)
+            .arg(info.size())
+            .arg(info.lastModified().toMSecsSinceEpoch())
+            .arg(page)
+            .arg(PageCache::keyFor(page, scale).scaleMilli)
+            .arg(QString::fromLatin1(geometry.toHex()));
+}
+
+void MainWindow::saveSnapshot()
+{
+    QSettings settings("MyCompany", "PdfReader");
+
+    // 快照键里的窗口几何是 saveSession 刚存下的那份，需在它之后调用
+    const QString key = m_displayedImage.isNull() ? QString() : snapshotKey(m_currentFile, m_currentPage, m_scale);
+    if (key.isEmpty()) {
+        settings.remove("snapshot/key");
+        QFile::remove(snapshotPath());
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(snapshotPath()).absolutePath());
+
+    // PNG 压缩级别调低：退出时少等一会儿，文字也不失真
+    if (m_displayedImage.save(snapshotPath(), "PNG", 80)) {
+        settings.setValue("snapshot/key", key);
+        settings.setValue("snapshot/title", windowTitle());
+    } else {
+        settings.remove("snapshot/key");
+    }
+}
+
+bool MainWindow::restoreSnapshot(const QString &file, int page, double scale)
+{
+    QSettings settings("MyCompany", "PdfReader");
+
+    const QString key = snapshotKey(file, page, scale);
+    if (key.isEmpty() || settings.value("snapshot/key").toString() != key) return false;
+
+    QImage img(snapshotPath());
+    if (img.isNull()) return false;
+
+    ui->lblReader->setPixmap(QPixmap::fromImage(img));
+    setWindowTitle(settings.value("snapshot/title").toString());
+    m_snapshotShown = true;
+    return true;
+}
+
 // 保存会话信息
 void MainWindow::saveSession()
 {
@@ -488,6 +1776,7 @@ void MainWindow::saveSession()
 void MainWindow::closeEvent(QCloseEvent *event)
 {
     saveSession(); // 退出前最后一步保存
+    saveSnapshot();
     event->accept();
 }
 
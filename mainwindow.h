@@ -2,20 +2,28 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QtConcurrent>
+#include <QFuture>
 #include <QFutureWatcher>
 #include <QImage>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+#include "pagecache.h"
+#include "pdfdocument.h"
+#include "textindex.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
-class PdfDocument;
-
 class QWidget;
 class QLabel;
 class QLineEdit;
 class QIntValidator;
+class QMouseEvent;
+class PageOverlay;
 
 class MainWindow : public QMainWindow
 {
@@ -24,6 +32,14 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 恢复窗口与会话（由 main 在 show 之前调用）：有命令行文件时打开它而不是恢复上次的文件；
+    // launchEpochMs 为进程启动时间，用于统计首帧耗时
+    void loadSession(const QString &startupFile = QString(), qint64 launchEpochMs = 0);
+
+    // 打开其他实例转来的文件，并把窗口提到前台
+    void openFile(const QString &file, qint64 launchEpochMs = 0);
+    void activateFromOtherInstance();
+
 protected:
     // 键盘翻页
     void keyPressEvent(QKeyEvent *event) override;
@@ -46,8 +62,16 @@ protected:
 
 private:
     void openPdf();
+    void openUrl();       // 打开远程 PDF（HTTP Range）
+    void startLoad(const QString &file, int page, double scale);
+    void handleLoadFinished();
     void renderCurrentPage();
 
+    // 文件在磁盘上被改写：后台重新加载，保留没变的页的缓存，页码与缩放不变
+    void watchCurrentFile();
+    void reloadDocument();
+    void handleReloadFinished();
+
     // 页码条
     void setupPageBar();
     void updatePageBar();
@@ -55,8 +79,70 @@ private:
     void togglePageBar();
     void setPageBarVisible(bool visible);
 
+    // 全文搜索条（Ctrl+F）：索引在后台建立，结果随索引进度陆续加入
+    void setupSearchBar();
+    void updateSearchBar();
+    void setSearchBarVisible(bool visible);
+    void runSearch(const QString &query);
+    void stepHit(int delta);
+    void goToHit(int index);
+    int firstHitFrom(int page) const;
+    void handleIndexProgress();
+    void resetSearchResults();
+
+    // 命中高亮：当前页的命中在后台取字符框，画在覆盖层上，页面不重新渲染
+    void updateHighlights();
+    void handleHighlightsFinished();
+    void applyHighlights();
+    QRect displayedImageRect() const;
+
+    // 预取上一处/下一处命中所在的页，F3 跳过去时直接从缓存上屏
+    void prefetchHitPages();
+    void cancelHitPrefetch();
+    QFuture<void> prefetchPage(int page);
+
+    // 文字选择：拖选、双击选词、三击选行，从空白处拖动为框选；只画在覆盖层上
+    void requestTextLayout();
+    void handleLayoutFinished();
+    void resetTextLayout();
+    bool handleReaderMouse(QEvent *event);
+    void beginSelectionDrag(const QPointF &point);
+    QPointF toPagePoint(const QPoint &pos) const;
+
+    // 链接：悬停变手形并预渲染目标页，单击跳转或用浏览器打开
+    void requestPageLinks();
+    void handleLinksFinished();
+    void resetPageLinks();
+    bool handleLinkMouse(QMouseEvent *event, const QPointF &point);
+    void hoverLink(int link);
+    void activateLink(int link);
+    void setSelection(const QVector<QPair<int, int>> &ranges);
+    void clearSelection();
+    void selectAllOnPage();
+    void copySelection();
+
+    // 复制全文：后台分批抽取文字，界面不卡
+    void copyDocumentText();
+    void scheduleCopyChunk(int generation, int fromPage, const QSharedPointer<QString> &text);
+    void handleCopyProgress(int generation, int nextPage, const QSharedPointer<QString> &text);
+    void cancelDocumentCopy();
+
+    // 导出全文到文本文件：独立打开文档、多线程抽取，边抽边写
+    void exportDocumentText();
+    void handleExportFinished();
+
+    // 左下角的短暂提示
+    void showToast(const QString &text);
+
+    void showIoStats();   // 查看/导出 I/O 统计
+
     void saveSession();   // 保存会话
-    void loadSession();   // 加载会话信息并自动打开
+
+    // 启动快照：退出时保存正在显示的画面，下次启动先把它作为第一帧，后台再加载、重新渲染
+    void saveSnapshot();
+    bool restoreSnapshot(const QString &file, int page, double scale);
+    QString snapshotKey(const QString &file, int page, double scale) const;
+    static QString snapshotPath();
 
 private:
     Ui::MainWindow *ui;
@@ -73,15 +159,98 @@ private:
     QIntValidator *m_pageValidator = nullptr;
     bool m_pageBarVisible = false;
 
+    // 搜索条控件
+    QWidget *m_searchBar = nullptr;
+    QLineEdit *m_searchEdit = nullptr;
+    QLabel *m_searchLabel = nullptr;
+    bool m_searchBarVisible = false;
+
 private:
     // 渲染监视器，用于监听异步任务完成
     QFutureWatcher<QImage> m_renderWatcher;
 
     // 渲染槽函数
     void handleRenderFinished();
+    void showPageImage(const QImage &img);
 
     // 记录渲染时的参数，防止异步竞争导致页面错乱
     int m_renderingPage = -1;
+    double m_renderingScale = 0.0;
+    QSize m_renderingTarget;
+
+    // 后台加载：完成后才切换到新文档
+    QFutureWatcher<bool> m_loadWatcher;
+    QString m_loadingFile;
+    int m_loadingPage = 0;
+    double m_loadingScale = 1.5;
+
+    // 页面缓存（热层原图 + 冷层压缩），翻回看过的页面时不必重新渲染
+    PageCache m_pageCache;
+
+    // 自动重新加载（写文件往往分好几次，用定时器合并通知）
+    QFileSystemWatcher m_fileWatcher;
+    QTimer m_reloadTimer;
+    QFutureWatcher<PdfReloadResult> m_reloadWatcher;
+    int m_reloadRetries = 0;
+
+    // 全文索引与当前查询的结果（按页序）
+    TextIndex m_textIndex;
+    QString m_searchQuery;
+    QVector<TextHit> m_searchHits;
+    int m_searchCurrent = -1;
+    int m_searchedPages = 0;    // 当前查询已经查过的页数（索引建到哪，查到哪）
+    QTimer m_searchTimer;       // 边打边搜：停顿片刻再查
+
+    // 命中高亮
+    PageOverlay *m_overlay = nullptr;
+    QFutureWatcher<QVector<QVector<QRectF>>> m_highlightWatcher;
+    int m_pendingHighlightPage = -1;
+    QVector<TextHit> m_pendingHighlightHits;
+    int m_highlightPage = -1;
+    QVector<TextHit> m_highlightHits;           // 都在 m_highlightPage 上，与 m_highlightRects 一一对应
+    QVector<QVector<QRectF>> m_highlightRects;  // 页面归一化坐标
+    int m_displayedPage = -1;                   // 正在上屏的是哪一页（-1：没有或是启动快照）
+    QList<QFuture<void>> m_hitPrefetchJobs;
+
+    // 文字选择（只在上屏的那一页上）
+    enum DragMode { NoDrag, TextDrag, RubberBandDrag };
+    QFutureWatcher<QSharedPointer<const TextLayout>> m_layoutWatcher;
+    QSharedPointer<const TextLayout> m_layout;  // m_layoutPage 页的字符框与网格
+    int m_layoutPage = -1;
+    int m_pendingLayoutPage = -1;
+    DragMode m_dragMode = NoDrag;
+    int m_selectionAnchor = -1;
+    QPointF m_rubberOrigin;
+    QVector<QPair<int, int>> m_selection;       // 选中的 [start, end) 区间，升序
+    QElapsedTimer m_sinceDoubleClick;           // 双击后紧接着再按一次：选整行
+
+    // 链接（只在上屏的那一页上）
+    QFutureWatcher<QSharedPointer<const PageLinks>> m_linksWatcher;
+    QSharedPointer<const PageLinks> m_links;    // m_linksPage 页的链接
+    int m_linksPage = -1;
+    int m_pendingLinksPage = -1;
+    int m_hoveredLink = -1;
+    int m_pressedLink = -1;                     // 在链接上按下，松开时还在同一链接上才算点击
+    QPoint m_linkPressPos;
+    QFuture<void> m_linkPrefetchJob;            // 悬停的内部链接的目标页
+
+    // 复制全文
+    QAtomicInt m_copyGeneration = 0;
+    QList<QFuture<void>> m_copyJobs;
+
+    // 导出全文（结果为错误信息，空表示成功）
+    QFutureWatcher<QString> m_exportWatcher;
+    QString m_exportPath;
+
+    QLabel *m_toast = nullptr;
+    QTimer m_toastTimer;
+
+    // 首帧计时：非 0 时，下一次上屏记录从启动到首帧的耗时
+    qint64 m_firstPixelLaunchMs = 0;
+
+    // 当前上屏的画面（退出时存为启动快照）
+    QImage m_displayedImage;
+    bool m_snapshotShown = false;
 };
 
 #endif // MAINWINDOW_H
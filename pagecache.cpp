@@ -0,0 +1,254 @@
+﻿#include "pagecache.h"
+
+#include <QMutexLocker>
+#include <QtGlobal>
+
+#include <cstring>
+
+PageCache::PageCache(qint64 hotBudgetBytes, qint64 coldBudgetBytes)
+    : m_hotBudget(hotBudgetBytes)
+    , m_coldBudget(coldBudgetBytes)
+{
+}
+
+PageCacheKey PageCache::keyFor(int page, double scale)
+{
+    PageCacheKey key;
+    key.page = page;
+    key.scaleMilli = qRound(scale * 1000.0);
+    return key;
+}
+
+QImage PageCache::findHot(const PageCacheKey &key)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_hot.find(key);
+    if (it == m_hot.end()) return QImage();
+
+    it->tick = ++m_tick;
+    return it->image;
+}
+
+QImage PageCache::lookup(const PageCacheKey &key)
+{
+    ColdEntry cold;
+    {
+        QMutexLocker locker(&m_mutex);
+
+        auto hot = m_hot.find(key);
+        if (hot != m_hot.end()) {
+            hot->tick = ++m_tick;
+            return hot->image;
+        }
+
+        auto it = m_cold.find(key);
+        if (it == m_cold.end()) return QImage();
+
+        cold = it.value();
+        m_coldBytes -= cold.data.size();
+        m_cold.erase(it);
+    }
+
+    // 解压放在锁外，避免阻塞 GUI 线程的热层查询
+    QImage image = decompress(cold);
+    if (!image.isNull()) insert(key, image);
+    return image;
+}
+
+void PageCache::insert(const PageCacheKey &key, const QImage &image)
+{
+    if (image.isNull()) return;
+
+    QList<QPair<PageCacheKey, QImage>> victims;
+    {
+        QMutexLocker locker(&m_mutex);
+
+        auto cold = m_cold.find(key);
+        if (cold != m_cold.end()) {
+            m_coldBytes -= cold->data.size();
+            m_cold.erase(cold);
+        }
+
+        auto hot = m_hot.find(key);
+        if (hot != m_hot.end()) m_hotBytes -= imageBytes(hot->image);
+
+        HotEntry entry;
+        entry.image = image;
+        entry.tick = ++m_tick;
+        m_hot.insert(key, entry);
+        m_hotBytes += imageBytes(image);
+
+        victims = takeHotOverflowLocked();
+    }
+
+    demote(victims);
+}
+
+void PageCache::removePage(int page)
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (auto it = m_hot.begin(); it != m_hot.end(); ) {
+        if (it.key().page == page) {
+            m_hotBytes -= imageBytes(it->image);
+            it = m_hot.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto it = m_cold.begin(); it != m_cold.end(); ) {
+        if (it.key().page == page) {
+            m_coldBytes -= it->data.size();
+            it = m_cold.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PageCache::retainPages(const QSet<int> &pages)
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (auto it = m_hot.begin(); it != m_hot.end(); ) {
+        if (!pages.contains(it.key().page)) {
+            m_hotBytes -= imageBytes(it->image);
+            it = m_hot.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto it = m_cold.begin(); it != m_cold.end(); ) {
+        if (!pages.contains(it.key().page)) {
+            m_coldBytes -= it->data.size();
+            it = m_cold.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PageCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_hot.clear();
+    m_cold.clear();
+    m_hotBytes = 0;
+    m_coldBytes = 0;
+}
+
+qint64 PageCache::hotBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hotBytes;
+}
+
+qint64 PageCache::coldBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_coldBytes;
+}
+
+qint64 PageCache::imageBytes(const QImage &image)
+{
+    return qint64(image.bytesPerLine()) * image.height();
+}
+
+QList<QPair<PageCacheKey, QImage>> PageCache::takeHotOverflowLocked()
+{
+    QList<QPair<PageCacheKey, QImage>> victims;
+
+    // 至少保留最近的一页，哪怕它本身就超过预算
+    while (m_hotBytes > m_hotBudget && m_hot.size() > 1) {
+        auto oldest = m_hot.begin();
+        for (auto it = m_hot.begin(); it != m_hot.end(); ++it) {
+            if (it->tick < oldest->tick) oldest = it;
+        }
+
+        m_hotBytes -= imageBytes(oldest->image);
+        victims.append(qMakePair(oldest.key(), oldest->image));
+        m_hot.erase(oldest);
+    }
+
+    return victims;
+}
+
+void PageCache::trimColdLocked()
+{
+    while (m_coldBytes > m_coldBudget && !m_cold.isEmpty()) {
+        auto oldest = m_cold.begin();
+        for (auto it = m_cold.begin(); it != m_cold.end(); ++it) {
+            if (it->tick < oldest->tick) oldest = it;
+        }
+
+        m_coldBytes -= oldest->data.size();
+        m_cold.erase(oldest);
+    }
+}
+
+void PageCache::demote(const QList<QPair<PageCacheKey, QImage>> &victims)
+{
+    for (const auto &victim : victims) {
+        // 压缩比较耗时，放在锁外做
+        ColdEntry entry = compress(victim.second);
+        if (entry.data.isEmpty()) continue;
+
+        QMutexLocker locker(&m_mutex);
+
+        // 压缩期间同一页可能已被重新放入热层，此时冷层副本没有意义
+        if (m_hot.contains(victim.first)) continue;
+
+        auto old = m_cold.find(victim.first);
+        if (old != m_cold.end()) m_coldBytes -= old->data.size();
+
+        entry.tick = ++m_tick;
+        m_cold.insert(victim.first, entry);
+        m_coldBytes += entry.data.size();
+        trimColdLocked();
+    }
+}
+
+PageCache::ColdEntry PageCache::compress(const QImage &image)
+{
+    ColdEntry entry;
+    entry.width = image.width();
+    entry.height = image.height();
+    entry.format = image.format();
+
+    // 页面渲染结果是不透明的：扫描件多为灰度，只需 1 字节/像素；其余去掉 Alpha 存 RGB888
+    const QImage packed = image.allGray()
+            ? image.convertToFormat(QImage::Format_Grayscale8)
+            : image.convertToFormat(QImage::Format_RGB888);
+    entry.packedFormat = packed.format();
+
+    // 去掉每行的对齐填充后再压缩；level 1 速度优先，大片白底依然能压得很小
+    const int rowBytes = packed.width() * (packed.depth() / 8);
+    QByteArray raw;
+    raw.resize(rowBytes * packed.height());
+    for (int y = 0; y < packed.height(); ++y) {
+        std::memcpy(raw.data() + qint64(y) * rowBytes, packed.constScanLine(y), size_t(rowBytes));
+    }
+
+    entry.data = qCompress(raw, 1);
+    return entry;
+}
+
+QImage PageCache::decompress(const ColdEntry &entry)
+{
+    const QByteArray raw = qUncompress(entry.data);
+
+    QImage packed(entry.width, entry.height, entry.packedFormat);
+    if (packed.isNull()) return QImage();
+
+    const int rowBytes = packed.width() * (packed.depth() / 8);
+    if (raw.size() != rowBytes * packed.height()) return QImage();
+
+    for (int y = 0; y < packed.height(); ++y) {
+        std::memcpy(packed.scanLine(y), raw.constData() + qint64(y) * rowBytes, size_t(rowBytes));
+    }
+
+    return packed.convertToFormat(entry.format);
+}
@@ -0,0 +1,92 @@
+﻿#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QByteArray>
+#include <QMutex>
+#include <QList>
+#include <QPair>
+#include <QSet>
+
+// 缓存键：页号 + 渲染倍率（倍率按千分之一取整，避免浮点误差）
+struct PageCacheKey
+{
+    int page = -1;
+    int scaleMilli = 0;
+};
+
+inline bool operator==(const PageCacheKey &a, const PageCacheKey &b)
+{
+    return a.page == b.page && a.scaleMilli == b.scaleMilli;
+}
+
+inline uint qHash(const PageCacheKey &key, uint seed = 0)
+{
+    return qHash((quint64(quint32(key.page)) << 32) | quint32(key.scaleMilli), seed);
+}
+
+// 两级页面缓存（线程安全）
+// - 热层：原始 QImage，命中后可直接上屏
+// - 冷层：热层超出预算时按 LRU 降级，灰度/去 Alpha 后再 zlib 压缩存放，
+//         同样的内存可以多存几倍页面；命中时由调用线程（工作线程）解压并提升回热层
+class PageCache
+{
+public:
+    explicit PageCache(qint64 hotBudgetBytes = 128 * 1024 * 1024,
+                       qint64 coldBudgetBytes = 128 * 1024 * 1024);
+
+    static PageCacheKey keyFor(int page, double scale);
+
+    // 只查热层，不做解压，适合在 GUI 线程调用
+    QImage findHot(const PageCacheKey &key);
+
+    // 先查热层再查冷层；冷层命中会在调用线程解压，请在工作线程调用
+    QImage lookup(const PageCacheKey &key);
+
+    void insert(const PageCacheKey &key, const QImage &image);
+    void removePage(int page);
+    void retainPages(const QSet<int> &pages);   // 只保留这些页（各倍率）的缓存
+    void clear();
+
+    qint64 hotBytes() const;
+    qint64 coldBytes() const;
+
+private:
+    struct HotEntry {
+        QImage image;
+        quint64 tick = 0;
+    };
+
+    struct ColdEntry {
+        QByteArray data;            // zlib 压缩后的扫描线
+        int width = 0;
+        int height = 0;
+        QImage::Format packedFormat = QImage::Format_Invalid;   // 压缩前的紧凑格式
+        QImage::Format format = QImage::Format_Invalid;         // 原始格式（解压后还原）
+        quint64 tick = 0;
+    };
+
+    static qint64 imageBytes(const QImage &image);
+    static ColdEntry compress(const QImage &image);
+    static QImage decompress(const ColdEntry &entry);
+
+    // 调用前需持有 m_mutex；返回被挤出热层、等待压缩的条目
+    QList<QPair<PageCacheKey, QImage>> takeHotOverflowLocked();
+    void trimColdLocked();
+    void demote(const QList<QPair<PageCacheKey, QImage>> &victims);
+
+private:
+    mutable QMutex m_mutex;
+
+    QHash<PageCacheKey, HotEntry> m_hot;
+    QHash<PageCacheKey, ColdEntry> m_cold;
+
+    qint64 m_hotBudget;
+    qint64 m_coldBudget;
+    qint64 m_hotBytes = 0;
+    qint64 m_coldBytes = 0;
+    quint64 m_tick = 0;
+};
+
+#endif // PAGECACHE_H
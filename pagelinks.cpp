@@ -0,0 +1,40 @@
+﻿#include "pagelinks.h"
+
+#include <cmath>
+
+PageLinks::PageLinks(const QVector<PdfLink> &links)
+    : m_links(links)
+    , m_cells(kGridSize * kGridSize)
+{
+    for (int i = 0; i < m_links.size(); ++i) {
+        for (const QRectF &rect : m_links.at(i).rects) {
+            const int c0 = cellCoord(rect.left());
+            const int c1 = cellCoord(rect.right());
+            const int r0 = cellCoord(rect.top());
+            const int r1 = cellCoord(rect.bottom());
+            for (int r = r0; r <= r1; ++r) {
+                for (int c = c0; c <= c1; ++c) {
+                    QVector<int> &cell = m_cells[r * kGridSize + c];
+                    if (cell.isEmpty() || cell.last() != i) cell.append(i);
+                }
+            }
+        }
+    }
+}
+
+int PageLinks::cellCoord(qreal v) const
+{
+    return qBound(0, int(std::floor(v * kGridSize)), kGridSize - 1);
+}
+
+int PageLinks::linkAt(const QPointF &point) const
+{
+    if (m_links.isEmpty() || point.x() < 0 || point.y() < 0 || point.x() > 1 || point.y() > 1) return -1;
+
+    for (const int i : m_cells.at(cellCoord(point.y()) * kGridSize + cellCoord(point.x()))) {
+        for (const QRectF &rect : m_links.at(i).rects) {
+            if (rect.contains(point)) return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,43 @@
+﻿#ifndef PAGELINKS_H
+#define PAGELINKS_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+// 页面上的一个链接
+struct PdfLink
+{
+    QVector<QRectF> rects;      // 页面归一化坐标（0..1，左上为原点）；正文里的网址跨行时有多个
+    int targetPage = -1;        // 文档内跳转的目标页；-1 表示外部链接
+    QString uri;                // 外部链接的地址
+};
+
+// 一页的链接：链接注释（FPDFLink_Enumerate）在前，正文里识别出的网址（FPDFLink_LoadWebLinks）在后
+// - 按粗网格登记每个链接覆盖的格，鼠标移动时只检查所在格里的几个链接
+// - 建好后只读，可在线程间共享
+class PageLinks
+{
+public:
+    PageLinks() = default;
+    explicit PageLinks(const QVector<PdfLink> &links);
+
+    bool isEmpty() const { return m_links.isEmpty(); }
+    int size() const { return m_links.size(); }
+    const PdfLink &at(int index) const { return m_links.at(index); }
+
+    // 点在哪个链接上，重叠时取靠前的（链接注释优先于识别出的网址）；没有返回 -1
+    int linkAt(const QPointF &point) const;
+
+private:
+    static const int kGridSize = 8;
+
+    int cellCoord(qreal v) const;
+
+private:
+    QVector<PdfLink> m_links;
+    QVector<QVector<int>> m_cells;      // kGridSize × kGridSize，每格的链接下标（升序）
+};
+
+#endif // PAGELINKS_H
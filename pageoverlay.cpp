@@ -0,0 +1,85 @@
+﻿#include "pageoverlay.h"
+
+#include <QPainter>
+
+PageOverlay::PageOverlay(QWidget *parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_NoSystemBackground);
+    setFocusPolicy(Qt::NoFocus);
+}
+
+void PageOverlay::setImageRect(const QRect &rect)
+{
+    if (m_imageRect == rect) return;
+    m_imageRect = rect;
+    update();
+}
+
+void PageOverlay::setHighlights(const QVector<QRectF> &rects, const QVector<QRectF> &current)
+{
+    m_highlights = rects;
+    m_current = current;
+    update();
+}
+
+void PageOverlay::clearHighlights()
+{
+    if (m_highlights.isEmpty() && m_current.isEmpty()) return;
+    m_highlights.clear();
+    m_current.clear();
+    update();
+}
+
+void PageOverlay::setSelection(const QVector<QRectF> &rects)
+{
+    if (m_selection.isEmpty() && rects.isEmpty()) return;
+    m_selection = rects;
+    update();
+}
+
+void PageOverlay::setRubberBand(const QRectF &rect)
+{
+    if (m_rubberBand == rect) return;
+    m_rubberBand = rect;
+    update();
+}
+
+QRectF PageOverlay::toWidget(const QRectF &normalized) const
+{
+    return QRectF(m_imageRect.x() + normalized.x() * m_imageRect.width(),
+                  m_imageRect.y() + normalized.y() * m_imageRect.height(),
+                  normalized.width() * m_imageRect.width(),
+                  normalized.height() * m_imageRect.height());
+}
+
+void PageOverlay::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    if (m_imageRect.isEmpty()) return;
+    if (m_highlights.isEmpty() && m_current.isEmpty() && m_selection.isEmpty() && m_rubberBand.isNull()) return;
+
+    QPainter painter(this);
+    painter.setPen(Qt::NoPen);
+    painter.setClipRect(m_imageRect);
+
+    // 正片叠底：像荧光笔，白底变色，黑字仍是黑字
+    painter.setCompositionMode(QPainter::CompositionMode_Multiply);
+    painter.setBrush(QColor(255, 230, 0));
+    for (const QRectF &rect : m_highlights) painter.drawRect(toWidget(rect).adjusted(-1, -1, 1, 1));
+
+    painter.setBrush(QColor(255, 150, 0));
+    for (const QRectF &rect : m_current) painter.drawRect(toWidget(rect).adjusted(-1, -1, 1, 1));
+
+    painter.setBrush(QColor(150, 195, 255));
+    for (const QRectF &rect : m_selection) painter.drawRect(toWidget(rect));
+
+    // 橡皮筋框：半透明填充加细边
+    if (!m_rubberBand.isNull()) {
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter.setPen(QColor(0, 120, 215));
+        painter.setBrush(QColor(0, 120, 215, 40));
+        painter.drawRect(toWidget(m_rubberBand));
+    }
+}
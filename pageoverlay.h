@@ -0,0 +1,43 @@
+﻿#ifndef PAGEOVERLAY_H
+#define PAGEOVERLAY_H
+
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+#include <QWidget>
+
+// 盖在页面图片上的透明层：搜索命中、选中的文字等标记画在这里，不必重新栅格化页面
+// - 坐标一律用页面归一化坐标（0..1，相对渲染出的整页图片，左上为原点），缩放后不用重算
+// - 不接收鼠标事件，点击照常落到下面的显示区
+class PageOverlay : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit PageOverlay(QWidget *parent = nullptr);
+
+    // 页面图片在本控件里的位置（像素）
+    void setImageRect(const QRect &rect);
+
+    // 搜索命中：current 是当前那一处，用更醒目的颜色
+    void setHighlights(const QVector<QRectF> &rects, const QVector<QRectF> &current);
+    void clearHighlights();
+
+    // 选中的文字（每行一个矩形）与框选时的橡皮筋框
+    void setSelection(const QVector<QRectF> &rects);
+    void setRubberBand(const QRectF &rect);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QRectF toWidget(const QRectF &normalized) const;
+
+private:
+    QRect m_imageRect;
+    QVector<QRectF> m_highlights;
+    QVector<QRectF> m_current;
+    QVector<QRectF> m_selection;
+    QRectF m_rubberBand;
+};
+
+#endif // PAGEOVERLAY_H
@@ -1,7 +1,40 @@
 ﻿#include "pdfdocument.h"
+#include "imageresampler.h"
+#include "pdfiumruntime.h"
+#include "pdfsource.h"
 
+#include "fpdf_doc.h"
+#include "fpdf_edit.h"
+#include "fpdf_progressive.h"
+#include "fpdf_text.h"
+#include "fpdf_transformpage.h"
+
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QLocale>
 #include <QtGlobal>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <cstring>
+#include <limits>
+
+// 解码后扫描图的缓存上限
+static const qint64 kScanCacheBudget = 96 * 1024 * 1024;
+
+// 缓存文字版面、链接的页数
+static const int kTextLayoutCacheSize = 32;
+static const int kPageLinksCacheSize = 32;
+
+// 加载期间按读取的字节数汇报进度
+static void reportReadProgress(PdfAccessContext *ctx, qint64 bytes)
+{
+    ctx->bytesRead += bytes;
+    if (!ctx->progress || !ctx->source || ctx->source->size() <= 0) return;
+
+    const int permille = int(qMin<qint64>(999, ctx->bytesRead * 1000 / ctx->source->size()));
+    ctx->progress->setProgressValueAndText(permille, QLocale().formattedDataSize(ctx->bytesRead));
+}
 
 // ---- Custom file callbacks ----
 static int MyGetBlock(void* param,
@@ -9,82 +42,626 @@ static int MyGetBlock(void* param,
                       unsigned char* out_buffer,
                       unsigned long size)
 {
-    QFile* f = static_cast<QFile*>(param);
-    if (!f || !f->isOpen()) return 0;
+    PdfAccessContext* ctx = static_cast<PdfAccessContext*>(param);
+    if (!ctx || !ctx->source) return 0;
+
+    // 记录每次读取的位置、大小与耗时
+    const qint64 start = ctx->trace ? ctx->trace->nowNs() : 0;
+    const bool ok = ctx->source->readBlock(qint64(position), out_buffer, qint64(size));
+    if (ctx->trace) {
+        ctx->trace->record(qint64(position), qint64(size), start, ctx->trace->nowNs() - start, ok);
+    }
+    if (ok) reportReadProgress(ctx, qint64(size));
 
-    if (!f->seek(position)) return 0;
+    return ok ? 1 : 0;
+}
 
-    qint64 n = f->read(reinterpret_cast<char*>(out_buffer), size);
-    return (n == static_cast<qint64>(size)) ? 1 : 0;
+// ---- FPDFAvail callbacks ----
+static FPDF_BOOL MyIsDataAvail(FX_FILEAVAIL *pThis, size_t offset, size_t size)
+{
+    PdfFileAvail *avail = static_cast<PdfFileAvail*>(pThis);
+    if (!avail->source) return 0;
+    return avail->source->isAvailable(qint64(offset), qint64(size)) ? 1 : 0;
 }
 
+static void MyAddSegment(FX_DOWNLOADHINTS *pThis, size_t offset, size_t size)
+{
+    PdfDownloadHints *hints = static_cast<PdfDownloadHints*>(pThis);
+    if (hints->source) hints->source->addHint(qint64(offset), qint64(size));
+}
+
+// 渐进式渲染的暂停回调：任务被取消时让 PDFium 停下来
+struct RenderPause : IFSDK_PAUSE
+{
+    QFutureInterfaceBase *control = nullptr;
+};
+
+static FPDF_BOOL NeedToPauseNow(IFSDK_PAUSE *pThis)
+{
+    RenderPause *pause = static_cast<RenderPause*>(pThis);
+    return (pause->control && pause->control->isCanceled()) ? 1 : 0;
+}
+
+// 判断页面是否是“一张图片铺满整页”的扫描页
+static FPDF_PAGEOBJECT findFullPageImage(FPDF_PAGE page)
+{
+    if (FPDFPage_GetRotation(page) != 0) return nullptr;
+    if (FPDFPage_CountObjects(page) != 1) return nullptr;
+
+    FPDF_PAGEOBJECT obj = FPDFPage_GetObject(page, 0);
+    if (!obj || FPDFPageObj_GetType(obj) != FPDF_PAGEOBJ_IMAGE) return nullptr;
+
+    // 带蒙版/透明度的图片仍交给 PDFium 合成
+    if (FPDFPageObj_HasTransparency(obj)) return nullptr;
+
+    unsigned int pw = 0, ph = 0;
+    if (!FPDFImageObj_GetImagePixelSize(obj, &pw, &ph) || pw == 0 || ph == 0) return nullptr;
+
+    // 只处理不旋转、不翻转的摆放
+    FS_MATRIX m;
+    if (!FPDFPageObj_GetMatrix(obj, &m)) return nullptr;
+    if (m.b != 0 || m.c != 0 || m.a <= 0 || m.d <= 0) return nullptr;
+
+    // 图片需覆盖整个页面（允许 1pt 误差）
+    FS_RECTF box;
+    if (!FPDF_GetPageBoundingBox(page, &box)) return nullptr;
+
+    float l = 0, b = 0, r = 0, t = 0;
+    if (!FPDFPageObj_GetBounds(obj, &l, &b, &r, &t)) return nullptr;
+
+    const float tol = 1.0f;
+    if (qAbs(l - box.left) > tol || qAbs(r - box.right) > tol ||
+        qAbs(t - box.top) > tol || qAbs(b - box.bottom) > tol) {
+        return nullptr;
+    }
+
+    return obj;
+}
+
+template <typename T>
+static void hashValue(QCryptographicHash &hash, const T &value)
+{
+    hash.addData(reinterpret_cast<const char*>(&value), int(sizeof(value)));
+}
+
+// 一个页面对象（及表单 XObject 里的子对象）的摘要：内容流解析后得到的全部可见属性
+static void hashPageObject(QCryptographicHash &hash, FPDF_PAGEOBJECT obj, FPDF_TEXTPAGE text, QByteArray &raw)
+{
+    const int type = FPDFPageObj_GetType(obj);
+    hashValue(hash, type);
+
+    float l = 0, b = 0, r = 0, t = 0;
+    if (FPDFPageObj_GetBounds(obj, &l, &b, &r, &t)) {
+        hashValue(hash, l);
+        hashValue(hash, b);
+        hashValue(hash, r);
+        hashValue(hash, t);
+    }
+
+    FS_MATRIX m;
+    if (FPDFPageObj_GetMatrix(obj, &m)) hashValue(hash, m);
+
+    unsigned int color[4] = {};
+    if (FPDFPageObj_GetFillColor(obj, &color[0], &color[1], &color[2], &color[3])) hashValue(hash, color);
+    if (FPDFPageObj_GetStrokeColor(obj, &color[0], &color[1], &color[2], &color[3])) hashValue(hash, color);
+
+    // 线型与裁剪
+    float width = 0;
+    if (FPDFPageObj_GetStrokeWidth(obj, &width)) hashValue(hash, width);
+    hashValue(hash, FPDFPageObj_GetLineJoin(obj));
+    hashValue(hash, FPDFPageObj_GetLineCap(obj));
+    hashValue(hash, FPDFPageObj_GetDashCount(obj));
+    if (FPDF_CLIPPATH clip = FPDFPageObj_GetClipPath(obj)) hashValue(hash, FPDFClipPath_CountPaths(clip));
+
+    switch (type) {
+    case FPDF_PAGEOBJ_TEXT: {
+        // 字体、字号、渲染模式和这个对象自己的文字
+        float size = 0;
+        if (FPDFTextObj_GetFontSize(obj, &size)) hashValue(hash, size);
+        hashValue(hash, int(FPDFTextObj_GetTextRenderMode(obj)));
+
+        if (FPDF_FONT font = FPDFTextObj_GetFont(obj)) {
+            const size_t len = FPDFFont_GetBaseFontName(font, nullptr, 0);
+            if (len > 0) {
+                raw.resize(int(len));
+                FPDFFont_GetBaseFontName(font, raw.data(), len);
+                hash.addData(raw);
+            }
+        }
+
+        const unsigned long bytes = text ? FPDFTextObj_GetText(obj, text, nullptr, 0) : 0;
+        if (bytes > 0) {
+            raw.resize(int(bytes));
+            FPDFTextObj_GetText(obj, text, reinterpret_cast<FPDF_WCHAR*>(raw.data()), bytes);
+            hash.addData(raw);
+        }
+        break;
+    }
+    case FPDF_PAGEOBJ_IMAGE: {
+        // 图片按压缩后的原始数据比较，不必解码
+        const unsigned long len = FPDFImageObj_GetImageDataRaw(obj, nullptr, 0);
+        hashValue(hash, len);
+        if (len > 0) {
+            raw.resize(int(len));
+            FPDFImageObj_GetImageDataRaw(obj, raw.data(), len);
+            hash.addData(raw);
+        }
+        break;
+    }
+    case FPDF_PAGEOBJ_PATH: {
+        int fillMode = 0;
+        FPDF_BOOL stroke = 0;
+        if (FPDFPath_GetDrawMode(obj, &fillMode, &stroke)) {
+            hashValue(hash, fillMode);
+            hashValue(hash, stroke);
+        }
+
+        const int segments = FPDFPath_CountSegments(obj);
+        hashValue(hash, segments);
+        for (int s = 0; s < segments; ++s) {
+            FPDF_PATHSEGMENT segment = FPDFPath_GetPathSegment(obj, s);
+            hashValue(hash, FPDFPathSegment_GetType(segment));
+            hashValue(hash, FPDFPathSegment_GetClose(segment));
+
+            float x = 0, y = 0;
+            if (FPDFPathSegment_GetPoint(segment, &x, &y)) {
+                hashValue(hash, x);
+                hashValue(hash, y);
+            }
+        }
+        break;
+    }
+    case FPDF_PAGEOBJ_FORM: {
+        // 表单 XObject：逐个子对象摘要
+        const int children = FPDFFormObj_CountObjects(obj);
+        hashValue(hash, children);
+        for (int i = 0; i < children; ++i) {
+            if (FPDF_PAGEOBJECT child = FPDFFormObj_GetObject(obj, static_cast<unsigned long>(i))) {
+                hashPageObject(hash, child, text, raw);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// 页面指纹：尺寸、旋转、对象个数；每个对象的类型、位置、变换、颜色、线型、裁剪与内容摘要；整页文字
+// 内容流的原始字节拿不到（PDFium 没有公开接口），所以比较的是解析后的对象：
+// 只改了不影响对象的部分（注释、多余的 q/Q、等价的写法）的页算作没变，这正是保留缓存想要的
+static QByteArray pageFingerprint(FPDF_PAGE page)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    hashValue(hash, FPDF_GetPageWidthF(page));
+    hashValue(hash, FPDF_GetPageHeightF(page));
+    hashValue(hash, FPDFPage_GetRotation(page));
+
+    const int count = FPDFPage_CountObjects(page);
+    hashValue(hash, count);
+
+    FPDF_TEXTPAGE text = FPDFText_LoadPage(page);
+
+    QByteArray raw;
+    for (int i = 0; i < count; ++i) hashPageObject(hash, FPDFPage_GetObject(page, i), text, raw);
+
+    // 整页文字（按阅读顺序）
+    if (text) {
+        const int chars = FPDFText_CountChars(text);
+        if (chars > 0) {
+            QVector<unsigned short> buffer(chars + 1);
+            const int written = FPDFText_GetText(text, 0, chars, buffer.data());
+            hash.addData(reinterpret_cast<const char*>(buffer.constData()), written * int(sizeof(unsigned short)));
+        }
+        FPDFText_ClosePage(text);
+    }
+
+    return hash.result();
+}
+
+// 页面坐标的矩形 -> 页面归一化坐标（与渲染同样的变换，含 /Rotate）；设备区取大一些保证精度
+static QRectF normalizedRect(FPDF_PAGE page, double left, double top, double right, double bottom)
+{
+    const int device = 1 << 20;
+    int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    FPDF_PageToDevice(page, 0, 0, device, device, 0, left, top, &x1, &y1);
+    FPDF_PageToDevice(page, 0, 0, device, device, 0, right, bottom, &x2, &y2);
+    return QRectF(QPointF(double(x1) / device, double(y1) / device),
+                  QPointF(double(x2) / device, double(y2) / device)).normalized();
+}
 
 PdfDocument::PdfDocument(QObject *parent)
     : QObject(parent)
 {
-    FPDF_InitLibrary();
+    // 库由进程级运行时统一初始化（启动时在后台线程），这里只登记一个文档会话；
+    // 构造在 GUI 线程，不能在这里等初始化，初始化放到 load 里（工作线程）
+    PdfiumRuntime::instance()->acquire();
 }
 
 PdfDocument::~PdfDocument()
 {
+    // 先让后台任务退出：它们引用着本对象和数据源
+    m_generation.fetchAndAddOrdered(1);
+    QList<QFuture<void>> jobs;
+    {
+        QMutexLocker locker(&m_backgroundMutex);
+        jobs.swap(m_backgroundJobs);
+    }
+    for (QFuture<void> &job : jobs) {
+        job.cancel();
+        job.waitForFinished();
+    }
+
     closeCurrent();
-    FPDF_DestroyLibrary();
+    PdfiumRuntime::instance()->release();
 }
 
 void PdfDocument::closeCurrent()
 {
-    if (m_doc) {
-        FPDF_CloseDocument(m_doc);
-        m_doc = nullptr;
+    m_pageCount.storeRelease(0);
+
+    // 不等后台任务：它们和我们用同一个串行 key，此时不可能在执行，过期后自己会退出
+    m_generation.fetchAndAddOrdered(1);
+    {
+        QMutexLocker locker(&m_backgroundMutex);
+        for (QFuture<void> &job : m_backgroundJobs) job.cancel();
     }
 
-    if (m_file) {
-        if (m_file->isOpen()) m_file->close();
-        delete m_file;
-        m_file = nullptr;
+    closeFile(m_file);
+    m_file = nullptr;
+    m_doc = nullptr;
+
+    {
+        QMutexLocker locker(&m_fingerprintMutex);
+        m_fingerprints.clear();
+        m_fingerprintPending.clear();
+        m_documentKey.clear();
     }
 
-    m_access = FPDF_FILEACCESS{};
+    {
+        QMutexLocker locker(&m_layoutMutex);
+        m_textLayouts.clear();
+        m_layoutLru.clear();
+    }
+    {
+        QMutexLocker locker(&m_linksMutex);
+        m_pageLinks.clear();
+        m_linksLru.clear();
+    }
+
+    QMutexLocker locker(&m_scanMutex);
+    m_scanImages.clear();
+    m_scanLru.clear();
+    m_scanBytes = 0;
+    m_notScanPages.clear();
 }
 
-bool PdfDocument::load(const QString &filePath)
+bool PdfDocument::load(const QString &filePath, QFutureInterfaceBase *control)
 {
-    closeCurrent();
+    // 启动时的后台初始化还没做完就在这里等它（只会发生在工作线程）
+    PdfiumRuntime::instance()->ensureInitialized();
 
-    m_file = new QFile(filePath);
-    if (!m_file->open(QIODevice::ReadOnly)) {
-        qWarning() << "Open file failed:" << filePath << m_file->errorString();
-        delete m_file;
-        m_file = nullptr;
+    // 新文件在旁边打开，成功后才换下当前文档：路径错误、文件写到一半时当前文档照常可用
+    PdfOpenFile *file = openFile(filePath, control);
+    if (!file) return false;
+
+    // 加载期间被取消（例如又打开了别的文件）：丢弃刚打开的文档
+    if (control && control->isCanceled()) {
+        closeFile(file);
         return false;
     }
 
-    m_access.m_FileLen = static_cast<unsigned long>(m_file->size());
-    m_access.m_GetBlock = &MyGetBlock;
-    m_access.m_Param = m_file;
+    QByteArray key;
+    {
+        QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+        key = computeDocumentKey(file);
+    }
 
-    // ✅ 不传路径，直接从文件流加载：中文路径/中文名永远没问题
-    m_doc = FPDF_LoadCustomDocument(&m_access, nullptr);
-    if (!m_doc) {
-        unsigned long err = FPDF_GetLastError();
-        qWarning() << "FPDF_LoadCustomDocument failed, error=" << err << "path=" << filePath;
-        closeCurrent();
-        return false;
+    // 换上新文档
+    closeCurrent();
+    m_file = file;
+    m_doc = file->doc;
+    {
+        QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+        m_pageCount.storeRelease(FPDF_GetPageCount(m_doc));
+    }
+    {
+        QMutexLocker locker(&m_fingerprintMutex);
+        m_documentKey = key;
     }
+    if (control) control->setProgressValue(1000);
 
+    // 线性化文件的其余数据在后台补齐；同一文档的任务串行，调用方在同一任务里接着渲染首页时它会排在后面
+    if (file->linearized) {
+        QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+        const int first = qMax(0, FPDFAvail_GetFirstPageNum(m_doc));
+        pdfium.unlock();
+        scheduleBackgroundFetch(m_generation.loadAcquire(), first + 1);
+    }
     return true;
 }
 
+PdfOpenFile *PdfDocument::openFile(const QString &filePath, QFutureInterfaceBase *control)
+{
+    QString error;
+    PdfSource *source = PdfSource::open(filePath, &error, m_mapFiles);
+    if (!source) {
+        qWarning() << "Open file failed:" << filePath << error;
+        return nullptr;
+    }
+
+    // FPDF_FILEACCESS 的长度和 GetBlock 的位置都是 unsigned long：Windows 上只有 32 位，
+    // 超过 4GB 的文件只能走 64 位的内存接口，要求数据源整个映射在内存里
+    const bool large = quint64(source->size()) > std::numeric_limits<unsigned long>::max();
+    if (large && !source->data() && !m_mapFiles) {
+        delete source;
+        source = PdfSource::open(filePath, &error, true);
+        if (!source) {
+            qWarning() << "Open file failed:" << filePath << error;
+            return nullptr;
+        }
+    }
+
+    PdfOpenFile *file = new PdfOpenFile;
+    file->source = source;
+
+    m_ioTrace.reset(source->description());
+    file->context.source = source;
+    file->context.trace = &m_ioTrace;
+    file->context.progress = control;
+    if (control) control->setProgressRange(0, 1000);
+
+    if (large && !source->data()) {
+        qWarning() << "File larger than 4GB must be memory-mapped:" << filePath << source->size();
+        closeFile(file);
+        return nullptr;
+    }
+
+    file->access.m_FileLen = static_cast<unsigned long>(source->size());
+    file->access.m_GetBlock = &MyGetBlock;
+    file->access.m_Param = &file->context;
+
+    QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+    IoPhaseScope phase(&m_ioTrace, QStringLiteral("load"));
+
+    if (large) {
+        // 0. 超大文件：直接交给 PDFium 读映射区（不经过 GetBlock，也就没有 I/O 统计）
+        file->doc = FPDF_LoadMemDocument64(source->data(), size_t(source->size()), nullptr);
+    } else {
+        // 1. 线性化文件：只等首页需要的数据
+        file->doc = loadLinearized(file, pdfium);
+
+        // 2. 否则完整解析（交叉引用表在文件末尾）
+        // ✅ 不传路径，直接从文件流加载：中文路径/中文名永远没问题
+        if (!file->doc) file->doc = FPDF_LoadCustomDocument(&file->access, nullptr);
+    }
+    file->context.progress = nullptr;
+
+    if (!file->doc) {
+        unsigned long err = FPDF_GetLastError();
+        qWarning() << "Load document failed, error=" << err << "path=" << filePath;
+        pdfium.unlock();
+        closeFile(file);
+        return nullptr;
+    }
+    return file;
+}
+
+void PdfDocument::closeFile(PdfOpenFile *file)
+{
+    if (!file) return;
+
+    if (file->doc || file->avail) {
+        QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+        if (file->doc) FPDF_CloseDocument(file->doc);
+        if (file->avail) FPDFAvail_Destroy(file->avail);    // 必须在文档关闭之后
+    }
+    delete file->source;
+    delete file;
+}
+
+FPDF_DOCUMENT PdfDocument::loadLinearized(PdfOpenFile *file, QMutexLocker &pdfium)
+{
+    file->fileAvail.version = 1;
+    file->fileAvail.IsDataAvail = &MyIsDataAvail;
+    file->fileAvail.source = file->source;
+
+    file->hints.version = 1;
+    file->hints.AddSegment = &MyAddSegment;
+    file->hints.source = file->source;
+
+    file->avail = FPDFAvail_Create(&file->fileAvail, &file->access);
+    if (!file->avail) return nullptr;
+
+    // 1. 判断是否线性化：需要文件头部的数据
+    int linearized = FPDFAvail_IsLinearized(file->avail);
+    if (linearized == PDF_LINEARIZATION_UNKNOWN) {
+        file->source->addHint(0, qMin<qint64>(file->source->size(), 1024));
+        pollAvail(file, pdfium, [file]() { return FPDFAvail_IsLinearized(file->avail); });
+        linearized = FPDFAvail_IsLinearized(file->avail);
+    }
+
+    // 2. 文档结构（线性化字典、首页交叉引用表）
+    FPDF_DOCUMENT doc = nullptr;
+    if (linearized == PDF_LINEARIZED &&
+        pollAvail(file, pdfium, [file]() { return FPDFAvail_IsDocAvail(file->avail, &file->hints); }) == PDF_DATA_AVAIL) {
+        doc = FPDFAvail_GetDocument(file->avail, nullptr);
+    }
+
+    if (!doc) {
+        FPDFAvail_Destroy(file->avail);
+        file->avail = nullptr;
+        return nullptr;
+    }
+
+    // 3. 首页：GUI 一般先显示它
+    const int first = qMax(0, FPDFAvail_GetFirstPageNum(doc));
+    pollAvail(file, pdfium, [file, first]() { return FPDFAvail_IsPageAvail(file->avail, first, &file->hints); });
+
+    file->linearized = true;
+    return doc;
+}
+
+int PdfDocument::pollAvail(PdfOpenFile *file, QMutexLocker &pdfium, const std::function<int()> &query) const
+{
+    int status = query();
+    while (status == PDF_DATA_NOTAVAIL) {
+        // 取数据可能很慢（网络、光驱），期间别占着全局锁
+        pdfium.unlock();
+        const qint64 fetched = file->source->fetchHints();
+        pdfium.relock();
+
+        if (fetched <= 0) break;
+        reportReadProgress(&file->context, fetched);
+        status = query();
+    }
+    return status;
+}
+
+void PdfDocument::ensurePageAvailable(QMutexLocker &pdfium, int pageIndex) const
+{
+    PdfOpenFile *file = m_file;
+    if (!file || !file->avail) return;
+
+    // 本地数据源即使没预读也读得到，这里只是按 PDFium 的提示成批取，而不是零碎地读
+    pollAvail(file, pdfium, [file, pageIndex]() { return FPDFAvail_IsPageAvail(file->avail, pageIndex, &file->hints); });
+}
+
+void PdfDocument::scheduleBackgroundFetch(int generation, int fromPage)
+{
+    QMutexLocker locker(&m_backgroundMutex);
+    if (m_generation.loadAcquire() != generation) return;
+
+    trackBackgroundJobLocked(JobScheduler::instance()->run(
+                JobScheduler::Prefetch, this, [this, generation, fromPage]() {
+        backgroundFetch(generation, fromPage);
+    }));
+}
+
+void PdfDocument::trackBackgroundJobLocked(const QFuture<void> &job)
+{
+    for (int i = m_backgroundJobs.size() - 1; i >= 0; --i) {
+        if (m_backgroundJobs[i].isFinished()) m_backgroundJobs.removeAt(i);
+    }
+    m_backgroundJobs.append(job);
+}
+
+void PdfDocument::scheduleFingerprint(int pageIndex)
+{
+    {
+        QMutexLocker locker(&m_fingerprintMutex);
+        if (m_fingerprints.contains(pageIndex) || m_fingerprintPending.contains(pageIndex)) return;
+        m_fingerprintPending.insert(pageIndex);
+    }
+
+    const int generation = m_generation.loadAcquire();
+
+    QMutexLocker locker(&m_backgroundMutex);
+    trackBackgroundJobLocked(JobScheduler::instance()->run(
+                JobScheduler::Indexing, this, [this, generation, pageIndex]() {
+        QByteArray fingerprint;
+        {
+            QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+            if (m_doc && m_generation.loadAcquire() == generation) {
+                IoPhaseScope phase(&m_ioTrace, QStringLiteral("fingerprint"));
+
+                // 线性化/远程文件：这一页的数据可能还没取到
+                ensurePageAvailable(pdfium, pageIndex);
+                FPDF_PAGE page = m_doc ? FPDF_LoadPage(m_doc, pageIndex) : nullptr;
+                if (page) {
+                    fingerprint = pageFingerprint(page);
+                    FPDF_ClosePage(page);
+                }
+            }
+        }
+
+        // 无论成败都撤掉“排队中”，否则这一页以后再也不会补算；过期的任务不碰新文档的表
+        QMutexLocker fingerprints(&m_fingerprintMutex);
+        if (m_generation.loadAcquire() != generation) return;
+        m_fingerprintPending.remove(pageIndex);
+        if (!fingerprint.isEmpty()) m_fingerprints.insert(pageIndex, fingerprint);
+    }));
+}
+
+PdfReloadResult PdfDocument::reload(const QString &filePath)
+{
+    PdfReloadResult result;
+
+    // 1. 旧文档里已有指纹的页（渲染过的页）
+    QHash<int, QByteArray> previous;
+    {
+        QMutexLocker locker(&m_fingerprintMutex);
+        previous = m_fingerprints;
+    }
+
+    // 2. 重新打开（写到一半的文件会失败，由调用方稍后重试）
+    result.ok = load(filePath);
+    if (!result.ok) return result;
+
+    // 3. 逐页比较：指纹相同的页，旧的渲染结果仍然可用
+    QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+    IoPhaseScope phase(&m_ioTrace, QStringLiteral("reload compare"));
+
+    const int count = pageCount();
+    for (auto it = previous.constBegin(); it != previous.constEnd(); ++it) {
+        if (it.key() >= count || !m_doc) continue;
+
+        ensurePageAvailable(pdfium, it.key());
+        FPDF_PAGE page = m_doc ? FPDF_LoadPage(m_doc, it.key()) : nullptr;
+        if (!page) continue;
+
+        const QByteArray fingerprint = pageFingerprint(page);
+        FPDF_ClosePage(page);
+
+        {
+            QMutexLocker locker(&m_fingerprintMutex);
+            m_fingerprints.insert(it.key(), fingerprint);
+        }
+        if (fingerprint == it.value()) result.unchangedPages.insert(it.key());
+    }
+
+    return result;
+}
+
+void PdfDocument::backgroundFetch(int generation, int fromPage)
+{
+    const int count = pageCount();
+    for (int page = fromPage; page < count; ++page) {
+        if (m_generation.loadAcquire() != generation) return;
+
+        // 有可见页任务在排队：让出线程，从当前页接着补
+        if (JobScheduler::shouldYield()) {
+            scheduleBackgroundFetch(generation, page);
+            return;
+        }
+
+        QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+        PdfOpenFile *file = m_file;
+        if (!file || !file->avail || m_generation.loadAcquire() != generation) return;
+
+        IoPhaseScope phase(&m_ioTrace, QStringLiteral("background fetch"));
+        const int status = pollAvail(file, pdfium, [file, page]() {
+            return FPDFAvail_IsPageAvail(file->avail, page, &file->hints);
+        });
+        if (status == PDF_DATA_ERROR) return;
+    }
+}
+
 int PdfDocument::pageCount() const
 {
-    return m_doc ? FPDF_GetPageCount(m_doc) : 0;
+    return m_pageCount.loadAcquire();
 }
 
 QSizeF PdfDocument::pageSize(int pageIndex) const
 {
+    QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
     if (!m_doc) return QSizeF();
 
-    FPDF_PAGE page = FPDF_LoadPage(m_doc, pageIndex);
+    IoPhaseScope phase(&m_ioTrace, QStringLiteral("page size %1").arg(pageIndex + 1));
+
+    ensurePageAvailable(pdfium, pageIndex);
+    FPDF_PAGE page = m_doc ? FPDF_LoadPage(m_doc, pageIndex) : nullptr;
     if (!page) return QSizeF();
 
     QSizeF s(FPDF_GetPageWidth(page), FPDF_GetPageHeight(page));
@@ -92,17 +669,318 @@ QSizeF PdfDocument::pageSize(int pageIndex) const
     return s;
 }
 
-QImage PdfDocument::renderPage(int pageIndex, double renderScale)
+QByteArray PdfDocument::documentKey() const
+{
+    QMutexLocker locker(&m_fingerprintMutex);
+    return m_documentKey;
+}
+
+QByteArray PdfDocument::computeDocumentKey(PdfOpenFile *file)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hashValue(hash, file->source->size());
+    hashValue(hash, FPDF_GetPageCount(file->doc));
+
+    // 1. 文件 ID（trailer 的 /ID）：永久 ID 标识文档，变化 ID 每次保存都会变
+    bool hasId = false;
+    for (const FPDF_FILEIDTYPE type : { FILEIDTYPE_PERMANENT, FILEIDTYPE_CHANGING }) {
+        const unsigned long length = FPDF_GetFileIdentifier(file->doc, type, nullptr, 0);
+        if (length <= 1) continue;
+
+        QByteArray id(int(length), Qt::Uninitialized);
+        FPDF_GetFileIdentifier(file->doc, type, id.data(), length);
+        hash.addData(id);
+        hasId = true;
+    }
+
+    // 2. 没有 ID：用文件首尾各 64KB 的内容，但只用已经在本地的部分。
+    //    这里持着 PDFium 锁；远程的线性化文件此时多半还没取到末尾，不为算键专门去下载一趟。
+    //    同一个文件每次打开时已到手的区间相同，键仍然稳定
+    if (!hasId) {
+        const qint64 size = file->source->size();
+        const qint64 chunk = qMin<qint64>(64 * 1024, size);
+        QByteArray buffer(int(chunk), Qt::Uninitialized);
+        uchar *data = reinterpret_cast<uchar*>(buffer.data());
+        for (const qint64 position : { qint64(0), size - chunk }) {
+            const bool local = file->source->isAvailable(position, chunk);
+            hashValue(hash, local);
+            if (local && file->source->readBlock(position, data, chunk)) hash.addData(buffer);
+        }
+    }
+
+    return hash.result();
+}
+
+QString PdfDocument::pageText(int pageIndex, bool *ok)
+{
+    if (ok) *ok = false;
+
+    QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+    if (!m_doc || pageIndex < 0 || pageIndex >= pageCount()) return QString();
+
+    IoPhaseScope phase(&m_ioTrace, QStringLiteral("text page %1").arg(pageIndex + 1));
+
+    ensurePageAvailable(pdfium, pageIndex);
+    FPDF_PAGE page = m_doc ? FPDF_LoadPage(m_doc, pageIndex) : nullptr;
+    if (!page) return QString();
+    if (ok) *ok = true;
+
+    QString result;
+    FPDF_TEXTPAGE text = FPDFText_LoadPage(page);
+    if (text) {
+        const int chars = FPDFText_CountChars(text);
+        if (chars > 0) {
+            QVector<unsigned short> buffer(chars + 1);
+            const int written = FPDFText_GetText(text, 0, chars, buffer.data());
+            // written 含结尾的 0
+            if (written > 1) result = QString::fromUtf16(buffer.constData(), written - 1);
+        }
+        FPDFText_ClosePage(text);
+    }
+    FPDF_ClosePage(page);
+    return result;
+}
+
+QVector<QVector<QRectF>> PdfDocument::textRects(int pageIndex, const QVector<QPair<int, int>> &ranges)
+{
+    QVector<QVector<QRectF>> result(ranges.size());
+
+    QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+    if (!m_doc || pageIndex < 0 || pageIndex >= pageCount() || ranges.isEmpty()) return result;
+
+    IoPhaseScope phase(&m_ioTrace, QStringLiteral("text rects %1").arg(pageIndex + 1));
+
+    ensurePageAvailable(pdfium, pageIndex);
+    FPDF_PAGE page = m_doc ? FPDF_LoadPage(m_doc, pageIndex) : nullptr;
+    if (!page) return result;
+
+    FPDF_TEXTPAGE text = FPDFText_LoadPage(page);
+    if (text) {
+        for (int i = 0; i < ranges.size(); ++i) {
+            const int count = FPDFText_CountRects(text, ranges.at(i).first, ranges.at(i).second);
+            for (int r = 0; r < count; ++r) {
+                double left = 0, top = 0, right = 0, bottom = 0;
+                if (!FPDFText_GetRect(text, r, &left, &top, &right, &bottom)) continue;
+                result[i].append(normalizedRect(page, left, top, right, bottom));
+            }
+        }
+        FPDFText_ClosePage(text);
+    }
+    FPDF_ClosePage(page);
+    return result;
+}
+
+QSharedPointer<const TextLayout> PdfDocument::textLayout(int pageIndex)
+{
+    {
+        QMutexLocker locker(&m_layoutMutex);
+        const auto it = m_textLayouts.constFind(pageIndex);
+        if (it != m_textLayouts.constEnd()) {
+            m_layoutLru.removeOne(pageIndex);
+            m_layoutLru.append(pageIndex);
+            return it.value();
+        }
+    }
+
+    QString chars;
+    QVector<QRectF> boxes;
+    {
+        QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+        if (!m_doc || pageIndex < 0 || pageIndex >= pageCount()) return QSharedPointer<const TextLayout>();
+
+        IoPhaseScope phase(&m_ioTrace, QStringLiteral("text layout %1").arg(pageIndex + 1));
+
+        ensurePageAvailable(pdfium, pageIndex);
+        FPDF_PAGE page = m_doc ? FPDF_LoadPage(m_doc, pageIndex) : nullptr;
+        if (!page) return QSharedPointer<const TextLayout>();
+
+        FPDF_TEXTPAGE text = FPDFText_LoadPage(page);
+        if (text) {
+            const int count = FPDFText_CountChars(text);
+            if (count > 0) {
+                QVector<unsigned short> buffer(count + 1);
+                const int written = FPDFText_GetText(text, 0, count, buffer.data());
+                if (written > 1) chars = QString::fromUtf16(buffer.constData(), written - 1);
+            }
+
+            // PDFium 生成的字符（换行等）不占位置
+            boxes.resize(chars.size());
+            for (int i = 0; i < chars.size(); ++i) {
+                FS_RECTF box;
+                if (FPDFText_IsGenerated(text, i) == 1 || !FPDFText_GetLooseCharBox(text, i, &box)) continue;
+                boxes[i] = normalizedRect(page, box.left, box.top, box.right, box.bottom);
+            }
+            FPDFText_ClosePage(text);
+        }
+        FPDF_ClosePage(page);
+    }
+
+    // 建网格不碰 PDFium，放到锁外
+    QSharedPointer<const TextLayout> layout(new TextLayout(chars, boxes));
+
+    QMutexLocker locker(&m_layoutMutex);
+    m_textLayouts.insert(pageIndex, layout);
+    m_layoutLru.removeOne(pageIndex);
+    m_layoutLru.append(pageIndex);
+    while (m_layoutLru.size() > kTextLayoutCacheSize) m_textLayouts.remove(m_layoutLru.takeFirst());
+    return layout;
+}
+
+QSharedPointer<const PageLinks> PdfDocument::pageLinks(int pageIndex)
+{
+    {
+        QMutexLocker locker(&m_linksMutex);
+        const auto it = m_pageLinks.constFind(pageIndex);
+        if (it != m_pageLinks.constEnd()) {
+            m_linksLru.removeOne(pageIndex);
+            m_linksLru.append(pageIndex);
+            return it.value();
+        }
+    }
+
+    QVector<PdfLink> links;
+    {
+        QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+        if (!m_doc || pageIndex < 0 || pageIndex >= pageCount()) return QSharedPointer<const PageLinks>();
+
+        IoPhaseScope phase(&m_ioTrace, QStringLiteral("links %1").arg(pageIndex + 1));
+
+        ensurePageAvailable(pdfium, pageIndex);
+        FPDF_PAGE page = m_doc ? FPDF_LoadPage(m_doc, pageIndex) : nullptr;
+        if (!page) return QSharedPointer<const PageLinks>();
+
+        // 1. 链接注释：目标页（直接给的目标或 GoTo 动作）或网址（URI 动作）
+        int position = 0;
+        FPDF_LINK annot = nullptr;
+        while (FPDFLink_Enumerate(page, &position, &annot)) {
+            FS_RECTF rect;
+            if (!FPDFLink_GetAnnotRect(annot, &rect)) continue;
+
+            PdfLink link;
+            link.rects.append(normalizedRect(page, rect.left, rect.top, rect.right, rect.bottom));
+
+            FPDF_DEST dest = FPDFLink_GetDest(m_doc, annot);
+            FPDF_ACTION action = dest ? nullptr : FPDFLink_GetAction(annot);
+            if (action && FPDFAction_GetType(action) == PDFACTION_GOTO) dest = FPDFAction_GetDest(m_doc, action);
+
+            if (dest) {
+                link.targetPage = FPDFDest_GetDestPageIndex(m_doc, dest);
+            } else if (action && FPDFAction_GetType(action) == PDFACTION_URI) {
+                const unsigned long length = FPDFAction_GetURIPath(m_doc, action, nullptr, 0);
+                if (length > 1) {
+                    QByteArray uri(int(length), Qt::Uninitialized);
+                    FPDFAction_GetURIPath(m_doc, action, uri.data(), length);
+                    link.uri = QString::fromUtf8(uri.constData(), int(length) - 1).trimmed();
+                }
+            }
+            if (link.targetPage >= 0 || !link.uri.isEmpty()) links.append(link);
+        }
+
+        // 2. 正文里写出来的网址（没有做成链接注释的）
+        FPDF_TEXTPAGE text = FPDFText_LoadPage(page);
+        FPDF_PAGELINK webLinks = text ? FPDFLink_LoadWebLinks(text) : nullptr;
+        if (webLinks) {
+            const int count = FPDFLink_CountWebLinks(webLinks);
+            for (int i = 0; i < count; ++i) {
+                const int length = FPDFLink_GetURL(webLinks, i, nullptr, 0);
+                if (length <= 1) continue;
+
+                QVector<unsigned short> buffer(length);
+                FPDFLink_GetURL(webLinks, i, buffer.data(), length);
+
+                PdfLink link;
+                link.uri = QString::fromUtf16(buffer.constData(), length - 1);
+                const int rects = FPDFLink_CountRects(webLinks, i);
+                for (int r = 0; r < rects; ++r) {
+                    double left = 0, top = 0, right = 0, bottom = 0;
+                    if (FPDFLink_GetRect(webLinks, i, r, &left, &top, &right, &bottom)) {
+                        link.rects.append(normalizedRect(page, left, top, right, bottom));
+                    }
+                }
+                if (!link.rects.isEmpty()) links.append(link);
+            }
+            FPDFLink_CloseWebLinks(webLinks);
+        }
+        if (text) FPDFText_ClosePage(text);
+        FPDF_ClosePage(page);
+    }
+
+    QSharedPointer<const PageLinks> result(new PageLinks(links));
+
+    QMutexLocker locker(&m_linksMutex);
+    m_pageLinks.insert(pageIndex, result);
+    m_linksLru.removeOne(pageIndex);
+    m_linksLru.append(pageIndex);
+    while (m_linksLru.size() > kPageLinksCacheSize) m_pageLinks.remove(m_linksLru.takeFirst());
+    return result;
+}
+
+QFuture<bool> PdfDocument::loadAsync(const QString &filePath)
+{
+    return JobScheduler::instance()->runControlled<bool>(
+                JobScheduler::Visible, this, [this, filePath](QFutureInterface<bool> &iface) {
+        iface.reportResult(load(filePath, &iface));
+    });
+}
+
+QFuture<QSizeF> PdfDocument::pageSizeAsync(int pageIndex)
+{
+    return JobScheduler::instance()->run<QSizeF>(
+                JobScheduler::Visible, this, [this, pageIndex]() {
+        return pageSize(pageIndex);
+    });
+}
+
+QFuture<QImage> PdfDocument::renderAsync(int pageIndex, double renderScale,
+                                         JobScheduler::Priority priority)
+{
+    return JobScheduler::instance()->runControlled<QImage>(
+                priority, this, [this, pageIndex, renderScale](QFutureInterface<QImage> &iface) {
+        iface.setProgressRange(0, 1);
+        iface.setProgressValue(0);
+
+        QImage img = renderPage(pageIndex, renderScale, &iface);
+        if (iface.isCanceled()) return;
+
+        iface.setProgressValue(1);
+        iface.reportResult(img);
+    });
+}
+
+QImage PdfDocument::renderPage(int pageIndex, double renderScale, QFutureInterfaceBase *control)
 {
-    if (!m_doc) return QImage();
     renderScale = qBound(0.1, renderScale, 20.0);
 
+    QMutexLocker pdfium(PdfiumRuntime::instance()->mutex());
+    if (!m_doc) return QImage();
+
+    IoPhaseScope phase(&m_ioTrace, QStringLiteral("render page %1").arg(pageIndex + 1));
+
+    // 线性化文件：先把这一页需要的数据取齐
+    ensurePageAvailable(pdfium, pageIndex);
+    if (!m_doc) return QImage();
+
     FPDF_PAGE page = FPDF_LoadPage(m_doc, pageIndex);
     if (!page) return QImage();
 
+    // 第一次渲染这一页：在后台补算指纹，文件被改写时用来判断它变没变
+    scheduleFingerprint(pageIndex);
+
     const int w = qMax(1, int(FPDF_GetPageWidth(page) * renderScale));
     const int h = qMax(1, int(FPDF_GetPageHeight(page) * renderScale));
 
+    // ✅ 扫描页：复用已解码的图片，只做重采样，不再重复解码 JPEG/JBIG2
+    QImage scan;
+    if (!cachedScanImage(pageIndex, &scan)) {
+        scan = decodeScanImage(page);
+        cacheScanImage(pageIndex, scan);
+    }
+    if (!scan.isNull()) {
+        FPDF_ClosePage(page);
+        pdfium.unlock();    // 重采样不涉及 PDFium，不必占着全局锁
+        return ImageResampler::resize(scan, QSize(w, h)).convertToFormat(QImage::Format_ARGB32);
+    }
+
     QImage img(w, h, QImage::Format_ARGB32);
     img.fill(Qt::white);
 
@@ -113,10 +991,96 @@ QImage PdfDocument::renderPage(int pageIndex, double renderScale)
         img.bytesPerLine()
     );
 
-    FPDF_RenderPageBitmap(bm, page, 0, 0, w, h, 0, 0);
+    // 渐进式渲染：每个暂停点检查一次是否已取消
+    RenderPause pause;
+    pause.version = 1;
+    pause.NeedToPauseNow = &NeedToPauseNow;
+    pause.user = nullptr;
+    pause.control = control;
+
+    int status = FPDF_RenderPageBitmap_Start(bm, page, 0, 0, w, h, 0, 0, &pause);
+    while (status == FPDF_RENDER_TOBECONTINUED && !(control && control->isCanceled())) {
+        status = FPDF_RenderPage_Continue(page, &pause);
+    }
+    FPDF_RenderPage_Close(page);
 
     FPDFBitmap_Destroy(bm);
     FPDF_ClosePage(page);
 
+    if (status != FPDF_RENDER_DONE) return QImage();
+    return img;
+}
+
+QImage PdfDocument::decodeScanImage(FPDF_PAGE page)
+{
+    FPDF_PAGEOBJECT obj = findFullPageImage(page);
+    if (!obj) return QImage();
+
+    FPDF_BITMAP bm = FPDFImageObj_GetBitmap(obj);
+    if (!bm) return QImage();
+
+    QImage::Format fmt = QImage::Format_Invalid;
+    int bytesPerPixel = 0;
+    switch (FPDFBitmap_GetFormat(bm)) {
+    case FPDFBitmap_Gray: fmt = QImage::Format_Grayscale8; bytesPerPixel = 1; break;
+    case FPDFBitmap_BGR:  fmt = QImage::Format_BGR888;     bytesPerPixel = 3; break;
+    case FPDFBitmap_BGRx: fmt = QImage::Format_RGB32;      bytesPerPixel = 4; break;
+    case FPDFBitmap_BGRA: fmt = QImage::Format_ARGB32;     bytesPerPixel = 4; break;
+    default: break;
+    }
+
+    QImage img;
+    const int w = FPDFBitmap_GetWidth(bm);
+    const int h = FPDFBitmap_GetHeight(bm);
+    if (fmt != QImage::Format_Invalid && w > 0 && h > 0) {
+        img = QImage(w, h, fmt);
+        const uchar *src = static_cast<const uchar*>(FPDFBitmap_GetBuffer(bm));
+        const int stride = FPDFBitmap_GetStride(bm);
+        for (int y = 0; y < h && !img.isNull(); ++y) {
+            std::memcpy(img.scanLine(y), src + qint64(y) * stride, size_t(w) * bytesPerPixel);
+        }
+    }
+
+    FPDFBitmap_Destroy(bm);
     return img;
 }
+
+bool PdfDocument::cachedScanImage(int pageIndex, QImage *image)
+{
+    QMutexLocker locker(&m_scanMutex);
+
+    if (m_notScanPages.contains(pageIndex)) {
+        *image = QImage();
+        return true;
+    }
+
+    auto it = m_scanImages.constFind(pageIndex);
+    if (it == m_scanImages.constEnd()) return false;
+
+    m_scanLru.removeOne(pageIndex);
+    m_scanLru.append(pageIndex);
+    *image = it.value();
+    return true;
+}
+
+void PdfDocument::cacheScanImage(int pageIndex, const QImage &image)
+{
+    QMutexLocker locker(&m_scanMutex);
+
+    // 不是扫描页：之后渲染不再找图、解码（否则每次都解码一遍再整页渲染一遍）
+    if (image.isNull()) {
+        m_notScanPages.insert(pageIndex);
+        return;
+    }
+    if (m_scanImages.contains(pageIndex)) return;
+
+    m_scanImages.insert(pageIndex, image);
+    m_scanLru.append(pageIndex);
+    m_scanBytes += qint64(image.bytesPerLine()) * image.height();
+
+    while (m_scanBytes > kScanCacheBudget && m_scanLru.size() > 1) {
+        const int victim = m_scanLru.takeFirst();
+        const QImage old = m_scanImages.take(victim);
+        m_scanBytes -= qint64(old.bytesPerLine()) * old.height();
+    }
+}
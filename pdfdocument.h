@@ -4,10 +4,72 @@
 #include <QObject>
 #include <QImage>
 #include <QSizeF>
+#include <QRectF>
+#include <QPair>
+#include <QVector>
 #include <QString>
-#include <QFile>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QMutexLocker>
+#include <QSharedPointer>
+
+#include <functional>
 
 #include "fpdfview.h"
+#include "fpdf_dataavail.h"
+#include "jobscheduler.h"
+#include "iotrace.h"
+#include "pagelinks.h"
+#include "textlayout.h"
+
+class PdfSource;
+
+// 传给 MyGetBlock 的上下文：数据源 + I/O 统计 + 加载进度
+struct PdfAccessContext
+{
+    PdfSource *source = nullptr;
+    IoTrace *trace = nullptr;
+    QFutureInterfaceBase *progress = nullptr;   // 只在 load() 期间非空
+    qint64 bytesRead = 0;
+};
+
+// FPDFAvail 的两个回调接口：数据是否已在本地 / 还需要哪些区间
+struct PdfFileAvail : FX_FILEAVAIL
+{
+    PdfSource *source = nullptr;
+};
+
+struct PdfDownloadHints : FX_DOWNLOADHINTS
+{
+    PdfSource *source = nullptr;
+};
+
+// 一次打开的文件：数据源、交给 PDFium 的回调结构与文档句柄
+// PDFium 记住了回调结构的地址，所以整体放在堆上：新文件在旁边打开，成功后整体换上，旧的整体释放
+struct PdfOpenFile
+{
+    PdfSource *source = nullptr;
+    PdfAccessContext context;
+    FPDF_FILEACCESS access{};
+    PdfFileAvail fileAvail;         // 线性化文件的渐进加载
+    PdfDownloadHints hints;
+    FPDF_AVAIL avail = nullptr;
+    FPDF_DOCUMENT doc = nullptr;
+    bool linearized = false;
+};
+
+// 重新加载的结果：unchangedPages 是内容没变的页，它们的渲染缓存可以保留
+struct PdfReloadResult
+{
+    bool ok = false;
+    QSet<int> unchangedPages;
+};
 
 class PdfDocument : public QObject
 {
@@ -16,22 +78,127 @@ public:
     explicit PdfDocument(QObject *parent = nullptr);
     ~PdfDocument();
 
-    bool load(const QString &filePath);
+    // control 非空时：按读取的字节数汇报进度（0..1000，文字为已读取的大小）；期间被取消则丢弃新文档返回 false
+    // 新文件打开成功后才替换当前文档；失败或取消时当前文档不受影响
+    bool load(const QString &filePath, QFutureInterfaceBase *control = nullptr);
     int pageCount() const;
     QSizeF pageSize(int pageIndex) const;
-    QImage renderPage(int pageIndex, double renderScale);
+
+    // control 非空时可中途取消：渲染在 PDFium 的暂停点检查 isCanceled()
+    QImage renderPage(int pageIndex, double renderScale, QFutureInterfaceBase *control = nullptr);
+
+    // 异步接口：在 JobScheduler 上执行，同一文档的任务串行；返回的 future 可 cancel()，并带进度
+    QFuture<bool> loadAsync(const QString &filePath);
+    QFuture<QSizeF> pageSizeAsync(int pageIndex);
+    QFuture<QImage> renderAsync(int pageIndex, double renderScale,
+                                JobScheduler::Priority priority = JobScheduler::Visible);
+
+    // 页面文字（UTF-16，下标与 FPDFText 的字符序号一致）；在工作线程调用
+    // ok 非空时区分“页面打不开”（false）与“页面没有文字”（true，返回空串）
+    QString pageText(int pageIndex, bool *ok = nullptr);
+
+    // 文字范围（起始字符序号, 字符数）所占的矩形，按行合并（FPDFText_GetRect）；
+    // 用页面归一化坐标（0..1，相对 renderPage 输出的图片，左上为原点），每个范围一组。在工作线程调用
+    QVector<QVector<QRectF>> textRects(int pageIndex, const QVector<QPair<int, int>> &ranges);
+
+    // 页面文字与每个字符的框（FPDFText_GetLooseCharBox），供点选、拖选、框选；
+    // 每页只建一次，最近用过的若干页缓存在这里。在工作线程调用
+    QSharedPointer<const TextLayout> textLayout(int pageIndex);
+
+    // 页面上的链接（链接注释与正文里的网址），每页只取一次并缓存。在工作线程调用
+    QSharedPointer<const PageLinks> pageLinks(int pageIndex);
+
+    // 本地文件是否内存映射（默认是），下次 load 起生效。会被别的程序改写的文件（例如监视着改动的）应关掉；
+    // 超过 4GB 的文件在 32 位 unsigned long 的平台上只能映射，不受此开关限制
+    void setMemoryMappingEnabled(bool enabled) { m_mapFiles = enabled; }
+
+    // 本文档的读取统计（按 load / render page N 等阶段汇总）
+    IoTrace *ioTrace() { return &m_ioTrace; }
+
+    // 文件在磁盘上被改写后重新加载（在工作线程调用）；新文件打开成功才替换，失败时当前文档不受影响
+    // 只比较渲染过的页：指纹取自解析后的页面对象（尺寸、位置、变换、颜色、文字与图片数据等），
+    // 内容流的原始字节 PDFium 不提供
+    PdfReloadResult reload(const QString &filePath);
+
+    // 线性化（Fast Web View）文件：首页数据到齐就能显示，其余部分在后台补齐
+    bool isLinearized() const { return m_file && m_file->linearized; }
+
+    // 文档标识（SHA1）：文件 ID、大小与页数；没有 ID 时改用首尾 64KB 中打开时已在本地的内容。
+    // 与路径无关，用作持久化缓存（例如全文索引）的键；未打开时为空
+    QByteArray documentKey() const;
 
 private:
     void closeCurrent();
 
+    // 在旁边打开文件，不动当前文档；失败返回 nullptr
+    PdfOpenFile *openFile(const QString &filePath, QFutureInterfaceBase *control);
+    static void closeFile(PdfOpenFile *file);
+
+    // 线性化加载：成功返回文档，不是线性化文件或数据出错返回 nullptr（调用方回退到普通加载）
+    FPDF_DOCUMENT loadLinearized(PdfOpenFile *file, QMutexLocker &pdfium);
+
+    // 反复询问 query，数据不全时（暂时释放 PDFium 锁）按提示取数据；返回最后的状态
+    // 加载页面前都要调用（pageSize 里也要，所以是 const）
+    int pollAvail(PdfOpenFile *file, QMutexLocker &pdfium, const std::function<int()> &query) const;
+    void ensurePageAvailable(QMutexLocker &pdfium, int pageIndex) const;
+
+    // 后台按页补齐线性化文件的其余数据（预取优先级，有更高优先级任务时让出）
+    void scheduleBackgroundFetch(int generation, int fromPage);
+    void backgroundFetch(int generation, int fromPage);
+
+    // 页面第一次渲染后，以索引优先级补算它的指纹（供 reload 比较）
+    void scheduleFingerprint(int pageIndex);
+
+    // 登记后台任务（析构时要等它们结束），顺便清掉已完成的；调用前需持有 m_backgroundMutex
+    void trackBackgroundJobLocked(const QFuture<void> &job);
+
+    // 打开成功后计算 documentKey（需持有 PDFium 锁）
+    QByteArray computeDocumentKey(PdfOpenFile *file);
+
+    // 扫描件快速通道：整页只有一张图片时，解码一次后缓存，各级缩放由我们自己重采样
+    // 每页只判断一次：不是扫描页（或图片格式重采样器不接受）也记下来，之后直接走 PDFium 渲染
+    QImage decodeScanImage(FPDF_PAGE page);
+    bool cachedScanImage(int pageIndex, QImage *image);     // 判断过返回 true；不是扫描页时 image 为空
+    void cacheScanImage(int pageIndex, const QImage &image); // image 为空：记为不是扫描页
+
 private:
-    FPDF_DOCUMENT m_doc = nullptr;
+    // ✅ 当前打开的文件；数据源优先内存映射，映射不了再用 QFile 读取（都绕开了中文路径问题）
+    PdfOpenFile *m_file = nullptr;
+    FPDF_DOCUMENT m_doc = nullptr;      // 即 m_file->doc
+    bool m_mapFiles = true;
+
+    // 加载时记下页数，GUI 线程查询时不必等 PDFium 锁
+    QAtomicInt m_pageCount = 0;
+
+    mutable IoTrace m_ioTrace;     // pageSize() const 里也要记录读取
+
+    // 每次打开/关闭文档递增，后台任务（补齐数据、算指纹）据此判断自己是否已过期
+    QAtomicInt m_generation = 0;
+    QMutex m_backgroundMutex;
+    QList<QFuture<void>> m_backgroundJobs;
+
+    // 渲染过的页的指纹
+    mutable QMutex m_fingerprintMutex;
+    QHash<int, QByteArray> m_fingerprints;
+    QSet<int> m_fingerprintPending;
+    QByteArray m_documentKey;
+
+    // 文字版面（按页数做 LRU）
+    QMutex m_layoutMutex;
+    QHash<int, QSharedPointer<const TextLayout>> m_textLayouts;
+    QList<int> m_layoutLru;
 
-    // ✅ 用 QFile 读取，彻底绕开中文路径问题
-    QFile *m_file = nullptr;
+    // 链接（按页数做 LRU）
+    QMutex m_linksMutex;
+    QHash<int, QSharedPointer<const PageLinks>> m_pageLinks;
+    QList<int> m_linksLru;
 
-    // ✅ 给 FPDF_LoadCustomDocument 用的 file access
-    FPDF_FILEACCESS m_access{};
+    // 已解码的整页扫描图（按字节预算做 LRU）
+    QMutex m_scanMutex;
+    QHash<int, QImage> m_scanImages;
+    QList<int> m_scanLru;
+    qint64 m_scanBytes = 0;
+    QSet<int> m_notScanPages;
 };
 
 #endif // PDFDOCUMENT_H
@@ -0,0 +1,153 @@
+﻿#include "pdfiumruntime.h"
+#include "fontindex.h"
+#include "jobscheduler.h"
+
+#include "fpdfview.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QVector>
+
+namespace {
+
+// 一页、一个非嵌入的 TrueType 字体（宋体，CJK 映射最慢）和一个字符；xref 偏移现算
+QByteArray fontProbeDocument()
+{
+    const QByteArray content = "BT /F1 12 Tf 2 5 Td (A) Tj ET";
+    const QVector<QByteArray> objects = {
+        "<</Type/Catalog/Pages 2 0 R>>",
+        "<</Type/Pages/Kids[3 0 R]/Count 1>>",
+        "<</Type/Page/Parent 2 0 R/MediaBox[0 0 20 20]/Resources<</Font<</F1 4 0 R>>>>/Contents 5 0 R>>",
+        "<</Type/Font/Subtype/TrueType/BaseFont/SimSun/Encoding/WinAnsiEncoding>>",
+        "<</Length " + QByteArray::number(content.size()) + ">>\nstream\n" + content + "\nendstream",
+    };
+
+    QByteArray pdf = "%PDF-1.4\n";
+    QVector<int> offsets;
+    for (int i = 0; i < objects.size(); ++i) {
+        offsets << pdf.size();
+        pdf += QByteArray::number(i + 1) + " 0 obj\n" + objects.at(i) + "\nendobj\n";
+    }
+
+    const int xref = pdf.size();
+    pdf += "xref\n0 " + QByteArray::number(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (int offset : offsets) pdf += QByteArray::number(offset).rightJustified(10, '0') + " 00000 n \n";
+    pdf += "trailer\n<</Size " + QByteArray::number(objects.size() + 1) + "/Root 1 0 R>>\n";
+    pdf += "startxref\n" + QByteArray::number(xref) + "\n%%EOF\n";
+    return pdf;
+}
+
+} // namespace
+
+PdfiumRuntime *PdfiumRuntime::instance()
+{
+    static PdfiumRuntime runtime;
+    return &runtime;
+}
+
+QFuture<void> PdfiumRuntime::initializeAsync()
+{
+    if (!m_initStarted.testAndSetOrdered(0, 1)) return QFuture<void>();
+
+    // 和首个文档的加载同为 Visible：加载任务拿锁时会排在初始化之后，不会重复初始化
+    return JobScheduler::instance()->run(JobScheduler::Visible, this, [this]() {
+        QElapsedTimer timer;
+        timer.start();
+
+        // 0. 字体索引不需要 PDFium 锁：先建好，别的线程这时仍可以加载文档
+        FontIndex::instance()->refresh();
+        const qint64 indexMs = timer.elapsed();
+
+        QMutexLocker locker(&m_mutex);
+        const qint64 waitMs = timer.elapsed() - indexMs;
+        const bool wasInitialized = m_initialized;
+        initializeLocked();
+        const qint64 initMs = timer.elapsed() - indexMs - waitMs;
+
+        // 1. 库已经被别的线程初始化过，字体多半也已经用上了，不必再预热
+        if (wasInitialized) return;
+
+        // 2. 让 PDFium 通过索引映射一次常用的 CJK 字体，首个文档用到时已经在它的字体缓存里
+        warmUpFontsLocked();
+        qInfo().noquote() << QStringLiteral("PDFium 后台初始化：字体索引 %1 ms，等锁 %2 ms，初始化 %3 ms，字体预热 %4 ms")
+                             .arg(indexMs).arg(waitMs).arg(initMs).arg(timer.elapsed() - indexMs - waitMs - initMs);
+    });
+}
+
+void PdfiumRuntime::ensureInitialized()
+{
+    QMutexLocker locker(&m_mutex);
+    initializeLocked();
+}
+
+void PdfiumRuntime::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_sessions;
+}
+
+void PdfiumRuntime::release()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_sessions > 0) --m_sessions;
+}
+
+int PdfiumRuntime::sessionCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sessions;
+}
+
+void PdfiumRuntime::shutdown()
+{
+    // 持锁等待仍在进行的 PDFium 调用结束
+    QMutexLocker locker(&m_mutex);
+    if (!m_initialized) return;
+
+    if (m_sessions > 0) {
+        qWarning() << "PdfiumRuntime::shutdown with" << m_sessions << "open document(s)";
+        return;
+    }
+
+    FPDF_DestroyLibrary();
+    m_initialized = false;
+}
+
+void PdfiumRuntime::initializeLocked()
+{
+    if (m_initialized) return;
+
+    FPDF_LIBRARY_CONFIG config{};
+    config.version = 2;
+    config.m_pUserFontPaths = nullptr;
+    config.m_pIsolate = nullptr;
+    config.m_v8EmbedderSlot = 0;
+
+    FPDF_InitLibraryWithConfig(&config);
+
+    // 用持久化的字体索引代替 PDFium 默认的系统字体枚举（索引没建好时第一次用到字体时再建）
+    FontIndex::instance()->install();
+    m_initialized = true;
+}
+
+void PdfiumRuntime::warmUpFontsLocked()
+{
+    const QByteArray pdf = fontProbeDocument();
+    FPDF_DOCUMENT doc = FPDF_LoadMemDocument(pdf.constData(), pdf.size(), nullptr);
+    if (!doc) {
+        qWarning() << "Font warm-up document failed to load:" << FPDF_GetLastError();
+        return;
+    }
+
+    if (FPDF_PAGE page = FPDF_LoadPage(doc, 0)) {
+        if (FPDF_BITMAP bitmap = FPDFBitmap_Create(8, 8, 0)) {
+            FPDFBitmap_FillRect(bitmap, 0, 0, 8, 8, 0xFFFFFFFF);
+            FPDF_RenderPageBitmap(bitmap, page, 0, 0, 8, 8, 0, 0);
+            FPDFBitmap_Destroy(bitmap);
+        }
+        FPDF_ClosePage(page);
+    }
+    FPDF_CloseDocument(doc);
+}
@@ -0,0 +1,51 @@
+﻿#ifndef PDFIUMRUNTIME_H
+#define PDFIUMRUNTIME_H
+
+#include <QAtomicInt>
+#include <QFuture>
+#include <QMutex>
+
+// 进程级 PDFium 运行时
+// - 库只初始化一次（FPDF_InitLibraryWithConfig），字体/字形缓存在所有文档间共享
+// - 启动时 main() 调用 initializeAsync()，在后台线程初始化并预热系统字体，GUI 线程不等它
+// - 系统字体通过 FontIndex（持久化的字体索引）提供，不用 PDFium 默认的枚举
+// - 每个 PdfDocument 是一个“会话”：创建时 acquire，析构时 release
+// - 关闭最后一个文档时不销毁库，下次打开不必重新初始化；进程退出前调用 shutdown()
+// - PDFium 不是线程安全的（不同文档也不能并发调用），所有 FPDF_* 调用都要持有 mutex()
+class PdfiumRuntime
+{
+public:
+    static PdfiumRuntime *instance();
+
+    QRecursiveMutex *mutex() { return &m_mutex; }
+
+    // 后台建字体索引、初始化库并预热字体（可重复调用，只做一次）
+    QFuture<void> initializeAsync();
+
+    // 在调用线程上确保库已初始化；后台初始化还在进行时会等它（持锁），不要在 GUI 线程调用
+    void ensureInitialized();
+
+    // 只登记会话，不初始化库：PdfDocument 在 GUI 线程构造，不能被初始化卡住
+    void acquire();
+    void release();
+    int sessionCount() const;
+
+    void shutdown();
+
+private:
+    PdfiumRuntime() = default;
+    Q_DISABLE_COPY(PdfiumRuntime)
+
+    void initializeLocked();
+
+    // 用一个引用非嵌入字体的小文档渲染一次，让 PDFium 提前找到并载入系统字体
+    void warmUpFontsLocked();
+
+private:
+    mutable QRecursiveMutex m_mutex;
+    bool m_initialized = false;
+    int m_sessions = 0;
+    QAtomicInt m_initStarted;      // 不用 m_mutex：GUI 线程调用 initializeAsync 时不能等锁
+};
+
+#endif // PDFIUMRUNTIME_H
@@ -0,0 +1,247 @@
+﻿#include "pdfsource.h"
+#include "httppdfsource.h"
+#include "zippdfsource.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QUrl>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+PdfSource *PdfSource::open(const QString &location, QString *error, bool allowMapping)
+{
+    // 0. 远程文件：按需 Range 读取
+    if (isRemote(location)) {
+        HttpPdfSource *http = new HttpPdfSource(QUrl(location));
+        if (http->open(error)) return http;
+        delete http;
+        return nullptr;
+    }
+
+    // 1. 压缩包里的 PDF：直接读，不解压到临时文件
+    QString archive, entry;
+    if (ZipPdfSource::splitLocation(location, &archive, &entry)) {
+        ZipPdfSource *zip = new ZipPdfSource(archive, entry);
+        if (zip->open(error)) return zip;
+        delete zip;
+        return nullptr;
+    }
+
+    // 2. 优先内存映射
+    if (allowMapping) {
+        MappedPdfSource *mapped = new MappedPdfSource(location);
+        if (mapped->open(error)) return mapped;
+        delete mapped;
+    }
+
+    // 3. 映射不了（空文件、地址空间不足、特殊文件系统等）就退回普通读取
+    FilePdfSource *file = new FilePdfSource(location);
+    if (file->open(error)) return file;
+    delete file;
+
+    return nullptr;
+}
+
+bool PdfSource::isRemote(const QString &location)
+{
+    return location.startsWith(QLatin1String("http://"), Qt::CaseInsensitive) ||
+           location.startsWith(QLatin1String("https://"), Qt::CaseInsensitive);
+}
+
+QString PdfSource::localFile(const QString &location)
+{
+    if (isRemote(location)) return QString();
+
+    QString archive;
+    if (ZipPdfSource::splitLocation(location, &archive, nullptr)) return archive;
+    return location;
+}
+
+bool PdfSource::readBlock(qint64 position, uchar *buffer, qint64 length)
+{
+    if (!readData(position, buffer, length)) return false;
+
+    markAvailable(position, length);
+    return true;
+}
+
+bool PdfSource::isAvailable(qint64 position, qint64 length) const
+{
+    if (length <= 0) return true;
+
+    QMutexLocker locker(&m_availMutex);
+    ensureChunksLocked();
+
+    const qint64 first = position / kChunkSize;
+    const qint64 last = qMin(qint64(m_chunks.size()) - 1, (position + length - 1) / kChunkSize);
+    for (qint64 i = first; i <= last; ++i) {
+        if (!m_chunks.testBit(int(i))) return false;
+    }
+    return true;
+}
+
+void PdfSource::addHint(qint64 position, qint64 length)
+{
+    if (length <= 0) return;
+
+    QMutexLocker locker(&m_availMutex);
+    m_hints.append(qMakePair(position, length));
+}
+
+qint64 PdfSource::fetchHints()
+{
+    QVector<QPair<qint64, qint64>> hints;
+    {
+        QMutexLocker locker(&m_availMutex);
+        hints.swap(m_hints);
+    }
+    if (hints.isEmpty()) return 0;
+
+    // PDFium 给的区间可能重叠、零碎：按位置排序后合并相邻的（间隔不到一个块）
+    std::sort(hints.begin(), hints.end());
+    std::vector<QPair<qint64, qint64>> merged;
+    for (const auto &h : hints) {
+        if (!merged.empty() && h.first <= merged.back().first + merged.back().second + kChunkSize) {
+            const qint64 end = qMax(merged.back().first + merged.back().second, h.first + h.second);
+            merged.back().second = end - merged.back().first;
+        } else {
+            merged.push_back(h);
+        }
+    }
+
+    qint64 fetched = 0;
+    for (const auto &range : merged) {
+        if (isAvailable(range.first, range.second)) continue;
+        if (!fetchRange(range.first, range.second)) break;
+
+        markAvailable(range.first, range.second);
+        fetched += range.second;
+    }
+    return fetched;
+}
+
+bool PdfSource::fetchRange(qint64 position, qint64 length)
+{
+    const qint64 end = qMin(size(), position + length);
+    const qint64 piece = 256 * 1024;
+    QByteArray scratch(int(qMin(piece, qMax<qint64>(1, end - position))), Qt::Uninitialized);
+
+    for (qint64 p = position; p < end; p += scratch.size()) {
+        const qint64 n = qMin(qint64(scratch.size()), end - p);
+        if (!readData(p, reinterpret_cast<uchar*>(scratch.data()), n)) return false;
+    }
+    return true;
+}
+
+void PdfSource::markAvailable(qint64 position, qint64 length)
+{
+    if (length <= 0) return;
+
+    QMutexLocker locker(&m_availMutex);
+    ensureChunksLocked();
+
+    const qint64 first = position / kChunkSize;
+    const qint64 last = qMin(qint64(m_chunks.size()) - 1, (position + length - 1) / kChunkSize);
+    for (qint64 i = first; i <= last; ++i) m_chunks.setBit(int(i));
+}
+
+void PdfSource::ensureChunksLocked() const
+{
+    const qint64 chunks = (size() + kChunkSize - 1) / kChunkSize;
+    if (m_chunks.size() != chunks) m_chunks.resize(int(chunks));
+}
+
+// ---- FilePdfSource ----
+
+FilePdfSource::FilePdfSource(const QString &filePath)
+    : m_file(filePath)
+{
+}
+
+bool FilePdfSource::open(QString *error)
+{
+    if (m_file.open(QIODevice::ReadOnly)) return true;
+
+    if (error) *error = m_file.errorString();
+    return false;
+}
+
+qint64 FilePdfSource::size() const
+{
+    return m_file.size();
+}
+
+bool FilePdfSource::readData(qint64 position, uchar *buffer, qint64 length)
+{
+    if (!m_file.isOpen()) return false;
+    if (!m_file.seek(position)) return false;
+
+    const qint64 n = m_file.read(reinterpret_cast<char*>(buffer), length);
+    return n == length;
+}
+
+QString FilePdfSource::description() const
+{
+    return m_file.fileName();
+}
+
+// ---- MappedPdfSource ----
+
+MappedPdfSource::MappedPdfSource(const QString &filePath)
+    : m_file(filePath)
+{
+}
+
+MappedPdfSource::~MappedPdfSource()
+{
+    if (m_data) m_file.unmap(m_data);
+}
+
+bool MappedPdfSource::open(QString *error)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size <= 0) return false;
+
+    // 映射失败由调用方退回 QFile 读取
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+qint64 MappedPdfSource::size() const
+{
+    return m_size;
+}
+
+bool MappedPdfSource::readData(qint64 position, uchar *buffer, qint64 length)
+{
+    if (position < 0 || length < 0 || position + length > m_size) return false;
+
+    std::memcpy(buffer, m_data + position, size_t(length));
+    return true;
+}
+
+bool MappedPdfSource::fetchRange(qint64 position, qint64 length)
+{
+    // 每个内存页触碰一次，让系统把这段数据从（慢速）存储读进来，不必拷贝
+    const qint64 end = qMin(m_size, position + length);
+    volatile uchar sink = 0;
+    for (qint64 p = qMax<qint64>(0, position); p < end; p += 4096) sink = sink ^ m_data[p];
+    return true;
+}
+
+QString MappedPdfSource::description() const
+{
+    return m_file.fileName();
+}
@@ -0,0 +1,105 @@
+﻿#ifndef PDFSOURCE_H
+#define PDFSOURCE_H
+
+#include <QBitArray>
+#include <QFile>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+// PDFium 自定义读取（FPDF_FILEACCESS）背后的数据源
+// - readBlock 由 GetBlock 回调调用，读到的区间会登记为“已在本地”
+// - 渐进加载（FPDFAvail）时：isAvailable 回答 FX_FILEAVAIL，addHint 收集 FX_DOWNLOADHINTS，
+//   fetchHints 把提示的区间取回来。本地文件相当于预读进内存，远程源则是真正下载
+class PdfSource
+{
+public:
+    virtual ~PdfSource() {}
+
+    virtual qint64 size() const = 0;
+    bool readBlock(qint64 position, uchar *buffer, qint64 length);
+
+    // 整个文件连续地映射在内存里时返回首地址，否则为 nullptr
+    virtual const uchar *data() const { return nullptr; }
+
+    virtual QString description() const = 0;
+
+    bool isAvailable(qint64 position, qint64 length) const;
+    void addHint(qint64 position, qint64 length);
+
+    // 取回已登记的提示区间（阻塞，调用方应先释放 PDFium 全局锁）；返回新取到的字节数，没有进展时返回 0
+    qint64 fetchHints();
+
+    // 按位置创建合适的数据源；失败返回 nullptr 并填写 error
+    // location 可以是本地路径、http:// / https:// 地址，或 archive.zip!/entry.pdf
+    // allowMapping 为 false 时本地文件用普通读取：被监视、可能被别的程序改写的文件不能映射
+    // （Windows 上映射会挡住写入方，Linux 上文件被截短后访问映射区会 SIGBUS）
+    static PdfSource *open(const QString &location, QString *error = nullptr, bool allowMapping = true);
+
+    static bool isRemote(const QString &location);
+
+    // location 对应的本地文件（压缩包位置返回压缩包本身，远程地址返回空）
+    static QString localFile(const QString &location);
+
+protected:
+    virtual bool readData(qint64 position, uchar *buffer, qint64 length) = 0;
+
+    // 把一段数据取到本地；默认实现读一遍，让系统缓存住
+    virtual bool fetchRange(qint64 position, qint64 length);
+
+    void markAvailable(qint64 position, qint64 length);
+
+    static const qint64 kChunkSize = 64 * 1024;
+
+private:
+    void ensureChunksLocked() const;
+
+private:
+    mutable QMutex m_availMutex;
+    mutable QBitArray m_chunks;     // 每 64KB 一位：是否已在本地
+    QVector<QPair<qint64, qint64>> m_hints;
+};
+
+// ✅ 用 QFile 读取，彻底绕开中文路径问题；每次 seek + read（无法映射时的兜底）
+class FilePdfSource : public PdfSource
+{
+public:
+    explicit FilePdfSource(const QString &filePath);
+
+    bool open(QString *error);
+
+    qint64 size() const override;
+    QString description() const override;
+
+protected:
+    bool readData(qint64 position, uchar *buffer, qint64 length) override;
+
+private:
+    QFile m_file;
+};
+
+// 内存映射：GetBlock 直接从映射区 memcpy，没有系统调用
+class MappedPdfSource : public PdfSource
+{
+public:
+    explicit MappedPdfSource(const QString &filePath);
+    ~MappedPdfSource() override;
+
+    bool open(QString *error);
+
+    qint64 size() const override;
+    const uchar *data() const override { return m_data; }
+    QString description() const override;
+
+protected:
+    bool readData(qint64 position, uchar *buffer, qint64 length) override;
+    bool fetchRange(qint64 position, qint64 length) override;
+
+private:
+    QFile m_file;
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+#endif // PDFSOURCE_H
@@ -0,0 +1,146 @@
+﻿#include "singleinstance.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+
+const quint32 kMagic = 0x50444631;     // "PDF1"
+const int kTimeoutMs = 1000;
+
+} // namespace
+
+SingleInstance::SingleInstance(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SingleInstance::~SingleInstance()
+{
+    if (m_server) m_server->close();
+}
+
+QString SingleInstance::serverName()
+{
+    // 每个用户一个实例；名字里不放用户名原文（可能有中文、空格）
+    QByteArray user = qgetenv("USERNAME");
+    if (user.isEmpty()) user = qgetenv("USER");
+    const QByteArray hash = QCryptographicHash::hash(user, QCryptographicHash::Sha1).toHex().left(12);
+    return QStringLiteral("PdfReader-%1").arg(QString::fromLatin1(hash));
+}
+
+bool SingleInstance::forwardToRunning(const QStringList &files, qint64 launchEpochMs)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(kTimeoutMs)) return false;
+
+#ifdef Q_OS_WIN
+    // 本进程是用户刚启动的前台进程：允许对方把窗口提到前台
+    AllowSetForegroundWindow(ASFW_ANY);
+#endif
+
+    QByteArray payload;
+    {
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << kMagic << launchEpochMs << files;
+    }
+
+    QByteArray block;
+    {
+        QDataStream out(&block, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << quint32(payload.size());
+    }
+    block += payload;
+
+    socket.write(block);
+    if (!socket.waitForBytesWritten(kTimeoutMs)) return false;
+
+    // 等对方确认收到，避免我们退出太快导致数据没送到
+    if (!socket.waitForReadyRead(kTimeoutMs)) return false;
+    return socket.read(1) == "1";
+}
+
+bool SingleInstance::listen()
+{
+    // 可以重复调用（启动时与同时启动的实例竞争，失败后会再试）
+    if (!m_server) {
+        m_server = new QLocalServer(this);
+        m_server->setSocketOptions(QLocalServer::UserAccessOption);
+        connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::handleConnection);
+    }
+    if (m_server->isListening()) return true;
+
+    if (m_server->listen(serverName())) return true;
+
+    // 名字被占用：可能是刚刚同时启动的另一个实例，也可能是上次崩溃残留的套接字文件
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(serverName());
+        if (probe.waitForConnected(kTimeoutMs)) {
+            probe.abort();
+            return false;
+        }
+
+        QLocalServer::removeServer(serverName());
+        if (m_server->listen(serverName())) return true;
+    }
+
+    qWarning() << "Single instance server failed:" << m_server->errorString();
+    return false;
+}
+
+void SingleInstance::handleConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+
+        // 数据可能分几次到达：先读 4 字节长度，再读够整个消息
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            if (socket->property("handled").toBool()) return;
+
+            const QByteArray data = socket->peek(socket->bytesAvailable());
+            if (data.size() < 4) return;
+
+            quint32 size = 0;
+            {
+                QDataStream in(data);
+                in.setVersion(QDataStream::Qt_5_0);
+                in >> size;
+            }
+            if (quint32(data.size()) < 4 + size) return;
+
+            socket->read(4 + size);
+            socket->setProperty("handled", true);
+
+            quint32 magic = 0;
+            qint64 launchEpochMs = 0;
+            QStringList files;
+            QDataStream in(data.mid(4, int(size)));
+            in.setVersion(QDataStream::Qt_5_0);
+            in >> magic >> launchEpochMs >> files;
+
+            socket->write("1");
+            socket->flush();
+            socket->disconnectFromServer();
+
+            if (magic != kMagic || in.status() != QDataStream::Ok) return;
+
+            emit activateRequested();
+            if (!files.isEmpty()) emit openRequested(files, launchEpochMs);
+        });
+
+        // 连接建立前数据可能已经到了
+        if (socket->bytesAvailable() > 0) emit socket->readyRead();
+    }
+}
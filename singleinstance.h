@@ -0,0 +1,38 @@
+﻿#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QLocalServer;
+
+// 单实例：后启动的进程把要打开的文件通过 QLocalSocket 交给已经在运行的进程，然后自己退出
+// 已在运行的进程 PDFium、字体、缓存都是热的，打开文件比冷启动快得多
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SingleInstance(QObject *parent = nullptr);
+    ~SingleInstance();
+
+    // 有实例在运行：把文件（可以为空，仅唤起窗口）连同本进程的启动时间交给它，成功返回 true
+    bool forwardToRunning(const QStringList &files, qint64 launchEpochMs);
+
+    // 成为主实例，开始接收其他进程转来的文件；名字被另一个活着的实例占着时返回 false（可再调用）
+    bool listen();
+
+signals:
+    // launchEpochMs：发起方进程启动的时间（毫秒时间戳），用于统计首帧耗时
+    void openRequested(const QStringList &files, qint64 launchEpochMs);
+    void activateRequested();
+
+private:
+    void handleConnection();
+    static QString serverName();
+
+private:
+    QLocalServer *m_server = nullptr;
+};
+
+#endif // SINGLEINSTANCE_H
@@ -0,0 +1,12 @@
+# 单元测试与基准测试：qmake tests/tests.pro && make && make check
+# tst_largefile 要写约 4.5GB 的临时文件，默认跳过，设置 PDFVIEWER_LARGE_FILE_DIR 后才运行
+# 基准测试单独运行，例如 tst_imageresampler -iterations 20 benchmarkResize、tst_textsearch benchmarkIndexOf
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_httppdfsource \
+    tst_imageresampler \
+    tst_largefile \
+    tst_textsearch \
+    tst_textsearch_scalar \
+    tst_zippdfsource
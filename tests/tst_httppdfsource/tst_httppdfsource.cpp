@@ -0,0 +1,244 @@
+﻿#include "httppdfsource.h"
+
+#include <QtTest>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+
+#include <memory>
+
+// 本地替身服务器：只认 GET + Range，长连接，一次服务一个连接
+// 在自己的线程里用阻塞调用，免得与被测代码的阻塞等待互相卡住
+class RangeServer : public QThread
+{
+public:
+    explicit RangeServer(const QByteArray &content, bool supportRanges = true)
+        : m_content(content), m_supportRanges(supportRanges) {}
+
+    ~RangeServer() override
+    {
+        requestInterruption();
+        wait();
+    }
+
+    quint16 startServing()
+    {
+        start();
+        m_ready.acquire();
+        return m_port;
+    }
+
+    int connections() const { return m_connections.loadAcquire(); }
+    int requests() const { return m_requests.loadAcquire(); }
+    qint64 bodyBytesSent() const { return m_bodyBytes.loadAcquire(); }
+
+protected:
+    void run() override
+    {
+        QTcpServer server;
+        server.listen(QHostAddress::LocalHost);
+        m_port = server.serverPort();
+        m_ready.release();
+
+        while (!isInterruptionRequested()) {
+            if (!server.waitForNewConnection(50)) continue;
+            std::unique_ptr<QTcpSocket> socket(server.nextPendingConnection());
+            m_connections.fetchAndAddOrdered(1);
+            serve(socket.get());
+        }
+    }
+
+private:
+    bool readRequest(QTcpSocket *socket, QByteArray *range)
+    {
+        range->clear();
+        QByteArray line;
+        forever {
+            while (!socket->canReadLine()) {
+                if (isInterruptionRequested() || socket->state() != QAbstractSocket::ConnectedState) return false;
+                socket->waitForReadyRead(50);
+            }
+            line = socket->readLine().trimmed();
+            if (line.isEmpty()) return true;
+            if (line.toLower().startsWith("range: bytes=")) *range = line.mid(13);
+        }
+    }
+
+    void serve(QTcpSocket *socket)
+    {
+        QByteArray range;
+        while (readRequest(socket, &range)) {
+            m_requests.fetchAndAddOrdered(1);
+
+            QByteArray head;
+            QByteArray body;
+            const int dash = range.indexOf('-');
+            if (m_supportRanges && dash > 0) {
+                const qint64 first = range.left(dash).toLongLong();
+                const qint64 last = qMin(qint64(m_content.size()) - 1, range.mid(dash + 1).toLongLong());
+                body = m_content.mid(int(first), int(last - first + 1));
+                head = "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " + QByteArray::number(first) + '-' +
+                       QByteArray::number(last) + '/' + QByteArray::number(m_content.size()) + "\r\n";
+            } else {
+                body = m_content;
+                head = "HTTP/1.1 200 OK\r\n";
+            }
+            head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n";
+
+            socket->write(head);
+            // 响应体分段写：客户端中途断开时就停，这样能数出实际送出了多少
+            for (int offset = 0; offset < body.size(); offset += 16 * 1024) {
+                if (socket->state() != QAbstractSocket::ConnectedState) return;
+                const QByteArray part = body.mid(offset, 16 * 1024);
+                socket->write(part);
+                if (!socket->waitForBytesWritten(1000)) return;
+                m_bodyBytes.fetchAndAddOrdered(part.size());
+            }
+        }
+    }
+
+private:
+    QByteArray m_content;
+    bool m_supportRanges = true;
+    QSemaphore m_ready;
+    quint16 m_port = 0;
+    QAtomicInt m_connections;
+    QAtomicInt m_requests;
+    QAtomicInteger<qint64> m_bodyBytes;
+};
+
+// HttpPdfSource：Range 读取、块缓存、跨线程复用连接、拒绝不支持 Range 的服务器
+class TestHttpPdfSource : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsRanges();
+    void cachedBlocksNeedNoRequest();
+    void reusesConnectionAcrossThreads();
+    void rejectsServerWithoutRanges();
+    void failsWhenNothingListens();
+};
+
+static QByteArray sampleContent(int size)
+{
+    QByteArray content(size, Qt::Uninitialized);
+    quint32 x = 2463534242u;
+    for (int i = 0; i < size; ++i) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        content[i] = char(x);
+    }
+    return content;
+}
+
+static QUrl serverUrl(quint16 port, const QString &path = QStringLiteral("/sample.pdf"))
+{
+    return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(port).arg(path));
+}
+
+static QByteArray readBytes(HttpPdfSource *source, qint64 position, qint64 length)
+{
+    QByteArray out(int(length), Qt::Uninitialized);
+    if (!source->readBlock(position, reinterpret_cast<uchar*>(out.data()), length)) return QByteArray();
+    return out;
+}
+
+void TestHttpPdfSource::readsRanges()
+{
+    const QByteArray content = sampleContent(300 * 1024 + 17);
+    RangeServer server(content);
+    HttpPdfSource source(serverUrl(server.startServing()));
+
+    QString error;
+    QVERIFY2(source.open(&error), qPrintable(error));
+    QCOMPARE(source.size(), qint64(content.size()));
+
+    // 跨块、块内、文件末尾
+    QCOMPARE(readBytes(&source, 65530, 20), content.mid(65530, 20));
+    QCOMPARE(readBytes(&source, 1000, 100), content.mid(1000, 100));
+    QCOMPARE(readBytes(&source, content.size() - 9, 9), content.right(9));
+
+    // 越界直接失败，不发请求
+    uchar byte = 0;
+    const int before = server.requests();
+    QVERIFY(!source.readBlock(content.size() - 1, &byte, 2));
+    QCOMPARE(server.requests(), before);
+
+    // 只取了用到的块
+    QVERIFY(source.bytesTransferred() < content.size());
+}
+
+void TestHttpPdfSource::cachedBlocksNeedNoRequest()
+{
+    const QByteArray content = sampleContent(256 * 1024);
+    RangeServer server(content);
+    HttpPdfSource source(serverUrl(server.startServing()));
+    QVERIFY(source.open(nullptr));
+
+    QCOMPARE(readBytes(&source, 70000, 5000), content.mid(70000, 5000));
+    const int requests = server.requests();
+    const qint64 transferred = source.bytesTransferred();
+
+    QCOMPARE(readBytes(&source, 70100, 300), content.mid(70100, 300));
+    QCOMPARE(server.requests(), requests);
+    QCOMPARE(source.bytesTransferred(), transferred);
+}
+
+void TestHttpPdfSource::reusesConnectionAcrossThreads()
+{
+    // 调度器的工作线程轮流读：I/O 都在源自己的线程里，始终只有一个连接
+    const QByteArray content = sampleContent(1024 * 1024);
+    RangeServer server(content);
+    HttpPdfSource source(serverUrl(server.startServing()));
+    QVERIFY(source.open(nullptr));
+
+    QAtomicInt failures;
+    for (int i = 0; i < 6; ++i) {
+        std::unique_ptr<QThread> reader(QThread::create([&, i]() {
+            const qint64 position = qint64(i) * 150 * 1024 + 123;
+            if (readBytes(&source, position, 4096) != content.mid(int(position), 4096)) failures.fetchAndAddOrdered(1);
+        }));
+        reader->start();
+        reader->wait();
+    }
+
+    QCOMPARE(failures.loadAcquire(), 0);
+    QCOMPARE(server.connections(), 1);
+}
+
+void TestHttpPdfSource::rejectsServerWithoutRanges()
+{
+    // 服务器忽略 Range、回 200 整个文件：看到状态行就断开，不读响应体
+    const QByteArray content = sampleContent(32 * 1024 * 1024);
+    RangeServer server(content, false);
+    HttpPdfSource source(serverUrl(server.startServing()));
+
+    QString error;
+    QVERIFY(!source.open(&error));
+    QVERIFY(error.contains(QStringLiteral("Range")));
+    QCOMPARE(source.bytesTransferred(), qint64(0));
+
+    // 服务器察觉断开后就停下，远没有送完
+    QTRY_VERIFY(server.bodyBytesSent() < content.size() / 2);
+}
+
+void TestHttpPdfSource::failsWhenNothingListens()
+{
+    // 没有服务在听的端口
+    quint16 port = 0;
+    {
+        QTcpServer probe;
+        QVERIFY(probe.listen(QHostAddress::LocalHost));
+        port = probe.serverPort();
+    }
+
+    HttpPdfSource source(serverUrl(port));
+    QString error;
+    QVERIFY(!source.open(&error));
+    QVERIFY(!error.isEmpty());
+}
+
+QTEST_MAIN(TestHttpPdfSource)
+#include "tst_httppdfsource.moc"
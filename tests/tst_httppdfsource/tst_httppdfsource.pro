@@ -0,0 +1,23 @@
+QT += core network testlib
+
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_httppdfsource
+
+INCLUDEPATH += $$PWD/../..
+
+# PdfSource::open 也会用到 ZIP 数据源（zlib）
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+else: LIBS += -lz
+
+SOURCES += \
+    tst_httppdfsource.cpp \
+    $$PWD/../../httppdfsource.cpp \
+    $$PWD/../../pdfsource.cpp \
+    $$PWD/../../zippdfsource.cpp
+
+HEADERS += \
+    $$PWD/../../httppdfsource.h \
+    $$PWD/../../pdfsource.h \
+    $$PWD/../../zippdfsource.h
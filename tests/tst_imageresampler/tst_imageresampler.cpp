@@ -0,0 +1,125 @@
+﻿#include "imageresampler.h"
+
+#include <QtTest>
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+
+// ImageResampler：正确性（纯色、透明边缘、不透明的快速路径）与同 QImage::scaled 的耗时对比
+class TestImageResampler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void uniformColorStaysExact();
+    void transparentEdgeHasNoDarkFringe();
+    void opaqueArgbMatchesRgb32();
+    void upscaleKeepsSize();
+
+    void benchmarkResize_data();
+    void benchmarkResize();
+};
+
+// 一页 A4 在 150 dpi 下渲染出的大小，上面画些文字和线条
+static QImage samplePage(QImage::Format format)
+{
+    QImage page(1240, 1754, QImage::Format_ARGB32);
+    page.fill(Qt::white);
+
+    QPainter p(&page);
+    p.setPen(Qt::black);
+    for (int y = 60; y < page.height() - 60; y += 24) {
+        p.drawText(QRect(80, y, page.width() - 160, 20), Qt::AlignLeft,
+                   QStringLiteral("The quick brown fox jumps over the lazy dog 0123456789"));
+    }
+    p.drawLine(80, 40, page.width() - 80, 40);
+    p.end();
+    return page.convertToFormat(format);
+}
+
+void TestImageResampler::uniformColorStaysExact()
+{
+    QImage src(301, 203, QImage::Format_RGB32);
+    src.fill(QColor(12, 200, 77));
+
+    const QImage out = ImageResampler::resize(src, QSize(97, 61));
+    QCOMPARE(out.size(), QSize(97, 61));
+    for (int y = 0; y < out.height(); ++y) {
+        for (int x = 0; x < out.width(); ++x) {
+            QCOMPARE(QColor(out.pixel(x, y)), QColor(12, 200, 77));
+        }
+    }
+}
+
+void TestImageResampler::transparentEdgeHasNoDarkFringe()
+{
+    // 左半不透明的红色，右半完全透明（颜色为黑）：边界上的像素应是半透明的红，而不是暗红
+    QImage src(4, 2, QImage::Format_ARGB32);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 4; ++x) src.setPixel(x, y, x < 1 ? qRgba(255, 0, 0, 255) : qRgba(0, 0, 0, 0));
+    }
+
+    const QImage out = ImageResampler::resize(src, QSize(2, 1));
+    QCOMPARE(out.format(), QImage::Format_ARGB32);
+
+    const QRgb edge = out.pixel(0, 0);
+    QVERIFY(qAbs(qAlpha(edge) - 128) <= 1);
+    QCOMPARE(qRed(edge), 255);
+    QCOMPARE(qAlpha(out.pixel(1, 0)), 0);
+}
+
+void TestImageResampler::opaqueArgbMatchesRgb32()
+{
+    // 整行不透明时 ARGB32 走与 RGB32 相同的快速路径，结果应一致
+    const QImage argb = samplePage(QImage::Format_ARGB32);
+    const QImage rgb = argb.convertToFormat(QImage::Format_RGB32);
+
+    const QImage a = ImageResampler::resize(argb, QSize(413, 585));
+    const QImage b = ImageResampler::resize(rgb, QSize(413, 585));
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) QCOMPARE(a.pixel(x, y) | 0xff000000u, b.pixel(x, y) | 0xff000000u);
+    }
+}
+
+void TestImageResampler::upscaleKeepsSize()
+{
+    const QImage src = samplePage(QImage::Format_Grayscale8).scaled(100, 140);
+    const QImage out = ImageResampler::fit(src, QSize(1000, 1000));
+    QCOMPARE(out.size(), QSize(714, 1000));
+    QCOMPARE(out.format(), QImage::Format_Grayscale8);
+}
+
+void TestImageResampler::benchmarkResize_data()
+{
+    QTest::addColumn<bool>("useQt");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QSize>("size");
+
+    const QSize screen(800, 1131);      // 适应窗口
+    const QSize thumb(124, 175);        // 缩略图
+    QTest::newRow("resampler argb32 -> screen") << false << int(QImage::Format_ARGB32) << screen;
+    QTest::newRow("qt-smooth argb32 -> screen") << true << int(QImage::Format_ARGB32) << screen;
+    QTest::newRow("resampler argb32 -> thumb") << false << int(QImage::Format_ARGB32) << thumb;
+    QTest::newRow("qt-smooth argb32 -> thumb") << true << int(QImage::Format_ARGB32) << thumb;
+    QTest::newRow("resampler gray8 -> screen") << false << int(QImage::Format_Grayscale8) << screen;
+    QTest::newRow("qt-smooth gray8 -> screen") << true << int(QImage::Format_Grayscale8) << screen;
+}
+
+void TestImageResampler::benchmarkResize()
+{
+    QFETCH(bool, useQt);
+    QFETCH(int, format);
+    QFETCH(QSize, size);
+
+    const QImage page = samplePage(QImage::Format(format));
+    QImage out;
+    if (useQt) {
+        QBENCHMARK { out = page.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation); }
+    } else {
+        QBENCHMARK { out = ImageResampler::resize(page, size); }
+    }
+    QCOMPARE(out.size(), size);
+}
+
+QTEST_MAIN(TestImageResampler)
+#include "tst_imageresampler.moc"
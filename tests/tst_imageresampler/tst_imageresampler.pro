@@ -0,0 +1,15 @@
+QT += core gui testlib
+
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_imageresampler
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    tst_imageresampler.cpp \
+    $$PWD/../../imageresampler.cpp
+
+HEADERS += \
+    $$PWD/../../imageresampler.h
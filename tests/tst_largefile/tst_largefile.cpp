@@ -0,0 +1,101 @@
+﻿#include "pdfdocument.h"
+#include "pdfsource.h"
+
+#include <QtTest>
+#include <QColor>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+
+#include <limits>
+#include <memory>
+
+// 超过 4GB 的合成 PDF：对象都放在 4GB 之后，加载、取页面大小、渲染都要能拿到正确的数据。
+// unsigned long 只有 32 位的平台（Windows）上走 FPDF_LoadMemDocument64，其他平台走普通的 GetBlock。
+// 要写一个约 4.5GB 的临时文件（中间是稀疏的空洞，多数文件系统不实际占用），默认跳过：
+//   PDFVIEWER_LARGE_FILE_DIR=<有足够空间的目录> tst_largefile
+class TestLargeFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void sourceIsMapped();
+    void loadsPastFourGigabytes();
+
+private:
+    QString m_path;
+};
+
+static const qint64 kPadding = 4500LL * 1024 * 1024;
+
+// %PDF 头，之后是 NUL 填充（PDF 里算空白），对象和交叉引用表都在 kPadding 之后
+static bool writeLargePdf(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    file.write("%PDF-1.7\n%\xe2\xe3\xcf\xd3\n");
+    if (!file.resize(kPadding) || !file.seek(kPadding)) return false;
+
+    const QByteArray content = "0 0 1 rg 0 0 612 792 re f\n";
+    const QByteArray objects[] = {
+        "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n",
+        "2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n",
+        "3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents 4 0 R >>\nendobj\n",
+        "4 0 obj\n<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "endstream\nendobj\n",
+    };
+
+    QByteArray xref = "xref\n0 5\n0000000000 65535 f \n";
+    for (const QByteArray &object : objects) {
+        // 每项固定 20 字节：10 位偏移（4.5GB 仍是 10 位）
+        xref += QByteArray::number(file.pos()).rightJustified(10, '0') + " 00000 n \n";
+        if (file.write(object) != object.size()) return false;
+    }
+
+    const qint64 start = file.pos();
+    xref += "trailer\n<< /Size 5 /Root 1 0 R >>\nstartxref\n" + QByteArray::number(start) + "\n%%EOF\n";
+    return file.write(xref) == xref.size();
+}
+
+void TestLargeFile::initTestCase()
+{
+    const QString dir = qEnvironmentVariable("PDFVIEWER_LARGE_FILE_DIR");
+    if (dir.isEmpty()) QSKIP("要写约 4.5GB 的临时文件；设置 PDFVIEWER_LARGE_FILE_DIR 后运行");
+
+    m_path = QDir(dir).filePath(QStringLiteral("tst_largefile.pdf"));
+    QVERIFY2(writeLargePdf(m_path), qPrintable(m_path));
+    QVERIFY(QFileInfo(m_path).size() > std::numeric_limits<quint32>::max());
+}
+
+void TestLargeFile::cleanupTestCase()
+{
+    if (!m_path.isEmpty()) QFile::remove(m_path);
+}
+
+void TestLargeFile::sourceIsMapped()
+{
+    // 64 位内存接口要求整个文件映射在内存里
+    QString error;
+    std::unique_ptr<PdfSource> source(PdfSource::open(m_path, &error));
+    QVERIFY2(source, qPrintable(error));
+    QCOMPARE(source->size(), QFileInfo(m_path).size());
+    QVERIFY(source->data() != nullptr);
+}
+
+void TestLargeFile::loadsPastFourGigabytes()
+{
+    PdfDocument doc;
+    QVERIFY(doc.load(m_path));
+    QCOMPARE(doc.pageCount(), 1);
+    QCOMPARE(doc.pageSize(0), QSizeF(612, 792));
+
+    const QImage image = doc.renderPage(0, 0.25);
+    QVERIFY(!image.isNull());
+    QCOMPARE(QColor(image.pixel(image.width() / 2, image.height() / 2)), QColor(Qt::blue));
+}
+
+QTEST_MAIN(TestLargeFile)
+#include "tst_largefile.moc"
@@ -0,0 +1,319 @@
+﻿#include "textindex.h"
+#include "textlayout.h"
+#include "textmatcher.h"
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+#include <vector>
+
+// 文字查找的几个部件：TextMatcher（精确 / 模糊查找、折叠）、TextLayout（点选、选词、选行）、
+// TextIndex 的页文字规范化与下标还原；再加 indexOf 的吞吐量基准（GB/s）
+// tst_textsearch_scalar 是同一份测试，编译时关掉 SSE2
+class TestTextSearch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void indexOfMatchesQString_data();
+    void indexOfMatchesQString();
+    void indexOfEdgeCases();
+    void foldKeepsLength();
+
+    void findFuzzyExact();
+    void findFuzzyWithEdits_data();
+    void findFuzzyWithEdits();
+    void findFuzzyIsWithinDistance();
+
+    void layoutHitTesting();
+    void layoutWordsAndLines();
+
+    void buildPageRemovesSpaces();
+    void originalIndexMapsBack();
+
+    void benchmarkIndexOf_data();
+    void benchmarkIndexOf();
+};
+
+// 小字母表的随机文字：部分匹配多，首尾字符对上而中间不对的情况也多
+static QString randomText(QRandomGenerator &rng, int length, const QString &alphabet)
+{
+    QString text(length, Qt::Uninitialized);
+    for (int i = 0; i < length; ++i) text[i] = alphabet.at(int(rng.bounded(alphabet.size())));
+    return text;
+}
+
+static int levenshtein(const QString &a, const QString &b)
+{
+    std::vector<int> row(size_t(b.size() + 1));
+    for (int j = 0; j <= b.size(); ++j) row[size_t(j)] = j;
+    for (int i = 1; i <= a.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = i;
+        for (int j = 1; j <= b.size(); ++j) {
+            const int up = row[size_t(j)];
+            row[size_t(j)] = qMin(qMin(up + 1, row[size_t(j - 1)] + 1), diagonal + (a.at(i - 1) == b.at(j - 1) ? 0 : 1));
+            diagonal = up;
+        }
+    }
+    return row[size_t(b.size())];
+}
+
+void TestTextSearch::indexOfMatchesQString_data()
+{
+    QTest::addColumn<int>("textLength");
+    QTest::addColumn<int>("needleLength");
+
+    // 文字长度覆盖：不够 8 个起点（只走逐字的尾部）、刚好跨过向量块、较长
+    for (const int textLength : { 1, 7, 8, 9, 15, 16, 17, 40, 1000 }) {
+        for (const int needleLength : { 1, 2, 3, 5, 9, 17 }) {
+            if (needleLength > textLength) continue;
+            QTest::addRow("text %d needle %d", textLength, needleLength) << textLength << needleLength;
+        }
+    }
+}
+
+void TestTextSearch::indexOfMatchesQString()
+{
+    QFETCH(int, textLength);
+    QFETCH(int, needleLength);
+
+    QRandomGenerator rng(quint32(textLength * 131 + needleLength));
+    const QString alphabet = QStringLiteral("ab中");
+    for (int round = 0; round < 50; ++round) {
+        const QString text = randomText(rng, textLength, alphabet);
+        // 一半的查询从文字里截取（一定有匹配），一半随机
+        const QString needle = (round % 2 == 0)
+                ? text.mid(int(rng.bounded(textLength - needleLength + 1)), needleLength)
+                : randomText(rng, needleLength, alphabet);
+
+        for (int from = 0; from <= textLength; from += qMax(1, textLength / 7)) {
+            QCOMPARE(TextMatcher::indexOf(text, needle, from), text.indexOf(needle, from));
+        }
+    }
+}
+
+void TestTextSearch::indexOfEdgeCases()
+{
+    const QString text = QStringLiteral("abcabc");
+    QCOMPARE(TextMatcher::indexOf(text, QString()), 0);
+    QCOMPARE(TextMatcher::indexOf(text, QString(), 6), 6);
+    QCOMPARE(TextMatcher::indexOf(text, QString(), 7), -1);
+    QCOMPARE(TextMatcher::indexOf(text, QStringLiteral("abcabcd")), -1);
+    QCOMPARE(TextMatcher::indexOf(text, QStringLiteral("abc"), -5), 0);
+    QCOMPARE(TextMatcher::indexOf(text, QStringLiteral("abc"), 1), 3);
+    QCOMPARE(TextMatcher::indexOf(text, QStringLiteral("abc"), 4), -1);
+    QCOMPARE(TextMatcher::indexOf(QString(), QStringLiteral("a")), -1);
+
+    // 匹配在最后一个可能的起点上
+    const QString longText = QString(64, QLatin1Char('x')) + QStringLiteral("yz");
+    QCOMPARE(TextMatcher::indexOf(longText, QStringLiteral("xyz")), 63);
+}
+
+void TestTextSearch::foldKeepsLength()
+{
+    // 大小写、全角 ASCII、半角片假名都折叠，长度不变
+    const QString text = QStringLiteral("Ｈｅｌｌｏ World ｱｲｳ");
+    const QString folded = TextMatcher::fold(text);
+    QCOMPARE(folded.size(), text.size());
+    QCOMPARE(folded, QStringLiteral("hello world アイウ"));
+    QCOMPARE(TextMatcher::foldChar(QChar(0x00DF)), QChar(0x00DF));     // ß 不展开
+}
+
+void TestTextSearch::findFuzzyExact()
+{
+    // 不容错时就是不重叠的精确匹配
+    const QVector<TextMatcher::Match> matches = TextMatcher::findFuzzy(QStringLiteral("aaaaa"), QStringLiteral("aa"), 0);
+    QCOMPARE(matches.size(), 2);
+    QCOMPARE(matches.at(0).start, 0);
+    QCOMPARE(matches.at(1).start, 2);
+    QCOMPARE(matches.at(1).length, 2);
+    QCOMPARE(matches.at(1).edits, 0);
+}
+
+void TestTextSearch::findFuzzyWithEdits_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("needle");
+    QTest::addColumn<int>("maxEdits");
+    QTest::addColumn<int>("expectedMatches");
+    QTest::addColumn<int>("expectedEdits");
+
+    QTest::newRow("substitution") << "the quick brown fox" << "quack" << 1 << 1 << 1;
+    QTest::newRow("missing char") << "the quick brown fox" << "brwn" << 1 << 1 << 1;
+    QTest::newRow("extra char") << "the quick brown fox" << "quiick" << 1 << 1 << 1;
+    QTest::newRow("transposition") << "we receive the data" << "recieve" << 2 << 1 << 2;
+    QTest::newRow("too far") << "the quick brown fox" << "qxxck" << 1 << 0 << 0;
+    QTest::newRow("chinese") << "全文索引与模糊查找" << "模湖查找" << 1 << 1 << 1;
+    QTest::newRow("two places") << "colour and color" << "color" << 1 << 2 << 1;
+}
+
+void TestTextSearch::findFuzzyWithEdits()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, needle);
+    QFETCH(int, maxEdits);
+    QFETCH(int, expectedMatches);
+    QFETCH(int, expectedEdits);
+
+    const QVector<TextMatcher::Match> matches = TextMatcher::findFuzzy(text, needle, maxEdits);
+    QCOMPARE(matches.size(), expectedMatches);
+    if (!matches.isEmpty()) QCOMPARE(matches.first().edits, expectedEdits);
+    for (const TextMatcher::Match &match : matches) {
+        QVERIFY(levenshtein(text.mid(match.start, match.length), needle) <= maxEdits);
+    }
+}
+
+void TestTextSearch::findFuzzyIsWithinDistance()
+{
+    // 随机文字：每处匹配的编辑距离不超过容错，匹配按位置递增且互不重叠
+    QRandomGenerator rng(7);
+    const QString alphabet = QStringLiteral("abcd");
+    for (int round = 0; round < 200; ++round) {
+        const QString text = randomText(rng, 200, alphabet);
+        const QString needle = randomText(rng, 4 + int(rng.bounded(6)), alphabet);
+        const int maxEdits = 1 + int(rng.bounded(2));
+
+        int lastEnd = -1;
+        for (const TextMatcher::Match &match : TextMatcher::findFuzzy(text, needle, maxEdits)) {
+            QVERIFY(match.start > lastEnd);
+            QVERIFY(match.edits <= maxEdits);
+            QVERIFY(levenshtein(text.mid(match.start, match.length), needle) <= match.edits);
+            lastEnd = match.start + match.length - 1;
+        }
+    }
+}
+
+// 两行："hello world" 和 "second"，中间是 PDFium 生成的 \r\n（没有框）
+static TextLayout sampleLayout()
+{
+    const QString text = QStringLiteral("hello world\r\nsecond");
+    QVector<QRectF> boxes(text.size());
+    for (int i = 0; i < 11; ++i) boxes[i] = QRectF(0.1 + i * 0.03, 0.1, 0.025, 0.04);
+    for (int i = 13; i < text.size(); ++i) boxes[i] = QRectF(0.1 + (i - 13) * 0.03, 0.2, 0.025, 0.04);
+    return TextLayout(text, boxes);
+}
+
+void TestTextSearch::layoutHitTesting()
+{
+    const TextLayout layout = sampleLayout();
+    QCOMPARE(layout.size(), 19);
+
+    QCOMPARE(layout.charAt(layout.charBox(1).center()), 1);
+    QCOMPARE(layout.charAt(layout.charBox(15).center()), 15);
+    QCOMPARE(layout.charAt(QPointF(0.9, 0.9)), -1);
+    QCOMPARE(layout.charAt(QPointF(-0.1, 0.1)), -1);
+
+    // 不在任何字上：取最近的
+    QCOMPARE(layout.nearestChar(QPointF(0.3, 0.22)), 18);
+    QCOMPARE(layout.nearestChar(QPointF(0.0, 0.0)), 0);
+
+    // 框住第一行
+    const QVector<QPair<int, int>> ranges = layout.rangesIn(QRectF(0.05, 0.05, 0.5, 0.1));
+    QCOMPARE(ranges.size(), 1);
+    QCOMPARE(ranges.first(), qMakePair(0, 11));
+
+    QCOMPARE(layout.selectionRects(0, layout.size()).size(), 2);
+    QCOMPARE(layout.selectionRects(2, 4).size(), 1);
+}
+
+void TestTextSearch::layoutWordsAndLines()
+{
+    const TextLayout layout = sampleLayout();
+
+    QCOMPARE(layout.wordAt(1), qMakePair(0, 5));
+    QCOMPARE(layout.wordAt(7), qMakePair(6, 11));
+    QCOMPARE(layout.wordAt(5), qMakePair(5, 6));     // 空格自成一段
+    QCOMPARE(layout.wordAt(14), qMakePair(13, 19));
+
+    // 选行不含行尾的换行符
+    QCOMPARE(layout.lineAt(3), qMakePair(0, 11));
+    QCOMPARE(layout.lineAt(15), qMakePair(13, 19));
+    QCOMPARE(layout.lineAt(-1), qMakePair(0, 0));
+
+    QCOMPARE(layout.textOf(0, layout.size()), QStringLiteral("hello world\nsecond"));
+    QCOMPARE(layout.textOf(6, 16), QStringLiteral("world\nsec"));
+}
+
+void TestTextSearch::buildPageRemovesSpaces()
+{
+    // 连续空白记成一个间隔：(折叠后的位置, 到此为止删掉的空白数)
+    const TextIndex::PageText page = TextIndex::buildPage(QStringLiteral("Hello  World\r\nＦｏｏ"));
+    QCOMPARE(page.folded, QStringLiteral("helloworldfoo"));
+    QCOMPARE(page.gaps, (QVector<qint32>() << 5 << 2 << 10 << 4));
+
+    const TextIndex::PageText empty = TextIndex::buildPage(QStringLiteral(" \r\n "));
+    QVERIFY(empty.folded.isEmpty());
+    QCOMPARE(empty.gaps, (QVector<qint32>() << 0 << 4));
+}
+
+void TestTextSearch::originalIndexMapsBack()
+{
+    // 每个折叠后的位置都还原到原文里对应的那个字
+    QRandomGenerator rng(11);
+    const QString alphabet = QStringLiteral("aB 中\r\nＡ");
+    for (int round = 0; round < 100; ++round) {
+        const QString raw = randomText(rng, 1 + int(rng.bounded(80)), alphabet);
+        const TextIndex::PageText text = TextIndex::buildPage(raw);
+
+        TextIndex::PageView view;
+        view.folded = text.folded;
+        view.gaps = text.gaps.constData();
+        view.gapCount = text.gaps.size() / 2;
+
+        for (int pos = 0; pos < text.folded.size(); ++pos) {
+            const int original = TextIndex::originalIndex(view, pos);
+            QVERIFY(original >= pos && original < raw.size());
+            QCOMPARE(TextMatcher::foldChar(raw.at(original)), text.folded.at(pos));
+        }
+    }
+}
+
+void TestTextSearch::benchmarkIndexOf_data()
+{
+    QTest::addColumn<bool>("useQt");
+    QTest::addColumn<QString>("needle");
+
+    const QString latin = QStringLiteral("needle in the haystack");
+    const QString cjk = QStringLiteral("全文索引的查找");
+#ifdef MATCHER_NO_SIMD
+    QTest::newRow("matcher(scalar) latin") << false << latin;
+    QTest::newRow("matcher(scalar) cjk") << false << cjk;
+#else
+    QTest::newRow("matcher latin") << false << latin;
+    QTest::newRow("matcher cjk") << false << cjk;
+#endif
+    QTest::newRow("qstring latin") << true << latin;
+    QTest::newRow("qstring cjk") << true << cjk;
+}
+
+void TestTextSearch::benchmarkIndexOf()
+{
+    QFETCH(bool, useQt);
+    QFETCH(QString, needle);
+
+    // 约 16MB 的 UTF-16 文字，首字符常见、整串只在末尾出现一次
+    QRandomGenerator rng(3);
+    QString text = randomText(rng, 8 * 1024 * 1024, QStringLiteral("the haystack 全文索引查找 ne"));
+    text.replace(text.size() - needle.size(), needle.size(), needle);
+    const qint64 bytes = qint64(text.size()) * int(sizeof(QChar));
+
+    const int rounds = 10;
+    int found = -1;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rounds; ++i) {
+        found = useQt ? text.indexOf(needle) : TextMatcher::indexOf(text, needle);
+    }
+    const qint64 ns = qMax<qint64>(1, timer.nsecsElapsed());
+
+    QCOMPARE(found, text.size() - needle.size());
+    const double bytesPerSecond = double(bytes) * rounds * 1e9 / double(ns);
+    QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+    qInfo().noquote() << QStringLiteral("%1：%2 GB/s").arg(QLatin1String(QTest::currentDataTag()))
+                         .arg(bytesPerSecond / 1e9, 0, 'f', 2);
+}
+
+QTEST_MAIN(TestTextSearch)
+#include "tst_textsearch.moc"
@@ -0,0 +1,54 @@
+QT += core gui network testlib
+
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_textsearch
+
+INCLUDEPATH += $$PWD/../..
+
+# TextIndex 依赖 PdfDocument，一并编进来
+SOURCES += \
+    $$PWD/tst_textsearch.cpp \
+    $$PWD/../../fontindex.cpp \
+    $$PWD/../../httppdfsource.cpp \
+    $$PWD/../../imageresampler.cpp \
+    $$PWD/../../iotrace.cpp \
+    $$PWD/../../jobscheduler.cpp \
+    $$PWD/../../pagelinks.cpp \
+    $$PWD/../../pdfdocument.cpp \
+    $$PWD/../../pdfiumruntime.cpp \
+    $$PWD/../../pdfsource.cpp \
+    $$PWD/../../textindex.cpp \
+    $$PWD/../../textlayout.cpp \
+    $$PWD/../../textmatcher.cpp \
+    $$PWD/../../zippdfsource.cpp
+
+HEADERS += \
+    $$PWD/../../fontindex.h \
+    $$PWD/../../httppdfsource.h \
+    $$PWD/../../imageresampler.h \
+    $$PWD/../../iotrace.h \
+    $$PWD/../../jobscheduler.h \
+    $$PWD/../../pagelinks.h \
+    $$PWD/../../pdfdocument.h \
+    $$PWD/../../pdfiumruntime.h \
+    $$PWD/../../pdfsource.h \
+    $$PWD/../../textindex.h \
+    $$PWD/../../textlayout.h \
+    $$PWD/../../textmatcher.h \
+    $$PWD/../../zippdfsource.h
+
+# ---- PDFium ----
+INCLUDEPATH += $$PWD/../../pdfium/include
+LIBS += $$PWD/../../pdfium/lib/pdfium.dll.lib
+
+win32 {
+    QMAKE_POST_LINK += copy /Y $$shell_path($$PWD/../../pdfium/bin/pdfium.dll) $$shell_path($$OUT_PWD)
+}
+
+win32:LIBS += -luser32
+
+# ---- zlib ----
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+else: LIBS += -lz
@@ -0,0 +1,5 @@
+# 同一套测试，TextMatcher 不用 SSE2：覆盖逐字比较的路径，基准测试也可与 tst_textsearch 对照
+include($$PWD/../tst_textsearch/tst_textsearch.pro)
+
+TARGET = tst_textsearch_scalar
+DEFINES += MATCHER_NO_SIMD
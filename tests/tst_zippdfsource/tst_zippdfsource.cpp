@@ -0,0 +1,387 @@
+﻿#include "zippdfsource.h"
+
+#include <QtTest>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include <cstring>
+#include <memory>
+
+#include <zlib.h>
+
+// ZipPdfSource：存储条目直接读；deflate 条目从检查点接着解压（inflatePrime 补位、
+// inflateSetDictionary 恢复 32KB 字典）、流的末尾、块缓存淘汰后重读；zip64 目录
+// 压缩包在测试里现做，内容与原始字节逐一比较
+class TestZipPdfSource : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void listsPdfEntries();
+    void missingEntryFails();
+    void storedEntryReads();
+    void deflatedTailFirst();
+    void deflatedRandomReads();
+    void evictedChunksAreInflatedAgain();
+    void zip64Directory();
+
+private:
+    QString writeArchive(const QString &name, bool zip64);
+
+    QTemporaryDir m_dir;
+    QByteArray m_small;     // 存储条目
+    QByteArray m_large;     // deflate 条目：比块缓存（32MB）大，结尾不在 64KB 边界上
+    QString m_archive;
+};
+
+// 像 PDF 内容流那样可压缩、又不太规则的文字：deflate 产生的是 Huffman 块，块边界多数不在字节边界上
+static QByteArray sampleData(quint32 seed, int size)
+{
+    static const char *const words[] = {
+        "BT", "ET", "Tf", "Td", "Tj", "TJ", "re", "f", "q", "Q", "cm", "/F1", "/F2", "12", "0", "1",
+        "obj", "endobj", "stream", "endstream", "<<", ">>", "/Type", "/Page", "(hello)", "(world)",
+    };
+    const int wordCount = int(sizeof(words) / sizeof(words[0]));
+
+    QRandomGenerator rng(seed);
+    QByteArray data;
+    data.reserve(size + 32);
+    while (data.size() < size) {
+        data += words[rng.bounded(wordCount)];
+        data += (rng.bounded(8) == 0) ? '\n' : ' ';
+        if (rng.bounded(16) == 0) data += QByteArray::number(rng.bounded(100000));
+    }
+    data.resize(size);
+    return data;
+}
+
+// ZIP 里的 deflate 是不带 zlib 头尾的裸流
+static QByteArray rawDeflate(const QByteArray &data)
+{
+    z_stream strm;
+    std::memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return QByteArray();
+
+    QByteArray out(int(deflateBound(&strm, uLong(data.size()))), Qt::Uninitialized);
+    strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    strm.avail_in = uInt(data.size());
+    strm.next_out = reinterpret_cast<Bytef*>(out.data());
+    strm.avail_out = uInt(out.size());
+    const int ret = deflate(&strm, Z_FINISH);
+    out.resize(int(strm.total_out));
+    deflateEnd(&strm);
+    return ret == Z_STREAM_END ? out : QByteArray();
+}
+
+static void put16(QByteArray *out, quint16 v)
+{
+    char b[2];
+    qToLittleEndian(v, b);
+    out->append(b, 2);
+}
+
+static void put32(QByteArray *out, quint32 v)
+{
+    char b[4];
+    qToLittleEndian(v, b);
+    out->append(b, 4);
+}
+
+static void put64(QByteArray *out, quint64 v)
+{
+    char b[8];
+    qToLittleEndian(v, b);
+    out->append(b, 8);
+}
+
+struct ZipItem {
+    QByteArray name;
+    QByteArray data;
+    bool deflate = false;
+};
+
+// 最简单的压缩包：本地文件头 + 数据，中央目录，EOCD；zip64 时大小和偏移都放进扩展字段
+static QByteArray buildZip(const QVector<ZipItem> &items, bool zip64)
+{
+    QByteArray zip;
+    QByteArray cd;
+    const quint16 version = zip64 ? 45 : 20;
+
+    for (const ZipItem &item : items) {
+        const QByteArray payload = item.deflate ? rawDeflate(item.data) : item.data;
+        const quint32 crc = quint32(crc32(0, reinterpret_cast<const Bytef*>(item.data.constData()), uInt(item.data.size())));
+        const quint64 offset = quint64(zip.size());
+        const quint16 method = item.deflate ? Z_DEFLATED : 0;
+
+        QByteArray localExtra;
+        QByteArray centralExtra;
+        if (zip64) {
+            put16(&localExtra, 0x0001);
+            put16(&localExtra, 16);
+            put64(&localExtra, quint64(item.data.size()));
+            put64(&localExtra, quint64(payload.size()));
+
+            put16(&centralExtra, 0x0001);
+            put16(&centralExtra, 24);
+            put64(&centralExtra, quint64(item.data.size()));
+            put64(&centralExtra, quint64(payload.size()));
+            put64(&centralExtra, offset);
+        }
+
+        put32(&zip, 0x04034b50);
+        put16(&zip, version);
+        put16(&zip, 0x0800);                                // 文件名为 UTF-8
+        put16(&zip, method);
+        put16(&zip, 0);                                     // 时间
+        put16(&zip, 0x21);                                  // 日期 1980-01-01
+        put32(&zip, crc);
+        put32(&zip, zip64 ? 0xFFFFFFFFu : quint32(payload.size()));
+        put32(&zip, zip64 ? 0xFFFFFFFFu : quint32(item.data.size()));
+        put16(&zip, quint16(item.name.size()));
+        put16(&zip, quint16(localExtra.size()));
+        zip += item.name;
+        zip += localExtra;
+        zip += payload;
+
+        put32(&cd, 0x02014b50);
+        put16(&cd, version);
+        put16(&cd, version);
+        put16(&cd, 0x0800);
+        put16(&cd, method);
+        put16(&cd, 0);
+        put16(&cd, 0x21);
+        put32(&cd, crc);
+        put32(&cd, zip64 ? 0xFFFFFFFFu : quint32(payload.size()));
+        put32(&cd, zip64 ? 0xFFFFFFFFu : quint32(item.data.size()));
+        put16(&cd, quint16(item.name.size()));
+        put16(&cd, quint16(centralExtra.size()));
+        put16(&cd, 0);                                      // 注释
+        put16(&cd, 0);                                      // 磁盘号
+        put16(&cd, 0);                                      // 内部属性
+        put32(&cd, 0);                                      // 外部属性
+        put32(&cd, zip64 ? 0xFFFFFFFFu : quint32(offset));
+        cd += item.name;
+        cd += centralExtra;
+    }
+
+    const quint64 cdOffset = quint64(zip.size());
+    zip += cd;
+
+    if (zip64) {
+        // zip64 目录记录 + 定位记录
+        const quint64 recordOffset = quint64(zip.size());
+        put32(&zip, 0x06064b50);
+        put64(&zip, 44);                                    // 记录其余部分的长度
+        put16(&zip, 45);
+        put16(&zip, 45);
+        put32(&zip, 0);
+        put32(&zip, 0);
+        put64(&zip, quint64(items.size()));
+        put64(&zip, quint64(items.size()));
+        put64(&zip, quint64(cd.size()));
+        put64(&zip, cdOffset);
+
+        put32(&zip, 0x07064b50);
+        put32(&zip, 0);
+        put64(&zip, recordOffset);
+        put32(&zip, 1);
+    }
+
+    put32(&zip, 0x06054b50);
+    put16(&zip, 0);
+    put16(&zip, 0);
+    put16(&zip, zip64 ? 0xFFFF : quint16(items.size()));
+    put16(&zip, zip64 ? 0xFFFF : quint16(items.size()));
+    put32(&zip, zip64 ? 0xFFFFFFFFu : quint32(cd.size()));
+    put32(&zip, zip64 ? 0xFFFFFFFFu : quint32(cdOffset));
+    put16(&zip, 0);
+    return zip;
+}
+
+static QByteArray readBytes(PdfSource *source, qint64 position, qint64 length)
+{
+    QByteArray out(int(length), Qt::Uninitialized);
+    if (!source->readBlock(position, reinterpret_cast<uchar*>(out.data()), length)) return QByteArray();
+    return out;
+}
+
+QString TestZipPdfSource::writeArchive(const QString &name, bool zip64)
+{
+    QVector<ZipItem> items;
+    ZipItem stored;
+    stored.name = QByteArray("目录/stored.pdf");
+    stored.data = m_small;
+    items.append(stored);
+
+    ZipItem deflated;
+    deflated.name = QByteArray("large.pdf");
+    deflated.data = m_large;
+    deflated.deflate = true;
+    items.append(deflated);
+
+    ZipItem other;
+    other.name = QByteArray("readme.txt");
+    other.data = QByteArray("not a pdf");
+    items.append(other);
+
+    const QString path = m_dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return QString();
+    const QByteArray zip = buildZip(items, zip64);
+    return file.write(zip) == zip.size() ? path : QString();
+}
+
+void TestZipPdfSource::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_small = sampleData(1, 200 * 1024 + 7);
+    m_large = sampleData(2, 40 * 1024 * 1024 + 12345);
+    QVERIFY(!rawDeflate(m_small).isEmpty());
+
+    m_archive = writeArchive(QStringLiteral("sample.zip"), false);
+    QVERIFY(!m_archive.isEmpty());
+}
+
+void TestZipPdfSource::listsPdfEntries()
+{
+    QString error;
+    const QStringList entries = ZipPdfSource::pdfEntries(m_archive, &error);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(entries, QStringList() << QStringLiteral("目录/stored.pdf") << QStringLiteral("large.pdf"));
+
+    QString archive, entry;
+    QVERIFY(ZipPdfSource::splitLocation(ZipPdfSource::makeLocation(m_archive, entries.first()), &archive, &entry));
+    QCOMPARE(archive, m_archive);
+    QCOMPARE(entry, entries.first());
+}
+
+void TestZipPdfSource::missingEntryFails()
+{
+    ZipPdfSource source(m_archive, QStringLiteral("nothing.pdf"));
+    QString error;
+    QVERIFY(!source.open(&error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestZipPdfSource::storedEntryReads()
+{
+    ZipPdfSource source(m_archive, QStringLiteral("目录/stored.pdf"));
+    QString error;
+    QVERIFY2(source.open(&error), qPrintable(error));
+    QCOMPARE(source.size(), qint64(m_small.size()));
+
+    QCOMPARE(readBytes(&source, 0, 10), m_small.left(10));
+    QCOMPARE(readBytes(&source, m_small.size() - 7, 7), m_small.right(7));
+    QCOMPARE(readBytes(&source, 65530, 70000), m_small.mid(65530, 70000));
+
+    QRandomGenerator rng(5);
+    for (int i = 0; i < 100; ++i) {
+        const int position = int(rng.bounded(m_small.size()));
+        const int length = 1 + int(rng.bounded(qMin(20000, m_small.size() - position)));
+        QCOMPARE(readBytes(&source, position, length), m_small.mid(position, length));
+    }
+
+    uchar byte = 0;
+    QVERIFY(!source.readBlock(m_small.size(), &byte, 1));
+}
+
+void TestZipPdfSource::deflatedTailFirst()
+{
+    // 全新的源先读末尾：从头解压到流结束，最后一块不满 64KB
+    ZipPdfSource source(m_archive, QStringLiteral("large.pdf"));
+    QVERIFY(source.open(nullptr));
+    QCOMPARE(source.size(), qint64(m_large.size()));
+
+    QCOMPARE(readBytes(&source, m_large.size() - 1, 1), m_large.right(1));
+    QCOMPARE(readBytes(&source, m_large.size() - 100000, 100000), m_large.right(100000));
+
+    // 一路上记下了检查点；块边界多半不在字节边界，要用 inflatePrime 补位
+    QVERIFY(source.m_index.size() > 10);
+    bool unaligned = false;
+    for (int i = 1; i < source.m_index.size(); ++i) {
+        const ZipPdfSource::Checkpoint &cp = source.m_index.at(i);
+        QCOMPARE(cp.window.size(), 32768);
+        QVERIFY(cp.out > source.m_index.at(i - 1).out);
+        QCOMPARE(cp.window, m_large.mid(int(cp.out - 32768), 32768));
+        if (cp.bits != 0) unaligned = true;
+    }
+    QVERIFY(unaligned);
+}
+
+void TestZipPdfSource::deflatedRandomReads()
+{
+    ZipPdfSource source(m_archive, QStringLiteral("large.pdf"));
+    QVERIFY(source.open(nullptr));
+
+    // 先读到中间，建出前一半的检查点
+    const int middle = m_large.size() / 2;
+    QCOMPARE(readBytes(&source, middle, 4096), m_large.mid(middle, 4096));
+
+    // 紧挨着检查点、跨块、跨检查点
+    for (int i = 1; i < source.m_index.size(); ++i) {
+        const int out = int(source.m_index.at(i).out);
+        QCOMPARE(readBytes(&source, out, 100), m_large.mid(out, 100));
+        QCOMPARE(readBytes(&source, out - 50, 100), m_large.mid(out - 50, 100));
+    }
+    QCOMPARE(readBytes(&source, 3 * 65536 - 10, 20), m_large.mid(3 * 65536 - 10, 20));
+    QCOMPARE(readBytes(&source, 1000000, 2500000), m_large.mid(1000000, 2500000));
+
+    // 随机位置，前后都有（后一半要接着往后解压）
+    QRandomGenerator rng(9);
+    for (int i = 0; i < 200; ++i) {
+        const int position = int(rng.bounded(m_large.size()));
+        const int length = 1 + int(rng.bounded(qMin(300000, m_large.size() - position)));
+        QCOMPARE(readBytes(&source, position, length), m_large.mid(position, length));
+    }
+
+    // 末尾
+    QCOMPARE(readBytes(&source, m_large.size() - 12345, 12345), m_large.right(12345));
+    uchar byte = 0;
+    QVERIFY(!source.readBlock(m_large.size() - 1, &byte, 2));
+}
+
+void TestZipPdfSource::evictedChunksAreInflatedAgain()
+{
+    ZipPdfSource source(m_archive, QStringLiteral("large.pdf"));
+    QVERIFY(source.open(nullptr));
+
+    // 顺序读完整个条目：解压出的数据超过缓存上限，前面的块被淘汰
+    const int step = 1024 * 1024;
+    for (int position = 0; position < m_large.size(); position += step) {
+        const int length = qMin(step, m_large.size() - position);
+        QCOMPARE(readBytes(&source, position, length), m_large.mid(position, length));
+    }
+    QVERIFY(source.m_cachedBytes <= 32 * 1024 * 1024);
+    QVERIFY(!source.m_chunks.contains(0));
+
+    // 再读被淘汰的部分：从检查点重新解压
+    QCOMPARE(readBytes(&source, 0, 100), m_large.left(100));
+    QCOMPARE(readBytes(&source, 5 * 1024 * 1024 + 777, 300000), m_large.mid(5 * 1024 * 1024 + 777, 300000));
+}
+
+void TestZipPdfSource::zip64Directory()
+{
+    // 大小和偏移都在 zip64 扩展字段里，目录位置在 zip64 目录记录里
+    const QString archive = writeArchive(QStringLiteral("zip64.zip"), true);
+    QVERIFY(!archive.isEmpty());
+
+    QCOMPARE(ZipPdfSource::pdfEntries(archive).size(), 2);
+
+    ZipPdfSource stored(archive, QStringLiteral("目录/stored.pdf"));
+    QString error;
+    QVERIFY2(stored.open(&error), qPrintable(error));
+    QCOMPARE(stored.size(), qint64(m_small.size()));
+    QCOMPARE(readBytes(&stored, 1234, 50000), m_small.mid(1234, 50000));
+
+    ZipPdfSource deflated(archive, QStringLiteral("large.pdf"));
+    QVERIFY2(deflated.open(&error), qPrintable(error));
+    QCOMPARE(deflated.size(), qint64(m_large.size()));
+    QCOMPARE(readBytes(&deflated, m_large.size() - 5000, 5000), m_large.right(5000));
+}
+
+QTEST_MAIN(TestZipPdfSource)
+#include "tst_zippdfsource.moc"
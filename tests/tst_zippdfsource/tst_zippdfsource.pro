@@ -0,0 +1,23 @@
+QT += core network testlib
+
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_zippdfsource
+
+INCLUDEPATH += $$PWD/../..
+
+# 压缩包在测试里用 zlib 现做
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+else: LIBS += -lz
+
+SOURCES += \
+    tst_zippdfsource.cpp \
+    $$PWD/../../httppdfsource.cpp \
+    $$PWD/../../pdfsource.cpp \
+    $$PWD/../../zippdfsource.cpp
+
+HEADERS += \
+    $$PWD/../../httppdfsource.h \
+    $$PWD/../../pdfsource.h \
+    $$PWD/../../zippdfsource.h
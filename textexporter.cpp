@@ -0,0 +1,195 @@
+﻿#include "textexporter.h"
+#include "pdfdocument.h"
+#include "pdfsource.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFutureInterface>
+#include <QSaveFile>
+#include <QThread>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// 类内初始化的静态常量在 qBound 里按引用传递（ODR 使用），需要定义
+const int TextExporter::kDefaultWorkers;
+const int TextExporter::kMaxWorkers;
+
+TextExporter::TextExporter(const QString &source, const Options &options)
+    : m_source(source)
+    , m_options(options)
+{
+}
+
+bool TextExporter::exportTo(const QString &output, QFutureInterfaceBase *control)
+{
+    m_error.clear();
+    m_ready.clear();
+    m_nextPage = 0;
+    m_nextToWrite = 0;
+    m_stop = false;
+
+    // 1. 先在调用线程打开一份，拿到页数；它也是 0 号工作线程的文档
+    std::vector<std::unique_ptr<PdfDocument>> docs;
+    docs.emplace_back(new PdfDocument);
+    if (!docs.front()->load(m_source)) {
+        m_error = QStringLiteral("无法打开 %1").arg(m_source);
+        return false;
+    }
+    m_pageCount = docs.front()->pageCount();
+
+    int workers = m_options.workers > 0 ? m_options.workers : kDefaultWorkers;
+    workers = qBound(1, workers, kMaxWorkers);
+    if (PdfSource::isRemote(m_source)) workers = 1;
+    workers = qMin(workers, qMax(1, m_pageCount));
+    m_window = m_options.window > 0 ? m_options.window : workers * 4;
+
+    // 2. 目标：普通文件先写临时文件，commit 时替换；"-" 为标准输出
+    std::unique_ptr<QFileDevice> out;
+    if (output == QLatin1String("-")) {
+        auto *file = new QFile;
+        out.reset(file);
+        if (!file->open(stdout, QIODevice::WriteOnly)) {
+            m_error = QStringLiteral("无法写入标准输出");
+            return false;
+        }
+    } else {
+        auto *file = new QSaveFile(output);
+        out.reset(file);
+        if (!file->open(QIODevice::WriteOnly)) {
+            m_error = QStringLiteral("无法写入 %1：%2").arg(output, file->errorString());
+            return false;
+        }
+    }
+    if (control) control->setProgressRange(0, m_pageCount);
+
+    // 3. 工作线程：其余的文档在各自线程里打开，互不等待
+    for (int i = 1; i < workers; ++i) docs.emplace_back(new PdfDocument);
+    m_activeWorkers = workers;
+
+    std::vector<QThread*> threads;
+    for (int i = 0; i < workers; ++i) {
+        PdfDocument *doc = docs[i].get();
+        const bool needsLoad = (i > 0);
+        QThread *t = QThread::create([this, doc, needsLoad]() { workerLoop(doc, needsLoad); });
+        t->setObjectName(QStringLiteral("TextExport-%1").arg(i));
+        t->start();
+        threads.push_back(t);
+    }
+
+    // 4. 按页序写出：下一页没抽好就等，写出一页就让窗口往前挪
+    QMutexLocker locker(&m_mutex);
+    while (m_nextToWrite < m_pageCount) {
+        // 工作线程报了错（某页打不开）：不写半截
+        if (!m_error.isEmpty()) break;
+
+        if (control && control->isCanceled()) {
+            m_error = QStringLiteral("已取消");
+            break;
+        }
+
+        const auto it = m_ready.find(m_nextToWrite);
+        if (it == m_ready.end()) {
+            // 工作线程全退出了（文档都没打开）还缺页：不再等
+            if (m_activeWorkers == 0) {
+                m_error = QStringLiteral("第 %1 页的文字抽取失败").arg(m_nextToWrite + 1);
+                break;
+            }
+            m_pageReady.wait(&m_mutex, 100);    // 定时醒来检查取消
+            continue;
+        }
+
+        const QByteArray bytes = it.value();
+        m_ready.erase(it);
+        const int written = ++m_nextToWrite;
+        m_spaceAvailable.wakeAll();
+
+        locker.unlock();
+        const bool ok = (out->write(bytes) == bytes.size());
+        if (control) control->setProgressValue(written);
+        locker.relock();
+
+        if (!ok) {
+            m_error = QStringLiteral("写入失败：%1").arg(out->errorString());
+            break;
+        }
+    }
+    m_stop = true;
+    m_spaceAvailable.wakeAll();
+    locker.unlock();
+
+    // 5. 等工作线程退出（它们持有文档指针）
+    for (QThread *t : threads) {
+        t->wait();
+        delete t;
+    }
+    m_ready.clear();
+
+    if (!m_error.isEmpty()) {
+        if (auto *file = qobject_cast<QSaveFile*>(out.get())) file->cancelWriting();
+        return false;
+    }
+
+    if (auto *file = qobject_cast<QSaveFile*>(out.get())) {
+        if (!file->commit()) {
+            m_error = QStringLiteral("写入失败：%1").arg(file->errorString());
+            return false;
+        }
+    } else {
+        out->close();
+    }
+    return true;
+}
+
+void TextExporter::workerLoop(PdfDocument *doc, bool needsLoad)
+{
+    // 打不开就直接退出，它的页由其他工作线程领走
+    if (needsLoad && !doc->load(m_source)) {
+        qWarning() << "Text export: worker failed to open" << m_source;
+        QMutexLocker locker(&m_mutex);
+        --m_activeWorkers;
+        m_pageReady.wakeAll();
+        return;
+    }
+
+    for (;;) {
+        int page = -1;
+        {
+            // 领页超前写出一个窗口就等：内存里最多只有 m_window 页
+            QMutexLocker locker(&m_mutex);
+            while (!m_stop && m_nextPage < m_pageCount && m_nextPage >= m_nextToWrite + m_window) {
+                m_spaceAvailable.wait(&m_mutex);
+            }
+            if (m_stop || m_nextPage >= m_pageCount) {
+                --m_activeWorkers;
+                m_pageReady.wakeAll();
+                return;
+            }
+            page = m_nextPage++;
+        }
+
+        // 抽取在 PDFium 全局锁内；规范化和编码不占锁
+        bool ok = false;
+        QString text = doc->pageText(page, &ok);
+        if (!ok) {
+            // 页面打不开与没有文字的页不同：不能写成空页当作成功
+            qWarning() << "Text export: failed to load page" << page + 1 << "of" << m_source;
+            QMutexLocker locker(&m_mutex);
+            if (m_error.isEmpty()) m_error = QStringLiteral("第 %1 页无法读取").arg(page + 1);
+            m_stop = true;
+            --m_activeWorkers;
+            m_pageReady.wakeAll();
+            m_spaceAvailable.wakeAll();
+            return;
+        }
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        text.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+        QByteArray bytes = text.toUtf8();
+        bytes.append('\f');
+
+        QMutexLocker locker(&m_mutex);
+        m_ready.insert(page, bytes);
+        m_pageReady.wakeAll();
+    }
+}
@@ -0,0 +1,62 @@
+﻿#ifndef TEXTEXPORTER_H
+#define TEXTEXPORTER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+class PdfDocument;
+class QFutureInterfaceBase;
+
+// 整个文档的文字导出为 UTF-8 文本，边抽边写，内存占用与页数无关
+// - 工作线程各自打开一份文档（独立的 FPDF_DOCUMENT），按页序领页抽取；抽取与调用线程的写盘并行。
+//   PDFium 的调用由全局锁串行，抽取几乎全在锁内，多开线程基本不会更快，默认只用一个
+// - 抽好的页放进重排窗口，调用线程按页序写出；领页超前写出 window 页时工作线程等待，
+//   任何时候内存里最多只有 window 页的文字
+// - 每页之后写一个换页符（\f），换行统一为 \n
+// - 写到临时文件，全部写完才替换目标文件；失败或取消时不留半截文件
+class TextExporter
+{
+public:
+    struct Options {
+        int workers = 0;    // 0：kDefaultWorkers 个，最多 kMaxWorkers；远程文档只用 1 个（免得重复下载）
+        int window = 0;     // 重排窗口的页数，0：workers × 4
+    };
+
+    // 多出的线程各要多打开一份文档，却只能并行锁外的一小部分（规范化、编码），得不偿失
+    static const int kDefaultWorkers = 1;
+    static const int kMaxWorkers = 8;
+
+    explicit TextExporter(const QString &source, const Options &options = Options());
+
+    // 在调用线程里写出（阻塞到完成）；output 为 "-" 时写到标准输出
+    // control 非空时汇报进度（0..页数）并响应取消
+    bool exportTo(const QString &output, QFutureInterfaceBase *control = nullptr);
+
+    QString errorString() const { return m_error; }
+    int pageCount() const { return m_pageCount; }
+
+private:
+    void workerLoop(PdfDocument *doc, bool needsLoad);
+
+private:
+    QString m_source;
+    Options m_options;
+    QString m_error;
+    int m_pageCount = 0;
+
+    // 工作线程与写出线程共享，都由 m_mutex 保护
+    QMutex m_mutex;
+    QWaitCondition m_pageReady;         // 重排窗口里有新页
+    QWaitCondition m_spaceAvailable;    // 写出了一页，窗口往前挪
+    QMap<int, QByteArray> m_ready;      // 已抽好、等待按序写出的页（UTF-8）
+    int m_nextPage = 0;                 // 下一个要领的页
+    int m_nextToWrite = 0;              // 下一个要写出的页
+    int m_window = 0;
+    int m_activeWorkers = 0;
+    bool m_stop = false;
+};
+
+#endif // TEXTEXPORTER_H
@@ -0,0 +1,786 @@
+﻿#include "textindex.h"
+#include "jobscheduler.h"
+#include "pdfdocument.h"
+#include "textmatcher.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QWriteLocker>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+const int kProgressIntervalMs = 100;    // 进度（流式结果）最多每 100ms 通知一次
+const int kSaveEveryPages = 1000;       // 每新建这么多页写一次索引文件
+const qint64 kCacheBudget = qint64(1024) * 1024 * 1024;    // 索引文件目录的总大小上限
+
+// 索引文件布局（本机字节序，各段按 4 字节对齐，可直接映射后使用）：
+// 文件头 | 页表 PageEntry[indexedPages] | 文字 UTF-16 | 空白间隔 qint32 对 | 二元组表 BigramEntry[]（按 key 升序）| 倒排数据
+const quint32 kFileMagic = 0x49585450;      // "PTXI"
+const quint32 kFileVersion = 2;        // 2：全角/半角统一
+
+struct FileHeader {
+    quint32 magic;
+    quint32 version;
+    uchar documentKey[20];
+    quint32 pageCount;
+    quint32 indexedPages;
+    quint32 bigramCount;
+    quint32 pageTableOffset;
+    quint32 textOffset;
+    quint32 gapOffset;
+    quint32 bigramOffset;
+    quint32 postingOffset;
+    quint32 fileSize;
+};
+static_assert(sizeof(FileHeader) == 64, "FileHeader layout");
+
+struct PageEntry {
+    quint32 textStart;      // 以字符计
+    quint32 textLength;
+    quint32 gapStart;       // 以间隔（一对 qint32）计
+    quint32 gapCount;
+};
+
+struct BigramEntry {
+    quint32 key;
+    quint32 postingStart;   // 相对倒排数据段
+    quint32 postingBytes;
+    quint32 count;
+};
+
+inline quint32 bigram(QChar a, QChar b)
+{
+    return (quint32(a.unicode()) << 16) | b.unicode();
+}
+
+void appendVarint(QByteArray *out, quint32 value)
+{
+    while (value >= 0x80) {
+        out->append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out->append(char(value));
+}
+
+// 解码页号差值，只保留 [fromPage, toPage) 内的页
+void decodePages(const uchar *p, int size, int fromPage, int toPage, QVector<int> *pages)
+{
+    const uchar *end = p + size;
+    int page = -1;
+    while (p < end) {
+        quint32 delta = 0;
+        int shift = 0;
+        while (p < end) {
+            const uchar byte = *p++;
+            delta |= quint32(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) break;
+        }
+        page += int(delta);
+        if (page >= toPage) break;
+        if (page >= fromPage) pages->append(page);
+    }
+}
+
+void alignTo4(QByteArray *out)
+{
+    while (out->size() % 4) out->append('\0');
+}
+
+template <typename T>
+void appendRaw(QByteArray *out, const T *data, int count)
+{
+    out->append(reinterpret_cast<const char *>(data), int(sizeof(T)) * count);
+}
+
+} // namespace
+
+TextIndex::TextIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+TextIndex::~TextIndex()
+{
+    // 任务引用着 this：作废后等它们结束
+    m_generation.fetchAndAddOrdered(1);
+    QList<QFuture<void>> jobs;
+    {
+        QMutexLocker locker(&m_jobMutex);
+        jobs.swap(m_jobs);
+    }
+    for (QFuture<void> &job : jobs) {
+        job.cancel();
+        job.waitForFinished();
+    }
+
+    QWriteLocker locker(&m_lock);
+    closeCacheLocked();
+}
+
+void TextIndex::start(PdfDocument *pdf)
+{
+    clear();
+
+    const int generation = m_generation.loadAcquire();
+    int fromPage = 0;
+    {
+        QWriteLocker locker(&m_lock);
+        m_pdf = pdf;
+        m_pageCount = pdf ? pdf->pageCount() : 0;
+        m_documentKey = pdf ? pdf->documentKey() : QByteArray();
+
+        // 上次留下的索引：文件头对得上就直接映射使用
+        if (openCacheLocked()) {
+            qInfo().noquote() << QStringLiteral("全文索引：沿用 %1 / %2 页").arg(m_mappedPages).arg(m_pageCount);
+        }
+        fromPage = m_mappedPages;
+    }
+
+    if (pdf && fromPage < m_pageCount) scheduleIndexing(generation, fromPage);
+}
+
+void TextIndex::clear()
+{
+    m_generation.fetchAndAddOrdered(1);
+    {
+        QMutexLocker locker(&m_jobMutex);
+        for (QFuture<void> &job : m_jobs) job.cancel();
+    }
+
+    QWriteLocker locker(&m_lock);
+    m_pdf = nullptr;
+    m_pages.clear();
+    m_postings.clear();
+    m_pageCount = 0;
+    m_documentKey.clear();
+    closeCacheLocked();
+}
+
+int TextIndex::indexedPages() const
+{
+    QReadLocker locker(&m_lock);
+    return indexedPagesLocked();
+}
+
+int TextIndex::pageCount() const
+{
+    QReadLocker locker(&m_lock);
+    return m_pageCount;
+}
+
+bool TextIndex::isComplete() const
+{
+    QReadLocker locker(&m_lock);
+    return m_pageCount > 0 && indexedPagesLocked() == m_pageCount;
+}
+
+QString TextIndex::normalize(const QString &text)
+{
+    QString result;
+    result.reserve(text.size());
+    for (const QChar c : text) {
+        if (!c.isSpace()) result.append(TextMatcher::foldChar(c));
+    }
+    return result;
+}
+
+TextIndex::PageText TextIndex::buildPage(const QString &raw)
+{
+    PageText page;
+    page.folded.reserve(raw.size());
+
+    int removed = 0;
+    for (const QChar c : raw) {
+        if (!c.isSpace()) {
+            page.folded.append(TextMatcher::foldChar(c));
+            continue;
+        }
+
+        // 连续的空白（含 PDFium 生成的 \r\n）记成一个间隔
+        ++removed;
+        const int gaps = page.gaps.size();
+        if (gaps > 0 && page.gaps.at(gaps - 2) == page.folded.size()) {
+            page.gaps[gaps - 1] = removed;
+        } else {
+            page.gaps << page.folded.size() << removed;
+        }
+    }
+    page.folded.squeeze();
+    return page;
+}
+
+int TextIndex::originalIndex(const PageView &page, int foldedPos)
+{
+    // 最后一个不晚于 foldedPos 的间隔（二分）
+    int lo = 0;
+    int hi = page.gapCount;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (page.gaps[2 * mid] <= foldedPos) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo == 0 ? foldedPos : foldedPos + page.gaps[2 * (lo - 1) + 1];
+}
+
+TextIndex::PageView TextIndex::pageViewLocked(int page) const
+{
+    PageView view;
+    if (page >= m_mappedPages) {
+        const PageText &text = m_pages.at(page - m_mappedPages);
+        view.folded = text.folded;
+        view.gaps = text.gaps.constData();
+        view.gapCount = text.gaps.size() / 2;
+        return view;
+    }
+
+    // 映射文件：字符串直接引用映射区，不拷贝
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(m_map);
+    const PageEntry &entry = reinterpret_cast<const PageEntry *>(m_map + header->pageTableOffset)[page];
+    const quint32 textChars = (header->gapOffset - header->textOffset) / 2;
+    const quint32 gapPairs = (header->bigramOffset - header->gapOffset) / 8;
+    if (quint64(entry.textStart) + entry.textLength > textChars ||
+        quint64(entry.gapStart) + entry.gapCount > gapPairs) {
+        return view;
+    }
+
+    const QChar *text = reinterpret_cast<const QChar *>(m_map + header->textOffset) + entry.textStart;
+    view.folded = QString::fromRawData(text, int(entry.textLength));
+    view.gaps = reinterpret_cast<const qint32 *>(m_map + header->gapOffset) + 2 * entry.gapStart;
+    view.gapCount = int(entry.gapCount);
+    return view;
+}
+
+int TextIndex::postingCountLocked(quint32 key) const
+{
+    int count = m_postings.value(key).count;
+    if (m_map) {
+        const FileHeader *header = reinterpret_cast<const FileHeader *>(m_map);
+        const BigramEntry *begin = reinterpret_cast<const BigramEntry *>(m_map + header->bigramOffset);
+        const BigramEntry *end = begin + header->bigramCount;
+        const BigramEntry *it = std::lower_bound(begin, end, key, [](const BigramEntry &e, quint32 k) {
+            return e.key < k;
+        });
+        if (it != end && it->key == key) count += int(it->count);
+    }
+    return count;
+}
+
+QVector<int> TextIndex::pagesWithLocked(quint32 key, int fromPage, int toPage) const
+{
+    QVector<int> pages;
+
+    // 映射部分的页号都小于内存部分，先后拼起来仍然有序
+    if (m_map && fromPage < m_mappedPages) {
+        const FileHeader *header = reinterpret_cast<const FileHeader *>(m_map);
+        const BigramEntry *begin = reinterpret_cast<const BigramEntry *>(m_map + header->bigramOffset);
+        const BigramEntry *end = begin + header->bigramCount;
+        const BigramEntry *it = std::lower_bound(begin, end, key, [](const BigramEntry &e, quint32 k) {
+            return e.key < k;
+        });
+        if (it != end && it->key == key &&
+            quint64(header->postingOffset) + it->postingStart + it->postingBytes <= quint64(m_mapSize)) {
+            decodePages(m_map + header->postingOffset + it->postingStart, int(it->postingBytes),
+                        fromPage, qMin(toPage, m_mappedPages), &pages);
+        }
+    }
+
+    const auto it = m_postings.constFind(key);
+    if (it != m_postings.constEnd() && toPage > m_mappedPages) {
+        decodePages(reinterpret_cast<const uchar *>(it->deltas.constData()), it->deltas.size(),
+                    qMax(fromPage, m_mappedPages), toPage, &pages);
+    }
+    return pages;
+}
+
+bool TextIndex::isFuzzy(const QString &query)
+{
+    return query.trimmed().startsWith(QLatin1Char('~'));
+}
+
+QString TextIndex::parseQuery(const QString &query, int *edits)
+{
+    *edits = 0;
+    if (!isFuzzy(query)) return normalize(query);
+
+    const QString needle = normalize(query.trimmed().mid(1));
+    if (needle.size() <= TextMatcher::kMaxFuzzyLength) *edits = TextMatcher::fuzzyEditsFor(needle.size());
+    return needle;
+}
+
+QVector<TextHit> TextIndex::search(const QString &query, int fromPage, int toPage) const
+{
+    QVector<TextHit> hits;
+    int edits = 0;
+    const QString needle = parseQuery(query, &edits);
+    if (needle.isEmpty()) return hits;
+
+    QReadLocker locker(&m_lock);
+
+    const int indexed = indexedPagesLocked();
+    fromPage = qMax(0, fromPage);
+    toPage = (toPage < 0) ? indexed : qMin(toPage, indexed);
+    if (fromPage >= toPage) return hits;
+
+    // 1. 候选页：查询里每个二元组的倒排表求交集，从最短的表开始
+    QVector<int> candidates;
+    if (edits > 0) {
+        candidates = fuzzyCandidatesLocked(needle, edits, fromPage, toPage);
+    } else if (needle.size() >= 2) {
+        QVector<QPair<int, quint32>> keys;      // (页数, 二元组)
+        QSet<quint32> seen;
+        for (int i = 0; i + 1 < needle.size(); ++i) {
+            const quint32 key = bigram(needle.at(i), needle.at(i + 1));
+            if (seen.contains(key)) continue;
+            seen.insert(key);
+
+            const int count = postingCountLocked(key);
+            if (count == 0) return hits;
+            keys.append(qMakePair(count, key));
+        }
+        std::sort(keys.begin(), keys.end());
+
+        candidates = pagesWithLocked(keys.first().second, fromPage, toPage);
+        for (int i = 1; i < keys.size() && !candidates.isEmpty(); ++i) {
+            const QVector<int> other = pagesWithLocked(keys.at(i).second, fromPage, toPage);
+            QVector<int> both;
+            std::set_intersection(candidates.constBegin(), candidates.constEnd(),
+                                  other.constBegin(), other.constEnd(), std::back_inserter(both));
+            candidates.swap(both);
+        }
+    } else {
+        // 单个字符：没有二元组可用，直接扫
+        candidates.reserve(toPage - fromPage);
+        for (int page = fromPage; page < toPage; ++page) candidates.append(page);
+    }
+
+    // 2. 在候选页里确认并定位每一处（二元组都在不代表连在一起）
+    collectHitsLocked(needle, edits, candidates, &hits);
+    return hits;
+}
+
+QVector<int> TextIndex::fuzzyCandidatesLocked(const QString &needle, int edits, int fromPage, int toPage) const
+{
+    // 每次编辑最多破坏两个二元组：查询的 n 个不同二元组里，匹配处至少还剩 n - 2×edits 个
+    QVector<quint32> keys;
+    for (int i = 0; i + 1 < needle.size(); ++i) {
+        const quint32 key = bigram(needle.at(i), needle.at(i + 1));
+        if (!keys.contains(key)) keys.append(key);
+    }
+
+    QVector<int> candidates;
+    const int threshold = keys.size() - 2 * edits;
+    if (threshold <= 0) {
+        // 查询太短，二元组筛不掉什么：每页都查
+        candidates.reserve(toPage - fromPage);
+        for (int page = fromPage; page < toPage; ++page) candidates.append(page);
+        return candidates;
+    }
+
+    QVector<int> counts(toPage - fromPage, 0);
+    for (const quint32 key : keys) {
+        if (postingCountLocked(key) == 0) continue;
+        for (const int page : pagesWithLocked(key, fromPage, toPage)) ++counts[page - fromPage];
+    }
+    for (int i = 0; i < counts.size(); ++i) {
+        if (counts.at(i) >= threshold) candidates.append(fromPage + i);
+    }
+    return candidates;
+}
+
+QVector<TextHit> TextIndex::searchPages(const QString &query, const QVector<int> &pages) const
+{
+    QVector<TextHit> hits;
+    int edits = 0;
+    const QString needle = parseQuery(query, &edits);
+    if (needle.isEmpty() || pages.isEmpty()) return hits;
+
+    QReadLocker locker(&m_lock);
+
+    // 索引可能已被清空或重建：只查现有的页
+    const int indexed = indexedPagesLocked();
+    QVector<int> candidates;
+    candidates.reserve(pages.size());
+    for (const int page : pages) {
+        if (page >= 0 && page < indexed) candidates.append(page);
+    }
+
+    collectHitsLocked(needle, edits, candidates, &hits);
+    return hits;
+}
+
+void TextIndex::collectHitsLocked(const QString &needle, int edits, const QVector<int> &pages,
+                                  QVector<TextHit> *hits) const
+{
+    auto addHit = [hits](const PageView &text, int page, int pos, int length) {
+        TextHit hit;
+        hit.page = page;
+        hit.start = originalIndex(text, pos);
+        hit.length = originalIndex(text, pos + length - 1) + 1 - hit.start;
+        hits->append(hit);
+    };
+
+    for (const int page : pages) {
+        const PageView text = pageViewLocked(page);
+        if (edits > 0) {
+            for (const TextMatcher::Match &match : TextMatcher::findFuzzy(text.folded, needle, edits)) {
+                addHit(text, page, match.start, match.length);
+            }
+            continue;
+        }
+
+        int pos = TextMatcher::indexOf(text.folded, needle);
+        while (pos >= 0) {
+            addHit(text, page, pos, needle.size());
+            pos = TextMatcher::indexOf(text.folded, needle, pos + needle.size());
+        }
+    }
+}
+
+// ---------------- 索引文件 ----------------
+
+QString TextIndex::cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/text_index";
+}
+
+bool TextIndex::openCacheLocked()
+{
+    if (m_documentKey.size() != 20 || m_pageCount <= 0) return false;
+
+    // 同一文档可能留下几个文件（建到不同页数时写的）：用页数最多的那个，其余的删掉
+    const QString prefix = QString::fromLatin1(m_documentKey.toHex()) + QLatin1Char('-');
+    QDir dir(cacheDirectory());
+    QStringList files = dir.entryList(QStringList() << prefix + "*.idx", QDir::Files);
+    std::sort(files.begin(), files.end(), [&prefix](const QString &a, const QString &b) {
+        return a.mid(prefix.size()).section(QLatin1Char('.'), 0, 0).toInt() >
+               b.mid(prefix.size()).section(QLatin1Char('.'), 0, 0).toInt();
+    });
+
+    bool opened = false;
+    for (const QString &name : files) {
+        const QString path = dir.filePath(name);
+        if (!opened && mapFileLocked(path)) {
+            opened = true;
+
+            // 记下使用时间，清理时按它淘汰
+            QFile touch(path);
+            if (touch.open(QIODevice::ReadWrite)) touch.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+            continue;
+        }
+        QFile::remove(path);
+    }
+    return opened;
+}
+
+bool TextIndex::mapFileLocked(const QString &path)
+{
+    QSharedPointer<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(FileHeader))) return false;
+
+    const uchar *map = file->map(0, file->size());
+    if (!map) return false;
+
+    // 只核对文件头和各段边界，不逐页校验：打开要快
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(map);
+    const qint64 size = file->size();
+    const bool valid =
+            header->magic == kFileMagic && header->version == kFileVersion &&
+            std::memcmp(header->documentKey, m_documentKey.constData(), 20) == 0 &&
+            int(header->pageCount) == m_pageCount && header->indexedPages <= header->pageCount &&
+            qint64(header->fileSize) == size &&
+            header->pageTableOffset >= sizeof(FileHeader) &&
+            quint64(header->pageTableOffset) + quint64(header->indexedPages) * sizeof(PageEntry) <= header->textOffset &&
+            header->textOffset <= header->gapOffset && header->gapOffset <= header->bigramOffset &&
+            quint64(header->bigramOffset) + quint64(header->bigramCount) * sizeof(BigramEntry) <= header->postingOffset &&
+            header->postingOffset <= size &&
+            header->textOffset % 4 == 0 && header->gapOffset % 4 == 0 && header->bigramOffset % 4 == 0;
+    if (!valid) {
+        file->unmap(const_cast<uchar *>(map));
+        return false;
+    }
+
+    m_mapped = file;
+    m_map = map;
+    m_mapSize = size;
+    m_mappedPages = int(header->indexedPages);
+    m_cacheFile = path;
+    return true;
+}
+
+void TextIndex::closeCacheLocked()
+{
+    m_mapped.reset();       // QFile 析构时解除映射
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_mappedPages = 0;
+    m_cacheFile.clear();
+}
+
+QByteArray TextIndex::serializeLocked() const
+{
+    const int indexed = indexedPagesLocked();
+
+    // 1. 页表、文字、空白间隔
+    QVector<PageEntry> entries(indexed);
+    QByteArray text;
+    QVector<qint32> gaps;
+    for (int page = 0; page < indexed; ++page) {
+        const PageView view = pageViewLocked(page);
+        PageEntry &entry = entries[page];
+        entry.textStart = quint32(text.size() / 2);
+        entry.textLength = quint32(view.folded.size());
+        entry.gapStart = quint32(gaps.size() / 2);
+        entry.gapCount = quint32(view.gapCount);
+        appendRaw(&text, view.folded.constData(), view.folded.size());
+        for (int i = 0; i < 2 * view.gapCount; ++i) gaps.append(view.gaps[i]);
+    }
+
+    // 2. 二元组：映射部分与内存部分合并，重新编码
+    QVector<quint32> keys;
+    if (m_map) {
+        const FileHeader *header = reinterpret_cast<const FileHeader *>(m_map);
+        const BigramEntry *table = reinterpret_cast<const BigramEntry *>(m_map + header->bigramOffset);
+        keys.reserve(int(header->bigramCount) + m_postings.size());
+        for (quint32 i = 0; i < header->bigramCount; ++i) keys.append(table[i].key);
+    }
+    for (auto it = m_postings.constBegin(); it != m_postings.constEnd(); ++it) keys.append(it.key());
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    QVector<BigramEntry> bigrams;
+    bigrams.reserve(keys.size());
+    QByteArray postings;
+    for (const quint32 key : keys) {
+        const QVector<int> pages = pagesWithLocked(key, 0, indexed);
+        BigramEntry entry;
+        entry.key = key;
+        entry.postingStart = quint32(postings.size());
+        entry.count = quint32(pages.size());
+        int last = -1;
+        for (const int page : pages) {
+            appendVarint(&postings, quint32(page - last));
+            last = page;
+        }
+        entry.postingBytes = quint32(postings.size()) - entry.postingStart;
+        bigrams.append(entry);
+    }
+
+    // 3. 拼成文件
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = kFileMagic;
+    header.version = kFileVersion;
+    std::memcpy(header.documentKey, m_documentKey.constData(), 20);
+    header.pageCount = quint32(m_pageCount);
+    header.indexedPages = quint32(indexed);
+    header.bigramCount = quint32(bigrams.size());
+
+    QByteArray out(int(sizeof(FileHeader)), '\0');
+    header.pageTableOffset = quint32(out.size());
+    appendRaw(&out, entries.constData(), entries.size());
+    header.textOffset = quint32(out.size());
+    out.append(text);
+    alignTo4(&out);
+    header.gapOffset = quint32(out.size());
+    appendRaw(&out, gaps.constData(), gaps.size());
+    header.bigramOffset = quint32(out.size());
+    appendRaw(&out, bigrams.constData(), bigrams.size());
+    header.postingOffset = quint32(out.size());
+    out.append(postings);
+    header.fileSize = quint32(out.size());
+
+    std::memcpy(out.data(), &header, sizeof(header));
+    return out;
+}
+
+void TextIndex::saveAndRemap(int generation)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 1. 序列化（只读锁：查询照常进行）
+    QByteArray data;
+    int indexed = 0;
+    QString path;
+    {
+        QReadLocker locker(&m_lock);
+        if (m_generation.loadAcquire() != generation || m_documentKey.size() != 20) return;
+
+        indexed = indexedPagesLocked();
+        if (indexed <= m_mappedPages) return;
+
+        data = serializeLocked();
+        path = QStringLiteral("%1/%2-%3.idx").arg(cacheDirectory(), QString::fromLatin1(m_documentKey.toHex())).arg(indexed);
+    }
+
+    // 2. 写成新文件（文件名带页数，不覆盖正在映射的旧文件）
+    QDir().mkpath(cacheDirectory());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "Text index save failed:" << path << file.errorString();
+        return;
+    }
+
+    // 3. 换成映射新文件，释放内存里的页；旧文件解除映射后删掉
+    QString oldPath;
+    {
+        QWriteLocker locker(&m_lock);
+        if (m_generation.loadAcquire() != generation || indexedPagesLocked() != indexed) return;
+
+        oldPath = m_cacheFile;
+        const QSharedPointer<QFile> oldFile = m_mapped;
+        const uchar *oldMap = m_map;
+        const qint64 oldSize = m_mapSize;
+        const int oldPages = m_mappedPages;
+
+        closeCacheLocked();
+        if (mapFileLocked(path)) {
+            m_pages.clear();
+            m_postings.clear();
+        } else {
+            // 映射不了：保持原样（内存里的页仍然可用）
+            m_mapped = oldFile;
+            m_map = oldMap;
+            m_mapSize = oldSize;
+            m_mappedPages = oldPages;
+            m_cacheFile = oldPath;
+            oldPath.clear();
+        }
+    }
+    if (!oldPath.isEmpty() && oldPath != path) QFile::remove(oldPath);
+
+    pruneCache(path);
+    qInfo().noquote() << QStringLiteral("全文索引已保存：%1 页，%2，%3 ms")
+                         .arg(indexed).arg(QLocale().formattedDataSize(data.size())).arg(timer.elapsed());
+}
+
+void TextIndex::pruneCache(const QString &keep)
+{
+    // 按最近使用时间淘汰，目录总大小不超过上限
+    QDir dir(cacheDirectory());
+    const QFileInfoList files = dir.entryInfoList(QStringList() << "*.idx", QDir::Files, QDir::Time);
+
+    qint64 total = 0;
+    for (const QFileInfo &info : files) {
+        total += info.size();
+        if (total > kCacheBudget && info.absoluteFilePath() != QFileInfo(keep).absoluteFilePath()) {
+            QFile::remove(info.absoluteFilePath());
+        }
+    }
+}
+
+// ---------------- 后台建索引 ----------------
+
+void TextIndex::scheduleIndexing(int generation, int fromPage)
+{
+    QMutexLocker locker(&m_jobMutex);
+    if (m_generation.loadAcquire() != generation || !m_pdf) return;
+
+    // 和文档的其他任务同一个串行 key：加载、重新加载不会和抽取文字同时进行
+    trackJobLocked(JobScheduler::instance()->run(
+                JobScheduler::Indexing, m_pdf, [this, generation, fromPage]() {
+        indexPages(generation, fromPage);
+    }));
+}
+
+void TextIndex::indexPages(int generation, int fromPage)
+{
+    PdfDocument *pdf = nullptr;
+    int count = 0;
+    {
+        QReadLocker locker(&m_lock);
+        pdf = m_pdf;
+        count = m_pageCount;
+    }
+    if (!pdf) return;
+
+    QElapsedTimer sinceProgress;
+    sinceProgress.start();
+    int sinceSave = 0;
+
+    for (int page = fromPage; page < count; ++page) {
+        if (m_generation.loadAcquire() != generation) return;
+
+        // 有更高优先级的任务在排队：让出线程，从这一页接着建
+        if (JobScheduler::shouldYield()) {
+            emit progress(page, count);
+            scheduleIndexing(generation, page);
+            return;
+        }
+
+        // 1. 抽取、规范化都不持索引锁，查询不受影响
+        const PageText text = buildPage(pdf->pageText(page));
+
+        // 2. 加入索引：每个二元组在一页里只记一次
+        {
+            QWriteLocker locker(&m_lock);
+            if (m_generation.loadAcquire() != generation || indexedPagesLocked() != page) return;
+
+            for (int i = 0; i + 1 < text.folded.size(); ++i) {
+                Postings &postings = m_postings[bigram(text.folded.at(i), text.folded.at(i + 1))];
+                if (postings.lastPage == page) continue;
+                appendVarint(&postings.deltas, quint32(page - postings.lastPage));
+                postings.lastPage = page;
+                ++postings.count;
+            }
+            m_pages.append(text);
+        }
+
+        // 3. 建完或攒够一批：交给保存任务写出索引文件，写完由它接着建
+        if (page + 1 == count || ++sinceSave >= kSaveEveryPages) {
+            emit progress(page + 1, count);
+            scheduleSave(generation);
+            return;
+        }
+
+        if (sinceProgress.elapsed() >= kProgressIntervalMs) {
+            emit progress(page + 1, count);
+            sinceProgress.restart();
+        }
+    }
+}
+
+void TextIndex::scheduleSave(int generation)
+{
+    QMutexLocker locker(&m_jobMutex);
+    if (m_generation.loadAcquire() != generation || !m_pdf) return;
+
+    // 序列化和写盘不占文档的串行 key，渲染等任务不用等它；
+    // 写的期间不再抽取（新页会让这次写出的文件作废），写完再从下一页接着建
+    trackJobLocked(JobScheduler::instance()->run(
+                JobScheduler::Indexing, this, [this, generation]() {
+        saveAndRemap(generation);
+
+        int indexed = 0;
+        int count = 0;
+        {
+            QReadLocker locker(&m_lock);
+            indexed = indexedPagesLocked();
+            count = m_pageCount;
+        }
+        if (indexed < count) scheduleIndexing(generation, indexed);
+    }));
+}
+
+void TextIndex::trackJobLocked(const QFuture<void> &job)
+{
+    for (int i = m_jobs.size() - 1; i >= 0; --i) {
+        if (m_jobs[i].isFinished()) m_jobs.removeAt(i);
+    }
+    m_jobs.append(job);
+}
@@ -0,0 +1,145 @@
+﻿#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+class PdfDocument;
+class QFile;
+
+// 一处命中：start/length 是页内字符序号（与 FPDFText_GetCharBox 等接口的下标一致）
+struct TextHit
+{
+    int page = -1;
+    int start = 0;
+    int length = 0;
+};
+
+inline bool operator==(const TextHit &a, const TextHit &b)
+{
+    return a.page == b.page && a.start == b.start && a.length == b.length;
+}
+
+// 全文索引
+// - 后台以索引优先级逐页抽取文字（有更高优先级任务排队时让出），按页序建立
+// - 每页保存折叠后的文字（去掉空白、大小写折叠），另记空白被删掉的位置，命中可还原为原字符序号；
+//   去掉空白后跨行的中文词也能搜到
+// - 倒排表以相邻两个字符（二元组）为词：中文不分词也能检索，西文同样适用；
+//   页号按差值变长编码，5000 页的文档也只占几 MB
+// - 查询先用倒排表求候选页的交集，再在候选页文字里逐个确认（TextMatcher）；已建索引的部分毫秒级返回
+// - 建索引过程中每隔一段时间发 progress，界面据此对新加入的页继续查询（结果流式出现）
+// - 持久化：按文档标识（PdfDocument::documentKey）存成可直接内存映射的文件，
+//   再次打开时只核对文件头就映射使用，缺的页在后台接着建；每建好一批就写出新文件并换成映射，
+//   内存里只留最近一批。写盘是单独的任务，不占文档的串行 key
+class TextIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TextIndex(QObject *parent = nullptr);
+    ~TextIndex();
+
+    // 文档加载完成后调用：清空旧索引，映射上次留下的索引文件，缺的页在后台建立
+    void start(PdfDocument *pdf);
+
+    // 作废当前索引（打开/重新加载文档前调用，之后排队的索引任务会自行退出）
+    void clear();
+
+    int indexedPages() const;
+    int pageCount() const;
+    bool isComplete() const;
+
+    // 在已建索引的 [fromPage, toPage) 页中查找（toPage < 0 表示到已索引的末尾），按页序返回
+    QVector<TextHit> search(const QString &query, int fromPage = 0, int toPage = -1) const;
+
+    // 只在给定的页（升序）里查找：查询加长时，新结果只可能出现在旧结果所在的页
+    QVector<TextHit> searchPages(const QString &query, const QVector<int> &pages) const;
+
+    // 查询与页文字使用同一种规范化：去空白、大小写折叠、全角/半角统一（TextMatcher::foldChar）
+    static QString normalize(const QString &text);
+
+    // 以 ~ 开头的查询做模糊匹配：按查询长度容许 1～3 处错字、漏字、多字
+    static bool isFuzzy(const QString &query);
+
+signals:
+    // 在工作线程发出（排队连接到界面）：已建好前 indexedPages 页
+    void progress(int indexedPages, int pageCount);
+
+private:
+    friend class TestTextSearch;    // 单元测试直接检查 buildPage / originalIndex
+
+    struct PageText {
+        QString folded;             // 规范化后的文字
+        QVector<qint32> gaps;       // 成对：(folded 中的位置, 到这里为止删掉的空白数)
+    };
+
+    struct Postings {
+        QByteArray deltas;          // 页号差值，变长编码
+        int lastPage = -1;
+        int count = 0;
+    };
+
+    // 一页的只读视图：来自映射文件或内存
+    struct PageView {
+        QString folded;
+        const qint32 *gaps = nullptr;
+        int gapCount = 0;
+    };
+
+    static PageText buildPage(const QString &raw);
+    static int originalIndex(const PageView &page, int foldedPos);
+
+    int indexedPagesLocked() const { return m_mappedPages + m_pages.size(); }
+    PageView pageViewLocked(int page) const;
+    int postingCountLocked(quint32 key) const;
+    QVector<int> pagesWithLocked(quint32 key, int fromPage, int toPage) const;
+    static QString parseQuery(const QString &query, int *edits);
+    QVector<int> fuzzyCandidatesLocked(const QString &needle, int edits, int fromPage, int toPage) const;
+    void collectHitsLocked(const QString &needle, int edits, const QVector<int> &pages, QVector<TextHit> *hits) const;
+
+    // 索引文件
+    static QString cacheDirectory();
+    bool openCacheLocked();
+    void closeCacheLocked();
+    bool mapFileLocked(const QString &path);
+    QByteArray serializeLocked() const;
+    void saveAndRemap(int generation);
+    static void pruneCache(const QString &keep);
+
+    void scheduleIndexing(int generation, int fromPage);
+    void indexPages(int generation, int fromPage);
+    void scheduleSave(int generation);     // 写完接着从下一页建
+    void trackJobLocked(const QFuture<void> &job);
+
+private:
+    PdfDocument *m_pdf = nullptr;
+    QAtomicInt m_generation = 0;
+
+    mutable QReadWriteLock m_lock;
+    int m_pageCount = 0;
+    QByteArray m_documentKey;
+
+    // 映射的索引文件：前 m_mappedPages 页
+    QSharedPointer<QFile> m_mapped;
+    const uchar *m_map = nullptr;
+    qint64 m_mapSize = 0;
+    int m_mappedPages = 0;
+    QString m_cacheFile;
+
+    // 之后建的页（页号从 m_mappedPages 开始）
+    QVector<PageText> m_pages;
+    QHash<quint32, Postings> m_postings;    // 二元组 -> 含有它的页
+
+    QMutex m_jobMutex;
+    QList<QFuture<void>> m_jobs;
+};
+
+#endif // TEXTINDEX_H
@@ -0,0 +1,242 @@
+﻿#include "textlayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace {
+
+// 点到矩形的距离（平方），点在框内为 0
+qreal distanceSquared(const QRectF &rect, const QPointF &point)
+{
+    const qreal dx = qMax(qMax(rect.left() - point.x(), point.x() - rect.right()), qreal(0));
+    const qreal dy = qMax(qMax(rect.top() - point.y(), point.y() - rect.bottom()), qreal(0));
+    return dx * dx + dy * dy;
+}
+
+bool isWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+} // namespace
+
+TextLayout::TextLayout(const QString &text, const QVector<QRectF> &boxes)
+    : m_text(text)
+    , m_boxes(boxes)
+{
+    m_boxes.resize(m_text.size());
+    buildGrid();
+    buildLines();
+}
+
+int TextLayout::cellCoord(qreal v) const
+{
+    return qBound(0, int(std::floor(v * m_gridSize)), m_gridSize - 1);
+}
+
+void TextLayout::buildGrid()
+{
+    // 平均每格几个字：一页几千字时是 32×32 左右
+    m_gridSize = qBound(1, int(std::sqrt(m_text.size() / 4.0)), 64);
+    const int cells = m_gridSize * m_gridSize;
+
+    // 两遍：先数每格的字数，再填（紧凑的 CSR 布局，没有逐格的小数组）
+    QVector<int> counts(cells + 1, 0);
+    auto forEachCell = [this](const QRectF &box, const std::function<void(int)> &fn) {
+        const int c0 = cellCoord(box.left());
+        const int c1 = cellCoord(box.right());
+        const int r0 = cellCoord(box.top());
+        const int r1 = cellCoord(box.bottom());
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) fn(cellIndex(c, r));
+        }
+    };
+
+    for (int i = 0; i < m_boxes.size(); ++i) {
+        if (m_boxes.at(i).isNull()) continue;
+        forEachCell(m_boxes.at(i), [&counts](int cell) { ++counts[cell + 1]; });
+    }
+    for (int c = 0; c < cells; ++c) counts[c + 1] += counts[c];
+
+    m_cellStart = counts;
+    m_cellChars.resize(counts.last());
+    QVector<int> fill = counts;
+    for (int i = 0; i < m_boxes.size(); ++i) {
+        if (m_boxes.at(i).isNull()) continue;
+        forEachCell(m_boxes.at(i), [this, &fill, i](int cell) { m_cellChars[fill[cell]++] = i; });
+    }
+}
+
+void TextLayout::buildLines()
+{
+    m_lineStarts.clear();
+    if (m_text.isEmpty()) return;
+
+    m_lineStarts.append(0);
+    QRectF last;
+    for (int i = 1; i < m_text.size(); ++i) {
+        // 换行符之后、或字符框的中心不在上一个字的上下范围内：新的一行
+        const QChar previous = m_text.at(i - 1);
+        const QRectF &box = m_boxes.at(i);
+        if (!m_boxes.at(i - 1).isNull()) last = m_boxes.at(i - 1);
+
+        bool breakHere = (previous == QLatin1Char('\n'));
+        if (!breakHere && !box.isNull() && !last.isNull()) {
+            const qreal cy = box.center().y();
+            breakHere = cy < last.top() || cy > last.bottom();
+        }
+        if (breakHere && m_lineStarts.last() != i) {
+            m_lineStarts.append(i);
+            last = QRectF();
+        }
+    }
+}
+
+int TextLayout::lineOf(int index) const
+{
+    const auto it = std::upper_bound(m_lineStarts.constBegin(), m_lineStarts.constEnd(), index);
+    return int(it - m_lineStarts.constBegin()) - 1;
+}
+
+int TextLayout::charAt(const QPointF &point) const
+{
+    if (m_text.isEmpty() || point.x() < 0 || point.y() < 0 || point.x() > 1 || point.y() > 1) return -1;
+
+    const int cell = cellIndex(cellCoord(point.x()), cellCoord(point.y()));
+    for (int k = m_cellStart.at(cell); k < m_cellStart.at(cell + 1); ++k) {
+        const int i = m_cellChars.at(k);
+        if (m_boxes.at(i).contains(point)) return i;
+    }
+    return -1;
+}
+
+int TextLayout::nearestChar(const QPointF &point) const
+{
+    if (m_cellChars.isEmpty()) return -1;
+
+    // 从点所在的格向外一圈圈找；找到后再多看一圈（相邻格里的字可能更近）
+    const int col = cellCoord(qBound(qreal(0), point.x(), qreal(1)));
+    const int row = cellCoord(qBound(qreal(0), point.y(), qreal(1)));
+
+    int best = -1;
+    qreal bestDistance = std::numeric_limits<qreal>::max();
+    int foundAtRing = -1;
+    for (int ring = 0; ring < m_gridSize; ++ring) {
+        if (foundAtRing >= 0 && ring > foundAtRing + 1) break;
+
+        for (int r = row - ring; r <= row + ring; ++r) {
+            if (r < 0 || r >= m_gridSize) continue;
+            for (int c = col - ring; c <= col + ring; ++c) {
+                if (c < 0 || c >= m_gridSize) continue;
+                if (qAbs(r - row) != ring && qAbs(c - col) != ring) continue;   // 只看这一圈
+
+                const int cell = cellIndex(c, r);
+                for (int k = m_cellStart.at(cell); k < m_cellStart.at(cell + 1); ++k) {
+                    const int i = m_cellChars.at(k);
+                    const qreal d = distanceSquared(m_boxes.at(i), point);
+                    if (d < bestDistance || (d == bestDistance && i < best)) {
+                        bestDistance = d;
+                        best = i;
+                    }
+                }
+            }
+        }
+        if (best >= 0 && foundAtRing < 0) foundAtRing = ring;
+    }
+    return best;
+}
+
+QVector<QPair<int, int>> TextLayout::rangesIn(const QRectF &rect) const
+{
+    QVector<int> chars;
+    if (m_text.isEmpty() || rect.isEmpty()) return QVector<QPair<int, int>>();
+
+    const int c0 = cellCoord(rect.left());
+    const int c1 = cellCoord(rect.right());
+    const int r0 = cellCoord(rect.top());
+    const int r1 = cellCoord(rect.bottom());
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            const int cell = cellIndex(c, r);
+            for (int k = m_cellStart.at(cell); k < m_cellStart.at(cell + 1); ++k) {
+                const int i = m_cellChars.at(k);
+                if (rect.contains(m_boxes.at(i).center())) chars.append(i);
+            }
+        }
+    }
+
+    // 跨格的字会出现多次：排序去重后把连续的下标合并成区间
+    std::sort(chars.begin(), chars.end());
+    chars.erase(std::unique(chars.begin(), chars.end()), chars.end());
+
+    QVector<QPair<int, int>> ranges;
+    for (const int i : chars) {
+        if (!ranges.isEmpty() && ranges.last().second == i) ++ranges.last().second;
+        else ranges.append(qMakePair(i, i + 1));
+    }
+    return ranges;
+}
+
+QPair<int, int> TextLayout::wordAt(int index) const
+{
+    if (index < 0 || index >= m_text.size()) return qMakePair(0, 0);
+    if (!isWordChar(m_text.at(index))) return qMakePair(index, index + 1);
+
+    // 同一行内连续的字母数字（中文整段连续的汉字）
+    const QPair<int, int> line = lineAt(index);
+    int start = index;
+    int end = index + 1;
+    while (start > line.first && isWordChar(m_text.at(start - 1))) --start;
+    while (end < line.second && isWordChar(m_text.at(end))) ++end;
+    return qMakePair(start, end);
+}
+
+QPair<int, int> TextLayout::lineAt(int index) const
+{
+    if (index < 0 || index >= m_text.size()) return qMakePair(0, 0);
+
+    const int line = lineOf(index);
+    const int start = m_lineStarts.at(line);
+    int end = (line + 1 < m_lineStarts.size()) ? m_lineStarts.at(line + 1) : m_text.size();
+
+    // 不含行尾的换行符
+    while (end > start && (m_text.at(end - 1) == QLatin1Char('\n') || m_text.at(end - 1) == QLatin1Char('\r'))) --end;
+    return qMakePair(start, end);
+}
+
+QVector<QRectF> TextLayout::selectionRects(int start, int end) const
+{
+    QVector<QRectF> rects;
+    start = qMax(0, start);
+    end = qMin(end, m_text.size());
+    if (start >= end) return rects;
+
+    int line = lineOf(start);
+    QRectF current;
+    for (int i = start; i < end; ++i) {
+        const int lineEnd = (line + 1 < m_lineStarts.size()) ? m_lineStarts.at(line + 1) : m_text.size();
+        if (i >= lineEnd) {
+            if (!current.isNull()) rects.append(current);
+            current = QRectF();
+            line = lineOf(i);
+        }
+        const QRectF &box = m_boxes.at(i);
+        if (!box.isNull()) current = current.isNull() ? box : current.united(box);
+    }
+    if (!current.isNull()) rects.append(current);
+    return rects;
+}
+
+QString TextLayout::textOf(int start, int end) const
+{
+    start = qMax(0, start);
+    end = qMin(end, m_text.size());
+    if (start >= end) return QString();
+
+    QString text = m_text.mid(start, end - start);
+    text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    text.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+    return text;
+}
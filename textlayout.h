@@ -0,0 +1,66 @@
+﻿#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <QPair>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+// 一页文字的版面：每个字符的框（页面归一化坐标，0..1，左上为原点）加上查找结构
+// - 均匀网格：每格记下与之相交的字符，点中哪个字、框选了哪些字只看附近几格
+// - 行：按字序切分（换行符或字符框上下错开），记下每行起点，字所在的行二分查找
+// - 建好后只读，可在线程间共享
+class TextLayout
+{
+public:
+    TextLayout() = default;
+
+    // boxes 与 text 一一对应；PDFium 生成的字符（换行等）没有框，传空矩形
+    TextLayout(const QString &text, const QVector<QRectF> &boxes);
+
+    const QString &text() const { return m_text; }
+    int size() const { return m_text.size(); }
+    QRectF charBox(int index) const { return m_boxes.value(index); }
+
+    // 点落在哪个字符的框里，没有返回 -1
+    int charAt(const QPointF &point) const;
+
+    // 离点最近的字符（拖选时用），页上没有字返回 -1
+    int nearestChar(const QPointF &point) const;
+
+    // 框选：字符框中心落在 rect 里的字，按字序合并成 [start, end) 区间
+    QVector<QPair<int, int>> rangesIn(const QRectF &rect) const;
+
+    // 双击选词、三击选行：返回 [start, end)
+    QPair<int, int> wordAt(int index) const;
+    QPair<int, int> lineAt(int index) const;
+
+    // 区间里的字按行合并成的矩形（用于覆盖层）
+    QVector<QRectF> selectionRects(int start, int end) const;
+
+    // 区间的文字，换行统一为 \n
+    QString textOf(int start, int end) const;
+
+private:
+    int lineOf(int index) const;
+    void buildGrid();
+    void buildLines();
+
+    int cellIndex(int col, int row) const { return row * m_gridSize + col; }
+    int cellCoord(qreal v) const;
+
+private:
+    QString m_text;
+    QVector<QRectF> m_boxes;
+
+    // 网格：m_gridSize × m_gridSize 覆盖整页，格 c 的字符是 m_cellChars[m_cellStart[c] .. m_cellStart[c+1])
+    int m_gridSize = 1;
+    QVector<int> m_cellStart;
+    QVector<int> m_cellChars;
+
+    // 每行第一个字符的下标，升序
+    QVector<int> m_lineStarts;
+};
+
+#endif // TEXTLAYOUT_H
@@ -0,0 +1,247 @@
+﻿#include "textmatcher.h"
+
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// 定义 MATCHER_NO_SIMD 时只用逐字比较（测试里用来覆盖没有 SSE2 的路径）
+#if !defined(MATCHER_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATCHER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// 半角片假名与标点（U+FF61..U+FF9F）对应的全角字符
+const ushort kHalfwidthKana[] = {
+    0x3002, 0x300C, 0x300D, 0x3001, 0x30FB, 0x30F2, 0x30A1, 0x30A3,     // ｡｢｣､･ｦｧｨ
+    0x30A5, 0x30A7, 0x30A9, 0x30E3, 0x30E5, 0x30E7, 0x30C3, 0x30FC,     // ｩｪｫｬｭｮｯｰ
+    0x30A2, 0x30A4, 0x30A6, 0x30A8, 0x30AA, 0x30AB, 0x30AD, 0x30AF,     // ｱｲｳｴｵｶｷｸ
+    0x30B1, 0x30B3, 0x30B5, 0x30B7, 0x30B9, 0x30BB, 0x30BD, 0x30BF,     // ｹｺｻｼｽｾｿﾀ
+    0x30C1, 0x30C4, 0x30C6, 0x30C8, 0x30CA, 0x30CB, 0x30CC, 0x30CD,     // ﾁﾂﾃﾄﾅﾆﾇﾈ
+    0x30CE, 0x30CF, 0x30D2, 0x30D5, 0x30D8, 0x30DB, 0x30DE, 0x30DF,     // ﾉﾊﾋﾌﾍﾎﾏﾐ
+    0x30E0, 0x30E1, 0x30E2, 0x30E4, 0x30E6, 0x30E8, 0x30E9, 0x30EA,     // ﾑﾒﾓﾔﾕﾖﾗﾘ
+    0x30EB, 0x30EC, 0x30ED, 0x30EF, 0x30F3, 0x309B, 0x309C              // ﾙﾚﾛﾜﾝﾞﾟ
+};
+
+// 全角符号（U+FFE0..U+FFE6）对应的半角字符：￠￡￢￣￤￥￦
+const ushort kFullwidthSigns[] = { 0x00A2, 0x00A3, 0x00AC, 0x00AF, 0x00A6, 0x00A5, 0x20A9 };
+
+// 模糊查找用的字符 -> 位置掩码表：查询里没有的字符（正文里的绝大多数）先用过滤位图排除
+class CharMasks
+{
+public:
+    explicit CharMasks(const QString &needle)
+    {
+        for (int j = 0; j < needle.size(); ++j) {
+            const ushort c = needle.at(j).unicode();
+            auto it = std::lower_bound(m_entries.begin(), m_entries.end(), c,
+                                       [](const Entry &e, ushort k) { return e.c < k; });
+            if (it == m_entries.end() || it->c != c) it = m_entries.insert(it, Entry{ c, 0 });
+            it->mask |= quint64(1) << j;
+            m_filter[(c >> 6) & 15] |= quint64(1) << (c & 63);
+        }
+    }
+
+    quint64 maskFor(ushort c) const
+    {
+        if (!(m_filter[(c >> 6) & 15] & (quint64(1) << (c & 63)))) return 0;
+        const auto it = std::lower_bound(m_entries.begin(), m_entries.end(), c,
+                                         [](const Entry &e, ushort k) { return e.c < k; });
+        return (it != m_entries.end() && it->c == c) ? it->mask : 0;
+    }
+
+private:
+    struct Entry {
+        ushort c;
+        quint64 mask;
+    };
+    std::vector<Entry> m_entries;
+    quint64 m_filter[16] = {};
+};
+
+// 以 end（含）结尾、与 needle 编辑距离最小的那段文字的起点；距离写入 edits
+int fuzzyStart(const QChar *text, int end, const QString &needle, int maxEdits, int *edits)
+{
+    // 从 end 往前逐字扩展文字段，列是查询的后缀长度
+    const int m = needle.size();
+    std::vector<int> column(size_t(m + 1));
+    std::vector<int> next(size_t(m + 1));
+    for (int j = 0; j <= m; ++j) column[size_t(j)] = j;
+
+    int bestLength = 0;
+    int bestEdits = m;
+    const int maxLength = qMin(end + 1, m + maxEdits);
+    for (int l = 1; l <= maxLength; ++l) {
+        const QChar c = text[end - l + 1];
+        next[0] = l;
+        for (int j = 1; j <= m; ++j) {
+            const int cost = (needle.at(m - j) == c) ? 0 : 1;
+            next[size_t(j)] = qMin(qMin(column[size_t(j)] + 1, next[size_t(j - 1)] + 1),
+                                   column[size_t(j - 1)] + cost);
+        }
+        column.swap(next);
+
+        // 距离相同取长度最接近查询的
+        const int d = column[size_t(m)];
+        if (d < bestEdits || (d == bestEdits && qAbs(l - m) < qAbs(bestLength - m))) {
+            bestEdits = d;
+            bestLength = l;
+        }
+    }
+
+    *edits = bestEdits;
+    return end - bestLength + 1;
+}
+
+} // namespace
+
+QChar TextMatcher::foldChar(QChar c)
+{
+    const ushort u = c.unicode();
+
+    // 1. ASCII：最常见，单独走快路径
+    if (u < 0x80) return (u >= 'A' && u <= 'Z') ? QChar(ushort(u + 32)) : c;
+
+    // 2. 全角/半角统一：全角 ASCII 转半角（再折叠大小写），半角片假名转全角
+    if (u >= 0xFF01 && u <= 0xFF5E) return foldChar(QChar(ushort(u - 0xFEE0)));
+    if (u >= 0xFF61 && u <= 0xFF9F) return QChar(kHalfwidthKana[u - 0xFF61]);
+    if (u >= 0xFFE0 && u <= 0xFFE6) return QChar(kFullwidthSigns[u - 0xFFE0]);
+    if (u == 0x3000) return QChar(' ');
+
+    // 3. 其余按 Unicode 的简单大小写折叠（一对一）
+    return c.toCaseFolded();
+}
+
+QString TextMatcher::fold(const QString &text)
+{
+    QString result(text.size(), Qt::Uninitialized);
+    QChar *out = result.data();
+    for (const QChar c : text) *out++ = foldChar(c);
+    return result;
+}
+
+int TextMatcher::indexOf(const QChar *text, int textLength, const QChar *needle, int needleLength, int from)
+{
+    from = qMax(0, from);
+    if (needleLength <= 0) return from <= textLength ? from : -1;
+    if (needleLength > textLength - from) return -1;
+
+    const ushort *hay = reinterpret_cast<const ushort *>(text);
+    const ushort *pat = reinterpret_cast<const ushort *>(needle);
+    const ushort first = pat[0];
+    const ushort last = pat[needleLength - 1];
+    const size_t middleBytes = size_t(qMax(0, needleLength - 2)) * sizeof(ushort);
+    const int lastStart = textLength - needleLength;     // 最后一个可能的起点
+
+    int i = from;
+#ifdef MATCHER_SSE2
+    // 每次看 8 个起点：首字符和尾字符同时对上的才逐个比较中间部分
+    const __m128i firstv = _mm_set1_epi16(short(first));
+    const __m128i lastv = _mm_set1_epi16(short(last));
+    for (; i + 7 <= lastStart; i += 8) {
+        const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i));
+        const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + needleLength - 1));
+        const __m128i eq = _mm_and_si128(_mm_cmpeq_epi16(head, firstv), _mm_cmpeq_epi16(tail, lastv));
+
+        uint mask = uint(_mm_movemask_epi8(eq));     // 每个字符占两位
+        while (mask) {
+            const int bit = int(qCountTrailingZeroBits(mask));
+            const int pos = i + bit / 2;
+            if (needleLength < 3 || std::memcmp(hay + pos + 1, pat + 1, middleBytes) == 0) return pos;
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+    for (; i <= lastStart; ++i) {
+        if (hay[i] != first || hay[i + needleLength - 1] != last) continue;
+        if (needleLength < 3 || std::memcmp(hay + i + 1, pat + 1, middleBytes) == 0) return i;
+    }
+    return -1;
+}
+
+int TextMatcher::indexOf(const QString &text, const QString &needle, int from)
+{
+    return indexOf(text.constData(), text.size(), needle.constData(), needle.size(), from);
+}
+
+QVector<TextMatcher::Match> TextMatcher::findFuzzy(const QString &text, const QString &needle, int maxEdits)
+{
+    QVector<Match> matches;
+    const int m = needle.size();
+    if (m == 0 || m > kMaxFuzzyLength) return matches;
+
+    maxEdits = qBound(0, maxEdits, m - 1);
+    if (maxEdits == 0) {
+        for (int pos = indexOf(text, needle); pos >= 0; pos = indexOf(text, needle, pos + m)) {
+            Match match;
+            match.start = pos;
+            match.length = m;
+            matches.append(match);
+        }
+        return matches;
+    }
+
+    // R[d] 第 j 位：查询的前 j+1 个字符能以不超过 d 次编辑匹配到当前位置为止的某段文字
+    const CharMasks masks(needle);
+    const quint64 accept = quint64(1) << (m - 1);
+    std::vector<quint64> r(size_t(maxEdits + 1));
+    for (int d = 0; d <= maxEdits; ++d) r[size_t(d)] = (quint64(1) << d) - 1;    // 删掉查询开头 d 个字符
+
+    const QChar *data = text.constData();
+    int pendingEnd = -1;
+    int pendingEdits = maxEdits + 1;
+    int lastEnd = -1;       // 上一处匹配的结尾，之后的匹配不能和它重叠
+
+    auto flush = [&]() {
+        if (pendingEnd < 0) return;
+        int edits = 0;
+        const int start = fuzzyStart(data, pendingEnd, needle, maxEdits, &edits);
+        if (start > lastEnd && edits <= maxEdits) {
+            Match match;
+            match.start = start;
+            match.length = pendingEnd - start + 1;
+            match.edits = edits;
+            matches.append(match);
+            lastEnd = pendingEnd;
+        }
+        pendingEnd = -1;
+        pendingEdits = maxEdits + 1;
+    };
+
+    for (int i = 0; i < text.size(); ++i) {
+        const quint64 b = masks.maskFor(data[i].unicode());
+
+        quint64 previous = r[0];        // 上一位置的 R[d-1]
+        r[0] = ((r[0] << 1) | 1) & b;
+        int edits = (r[0] & accept) ? 0 : -1;
+        for (int d = 1; d <= maxEdits; ++d) {
+            const quint64 old = r[size_t(d)];
+            // 匹配 | 多出一个文字字符 | 替换、少一个查询字符
+            r[size_t(d)] = (((old << 1) | 1) & b) | previous | (((previous | r[size_t(d - 1)]) << 1) | 1);
+            previous = old;
+            if (edits < 0 && (r[size_t(d)] & accept)) edits = d;
+        }
+
+        // 一处匹配附近连续几个结尾都满足条件：在 maxEdits 个字符内取编辑最少的结尾
+        if (edits >= 0 && edits < pendingEdits) {
+            pendingEnd = i;
+            pendingEdits = edits;
+        }
+        if (pendingEnd >= 0 && (pendingEdits == 0 || i - pendingEnd >= maxEdits)) flush();
+    }
+    flush();
+    return matches;
+}
+
+int TextMatcher::fuzzyEditsFor(int needleLength)
+{
+    if (needleLength < 4) return 0;
+    if (needleLength < 8) return 1;
+    if (needleLength < 16) return 2;
+    return 3;
+}
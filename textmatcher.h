@@ -0,0 +1,40 @@
+﻿#ifndef TEXTMATCHER_H
+#define TEXTMATCHER_H
+
+#include <QChar>
+#include <QString>
+#include <QVector>
+
+// 页面文字的匹配（在缓存的 UTF-16 文字上做，不走 FPDFText_FindStart）
+// - 规范化：Unicode 大小写折叠，全角 ASCII / 全角符号转半角，半角片假名转全角；
+//   都是一个字符对一个字符，折叠前后下标一致（ß→ss 这类一变多的折叠不做）
+// - 精确查找：有 SSE2 时一次比较 8 个字符，首尾两个字符都对上的位置才逐个确认
+// - 模糊查找：允许少量插入/删除/替换，位并行（Wu-Manber），查询最长 64 个字符
+class TextMatcher
+{
+public:
+    struct Match {
+        int start = 0;
+        int length = 0;
+        int edits = 0;
+    };
+
+    static const int kMaxFuzzyLength = 64;
+
+    static QChar foldChar(QChar c);
+
+    // 逐字 foldChar，长度不变
+    static QString fold(const QString &text);
+
+    // 精确查找，找不到返回 -1
+    static int indexOf(const QChar *text, int textLength, const QChar *needle, int needleLength, int from = 0);
+    static int indexOf(const QString &text, const QString &needle, int from = 0);
+
+    // 编辑次数不超过 maxEdits 的所有不重叠匹配（每处取编辑次数最少的那个）
+    static QVector<Match> findFuzzy(const QString &text, const QString &needle, int maxEdits);
+
+    // 按查询长度给的容错：太短的查询容错会匹配到大量无关内容
+    static int fuzzyEditsFor(int needleLength);
+};
+
+#endif // TEXTMATCHER_H
@@ -0,0 +1,445 @@
+﻿#include "zippdfsource.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+namespace {
+
+const qint64 kChunk = 64 * 1024;                  // 解压缓存块
+const qint64 kCacheBudget = 32 * 1024 * 1024;
+const qint64 kSpan = 1024 * 1024;                 // 检查点间隔
+const int kWindow = 32768;                        // deflate 字典大小
+const int kInput = 16384;
+
+const char kSeparator[] = "!/";
+
+inline quint16 le16(const uchar *p) { return qFromLittleEndian<quint16>(p); }
+inline quint32 le32(const uchar *p) { return qFromLittleEndian<quint32>(p); }
+inline quint64 le64(const uchar *p) { return qFromLittleEndian<quint64>(p); }
+
+bool readAt(QFile &file, qint64 position, QByteArray *out, qint64 length)
+{
+    if (position < 0 || !file.seek(position)) return false;
+    *out = file.read(length);
+    return out->size() == length;
+}
+
+} // namespace
+
+ZipPdfSource::ZipPdfSource(const QString &archivePath, const QString &entryName)
+    : m_archivePath(archivePath)
+    , m_entryName(entryName)
+    , m_file(archivePath)
+{
+}
+
+ZipPdfSource::~ZipPdfSource()
+{
+}
+
+bool ZipPdfSource::open(QString *error)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    // 1. 找到条目
+    QVector<Entry> entries;
+    if (!readCentralDirectory(m_file, &entries, error)) return false;
+
+    bool found = false;
+    for (const Entry &e : entries) {
+        if (e.name == m_entryName) {
+            m_entry = e;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        if (error) *error = QStringLiteral("压缩包里没有 %1").arg(m_entryName);
+        return false;
+    }
+
+    if (m_entry.flags & 0x1) {
+        if (error) *error = QStringLiteral("不支持加密的压缩条目");
+        return false;
+    }
+    if (m_entry.method != 0 && m_entry.method != Z_DEFLATED) {
+        if (error) *error = QStringLiteral("不支持的压缩方式 %1").arg(m_entry.method);
+        return false;
+    }
+
+    // 2. 本地文件头后面才是数据（文件名、扩展字段长度可能和中央目录不同）
+    QByteArray header;
+    if (!readAt(m_file, m_entry.localHeaderOffset, &header, 30) ||
+        le32(reinterpret_cast<const uchar*>(header.constData())) != 0x04034b50) {
+        if (error) *error = QStringLiteral("压缩包已损坏（本地文件头）");
+        return false;
+    }
+    const uchar *h = reinterpret_cast<const uchar*>(header.constData());
+    m_dataOffset = m_entry.localHeaderOffset + 30 + le16(h + 26) + le16(h + 28);
+
+    if (m_dataOffset + m_entry.compressedSize > m_file.size()) {
+        if (error) *error = QStringLiteral("压缩包已损坏（数据越界）");
+        return false;
+    }
+
+    // 3. deflate 条目：从头开始的检查点
+    if (m_entry.method == Z_DEFLATED) m_index.append(Checkpoint());
+
+    return true;
+}
+
+qint64 ZipPdfSource::size() const
+{
+    return m_entry.uncompressedSize;
+}
+
+QString ZipPdfSource::description() const
+{
+    return makeLocation(m_archivePath, m_entryName);
+}
+
+QStringList ZipPdfSource::pdfEntries(const QString &archivePath, QString *error)
+{
+    QFile file(archivePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return QStringList();
+    }
+
+    QVector<Entry> entries;
+    if (!readCentralDirectory(file, &entries, error)) return QStringList();
+
+    QStringList names;
+    for (const Entry &e : entries) {
+        if (e.name.endsWith(QLatin1String(".pdf"), Qt::CaseInsensitive)) names.append(e.name);
+    }
+    return names;
+}
+
+bool ZipPdfSource::splitLocation(const QString &location, QString *archivePath, QString *entryName)
+{
+    // 以第一个 ".zip!/" 为界：压缩包路径里不太可能再出现它
+    const int pos = location.indexOf(QLatin1String(".zip") + QLatin1String(kSeparator), 0, Qt::CaseInsensitive);
+    if (pos < 0) return false;
+
+    if (archivePath) *archivePath = location.left(pos + 4);
+    if (entryName) *entryName = location.mid(pos + 4 + 2);
+    return true;
+}
+
+QString ZipPdfSource::makeLocation(const QString &archivePath, const QString &entryName)
+{
+    return archivePath + QLatin1String(kSeparator) + entryName;
+}
+
+bool ZipPdfSource::readCentralDirectory(QFile &file, QVector<Entry> *entries, QString *error)
+{
+    const qint64 fileSize = file.size();
+
+    // 1. 从尾部找 End of Central Directory（后面最多跟 64KB 注释）
+    const qint64 tailLen = qMin<qint64>(fileSize, 22 + 65535);
+    QByteArray tail;
+    if (tailLen < 22 || !readAt(file, fileSize - tailLen, &tail, tailLen)) {
+        if (error) *error = QStringLiteral("不是有效的 ZIP 文件");
+        return false;
+    }
+
+    const uchar *t = reinterpret_cast<const uchar*>(tail.constData());
+    qint64 eocd = -1;
+    for (qint64 i = tailLen - 22; i >= 0; --i) {
+        if (le32(t + i) == 0x06054b50) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        if (error) *error = QStringLiteral("不是有效的 ZIP 文件（找不到目录）");
+        return false;
+    }
+
+    quint64 count = le16(t + eocd + 10);
+    quint64 cdSize = le32(t + eocd + 12);
+    quint64 cdOffset = le32(t + eocd + 16);
+
+    // 2. zip64：EOCD 前面是 zip64 定位记录
+    if (count == 0xFFFF || cdSize == 0xFFFFFFFF || cdOffset == 0xFFFFFFFF) {
+        const qint64 locatorPos = fileSize - tailLen + eocd - 20;
+        QByteArray locator, record;
+        if (locatorPos < 0 || !readAt(file, locatorPos, &locator, 20) ||
+            le32(reinterpret_cast<const uchar*>(locator.constData())) != 0x07064b50) {
+            if (error) *error = QStringLiteral("压缩包已损坏（zip64 定位记录）");
+            return false;
+        }
+
+        const qint64 recordPos = qint64(le64(reinterpret_cast<const uchar*>(locator.constData()) + 8));
+        if (!readAt(file, recordPos, &record, 56) ||
+            le32(reinterpret_cast<const uchar*>(record.constData())) != 0x06064b50) {
+            if (error) *error = QStringLiteral("压缩包已损坏（zip64 目录记录）");
+            return false;
+        }
+
+        const uchar *r = reinterpret_cast<const uchar*>(record.constData());
+        count = le64(r + 32);
+        cdSize = le64(r + 40);
+        cdOffset = le64(r + 48);
+    }
+
+    // 3. 逐条读中央目录
+    QByteArray cd;
+    if (qint64(cdOffset + cdSize) > fileSize || !readAt(file, qint64(cdOffset), &cd, qint64(cdSize))) {
+        if (error) *error = QStringLiteral("压缩包已损坏（目录越界）");
+        return false;
+    }
+
+    const uchar *p = reinterpret_cast<const uchar*>(cd.constData());
+    const uchar *end = p + cd.size();
+    entries->clear();
+    for (quint64 i = 0; i < count; ++i) {
+        if (end - p < 46 || le32(p) != 0x02014b50) {
+            if (error) *error = QStringLiteral("压缩包已损坏（目录项）");
+            return false;
+        }
+
+        const int nameLen = le16(p + 28);
+        const int extraLen = le16(p + 30);
+        const int commentLen = le16(p + 32);
+        if (end - p < 46 + nameLen + extraLen + commentLen) {
+            if (error) *error = QStringLiteral("压缩包已损坏（目录项）");
+            return false;
+        }
+
+        Entry e;
+        e.flags = le16(p + 8);
+        e.method = le16(p + 10);
+        e.compressedSize = le32(p + 20);
+        e.uncompressedSize = le32(p + 24);
+        e.localHeaderOffset = le32(p + 42);
+
+        // 第 11 位：文件名是 UTF-8；否则按本地编码（国内常见 GBK）
+        const QByteArray rawName(reinterpret_cast<const char*>(p + 46), nameLen);
+        e.name = (e.flags & 0x800) ? QString::fromUtf8(rawName) : QString::fromLocal8Bit(rawName);
+
+        // zip64 扩展字段：只包含被标成 0xFFFFFFFF 的那几项，按固定顺序
+        const uchar *x = p + 46 + nameLen;
+        const uchar *xEnd = x + extraLen;
+        while (xEnd - x >= 4) {
+            const int id = le16(x);
+            const int len = le16(x + 2);
+            if (xEnd - x - 4 < len) break;
+
+            if (id == 0x0001) {
+                const uchar *v = x + 4;
+                const uchar *vEnd = v + len;
+                if (e.uncompressedSize == 0xFFFFFFFF && vEnd - v >= 8) { e.uncompressedSize = qint64(le64(v)); v += 8; }
+                if (e.compressedSize == 0xFFFFFFFF && vEnd - v >= 8) { e.compressedSize = qint64(le64(v)); v += 8; }
+                if (e.localHeaderOffset == 0xFFFFFFFF && vEnd - v >= 8) { e.localHeaderOffset = qint64(le64(v)); }
+            }
+            x += 4 + len;
+        }
+
+        entries->append(e);
+        p += 46 + nameLen + extraLen + commentLen;
+    }
+
+    return true;
+}
+
+bool ZipPdfSource::readData(qint64 position, uchar *buffer, qint64 length)
+{
+    if (position < 0 || length < 0 || position + length > m_entry.uncompressedSize) return false;
+    if (length == 0) return true;
+
+    QMutexLocker locker(&m_mutex);
+
+    // 1. 存储条目：直接读
+    if (m_entry.method == 0) return readArchiveLocked(m_dataOffset + position, buffer, length);
+
+    // 2. deflate 条目：缺哪块就从检查点解压
+    const qint64 first = position / kChunk;
+    const qint64 last = (position + length - 1) / kChunk;
+    for (qint64 c = first; c <= last; ++c) {
+        if (m_chunks.contains(c)) continue;
+        if (!inflateRangeLocked(c * kChunk, position + length - c * kChunk)) return false;
+        break;
+    }
+
+    for (qint64 c = first; c <= last; ++c) {
+        auto it = m_chunks.constFind(c);
+        if (it == m_chunks.constEnd()) return false;
+
+        const qint64 chunkStart = c * kChunk;
+        const qint64 from = qMax(position, chunkStart);
+        const qint64 to = qMin(position + length, chunkStart + qint64(it.value().size()));
+        if (to <= from) return false;
+
+        std::memcpy(buffer + (from - position), it.value().constData() + (from - chunkStart), size_t(to - from));
+
+        m_lru.removeOne(c);
+        m_lru.append(c);
+    }
+    return true;
+}
+
+bool ZipPdfSource::readArchiveLocked(qint64 position, uchar *buffer, qint64 length)
+{
+    if (!m_file.seek(position)) return false;
+    return m_file.read(reinterpret_cast<char*>(buffer), length) == length;
+}
+
+bool ZipPdfSource::inflateRangeLocked(qint64 position, qint64 length)
+{
+    // 1. 选检查点：out 不超过目标块起点的最后一个
+    const qint64 target = (position / kChunk) * kChunk;
+    const qint64 targetEnd = qMin(m_entry.uncompressedSize, ((position + length + kChunk - 1) / kChunk) * kChunk);
+
+    int cpIndex = 0;
+    for (int i = 1; i < m_index.size() && m_index[i].out <= target; ++i) cpIndex = i;
+    const Checkpoint cp = m_index[cpIndex];
+
+    z_stream strm;
+    std::memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -15) != Z_OK) return false;    // ZIP 里是裸 deflate 流
+
+    qint64 inPos = cp.in;
+    std::vector<uchar> input(kInput);
+    std::vector<uchar> window(kWindow);
+
+    // 2. 恢复解压状态：检查点不在字节边界时，先补上前一个字节剩下的位
+    bool ok = true;
+    if (cp.bits) {
+        uchar byte = 0;
+        ok = readArchiveLocked(m_dataOffset + cp.in - 1, &byte, 1) &&
+             inflatePrime(&strm, cp.bits, byte >> (8 - cp.bits)) == Z_OK;
+    }
+    if (ok && !cp.window.isEmpty()) {
+        ok = inflateSetDictionary(&strm, reinterpret_cast<const Bytef*>(cp.window.constData()),
+                                  uInt(cp.window.size())) == Z_OK;
+    }
+
+    // 3. 解压：整块输出进缓存，必要时顺路补检查点
+    qint64 outPos = cp.out;
+    QByteArray pending;                 // 正在拼的块（从块边界开始）
+    qint64 lastCheckpointOut = m_index.last().out;
+    int ret = Z_OK;
+
+    auto emitOutput = [&](const uchar *data, qint64 n) {
+        qint64 pos = outPos;
+        while (n > 0) {
+            // 检查点不一定在块边界上：边界之前的那一小段丢掉
+            if (pending.isEmpty() && pos % kChunk != 0) {
+                const qint64 skip = qMin(n, kChunk - pos % kChunk);
+                data += skip;
+                pos += skip;
+                n -= skip;
+                continue;
+            }
+
+            const qint64 take = qMin(n, kChunk - qint64(pending.size()));
+            pending.append(reinterpret_cast<const char*>(data), int(take));
+            data += take;
+            pos += take;
+            n -= take;
+
+            if (pending.size() == kChunk) {
+                insertChunkLocked((pos - 1) / kChunk, pending);
+                pending.clear();
+            }
+        }
+    };
+
+    strm.avail_out = 0;
+    while (ok && outPos < targetEnd) {
+        if (strm.avail_out == 0) {
+            strm.avail_out = kWindow;
+            strm.next_out = window.data();
+        }
+
+        if (strm.avail_in == 0) {
+            const qint64 remaining = m_entry.compressedSize - inPos;
+            const qint64 n = qMin<qint64>(kInput, remaining);
+            if (n <= 0 || !readArchiveLocked(m_dataOffset + inPos, input.data(), n)) {
+                ok = false;
+                break;
+            }
+            strm.next_in = input.data();
+            strm.avail_in = uInt(n);
+        }
+
+        const uInt inBefore = strm.avail_in;
+        const uInt outBefore = strm.avail_out;
+        uchar *outStart = strm.next_out;
+
+        // Z_BLOCK：在每个 deflate 块结束时返回，才能在块边界记检查点
+        ret = inflate(&strm, Z_BLOCK);
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+            ok = false;
+            break;
+        }
+
+        const qint64 produced = outBefore - strm.avail_out;
+        inPos += inBefore - strm.avail_in;
+        emitOutput(outStart, produced);
+        outPos += produced;
+
+        if (ret == Z_STREAM_END) break;
+
+        // 块边界、且超过已有索引一个间隔：记一个检查点（第 7 位=块结束，第 6 位=最后一块）
+        if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+            outPos > m_indexedOut && outPos - lastCheckpointOut >= kSpan) {
+            Checkpoint next;
+            next.out = outPos;
+            next.in = inPos;
+            next.bits = strm.data_type & 7;
+
+            // 环形窗口展开成按时间顺序的 32KB
+            const int left = int(strm.avail_out);
+            next.window.resize(kWindow);
+            std::memcpy(next.window.data(), window.data() + kWindow - left, size_t(left));
+            if (left < kWindow) std::memcpy(next.window.data() + left, window.data(), size_t(kWindow - left));
+
+            m_index.append(next);
+            lastCheckpointOut = outPos;
+        }
+    }
+
+    // 流结束时最后一块可能不满 64KB
+    if (ok && !pending.isEmpty() && outPos >= m_entry.uncompressedSize) {
+        insertChunkLocked((outPos - 1) / kChunk, pending);
+    }
+
+    m_indexedOut = qMax(m_indexedOut, outPos);
+    inflateEnd(&strm);
+
+    if (!ok) qWarning() << "inflate failed:" << description() << "at" << outPos;
+    return ok;
+}
+
+void ZipPdfSource::insertChunkLocked(qint64 index, const QByteArray &data)
+{
+    auto it = m_chunks.find(index);
+    if (it != m_chunks.end()) {
+        m_cachedBytes += data.size() - it.value().size();
+        it.value() = data;
+    } else {
+        m_chunks.insert(index, data);
+        m_lru.append(index);
+        m_cachedBytes += data.size();
+    }
+
+    while (m_cachedBytes > kCacheBudget && m_lru.size() > 1) {
+        const qint64 victim = m_lru.takeFirst();
+        m_cachedBytes -= m_chunks.take(victim).size();
+    }
+}
@@ -0,0 +1,87 @@
+﻿#ifndef ZIPPDFSOURCE_H
+#define ZIPPDFSOURCE_H
+
+#include "pdfsource.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+// 直接读取 ZIP 压缩包里的 PDF，不解压到临时文件
+// - 位置写法：archive.zip!/目录/文件.pdf
+// - 存储（不压缩）的条目：按偏移直接读压缩包
+// - deflate 条目：解压时每隔约 1MB 在块边界记一个检查点（输入位置 + 前 32KB 输出作字典），
+//   随机读取从最近的检查点接着解压，不必每次从头开始；解压出的数据按 64KB 块缓存
+// - 支持 zip64；不支持加密条目
+class ZipPdfSource : public PdfSource
+{
+public:
+    ZipPdfSource(const QString &archivePath, const QString &entryName);
+    ~ZipPdfSource() override;
+
+    bool open(QString *error);
+
+    qint64 size() const override;
+    QString description() const override;
+
+    // 压缩包里所有的 PDF 条目
+    static QStringList pdfEntries(const QString &archivePath, QString *error = nullptr);
+
+    // 拆分 "archive.zip!/entry.pdf"；不是压缩包位置时返回 false
+    static bool splitLocation(const QString &location, QString *archivePath, QString *entryName);
+    static QString makeLocation(const QString &archivePath, const QString &entryName);
+
+protected:
+    bool readData(qint64 position, uchar *buffer, qint64 length) override;
+
+private:
+    friend class TestZipPdfSource;  // 单元测试检查检查点和缓存淘汰
+
+    struct Entry {
+        QString name;
+        quint16 flags = 0;
+        quint16 method = 0;
+        qint64 compressedSize = 0;
+        qint64 uncompressedSize = 0;
+        qint64 localHeaderOffset = 0;
+    };
+
+    // 解压检查点（同 zlib 示例 zran.c）
+    struct Checkpoint {
+        qint64 out = 0;         // 对应的解压后位置
+        qint64 in = 0;          // 压缩数据中的位置（字节）
+        int bits = 0;           // in 之前那个字节还剩几位没用
+        QByteArray window;      // 之前 32KB 的输出，作为解压字典
+    };
+
+    static bool readCentralDirectory(QFile &file, QVector<Entry> *entries, QString *error);
+
+    bool readArchiveLocked(qint64 position, uchar *buffer, qint64 length);
+
+    // 从合适的检查点解压，直到 [position, position + length) 所在的块都进了缓存
+    bool inflateRangeLocked(qint64 position, qint64 length);
+
+    void insertChunkLocked(qint64 index, const QByteArray &data);
+
+private:
+    QString m_archivePath;
+    QString m_entryName;
+
+    QMutex m_mutex;
+    QFile m_file;
+    Entry m_entry;
+    qint64 m_dataOffset = 0;    // 压缩数据在压缩包中的起点
+
+    QVector<Checkpoint> m_index;    // 按 out 递增
+    qint64 m_indexedOut = 0;        // 已经解压到过的最远位置
+
+    QHash<qint64, QByteArray> m_chunks;
+    QList<qint64> m_lru;
+    qint64 m_cachedBytes = 0;
+};
+
+#endif // ZIPPDFSOURCE_H